@@ -29,13 +29,29 @@
 #include "check.h"
 #include "check_error.h"
 #include "check_list.h"
+#include "check_arena.h"
 #include "check_impl.h"
+#include "check_alloc.h"
 #include "check_msg.h"
+#include "check_perf.h"
+#include "check_stats.h"
 
 #ifndef DEFAULT_TIMEOUT
 #define DEFAULT_TIMEOUT 4
 #endif
 
+/* the timeouts taken from a duration history, see
+   srunner_set_timeout_history() */
+#ifndef DEFAULT_HISTORY_FACTOR
+#define DEFAULT_HISTORY_FACTOR 5
+#endif
+#ifndef DEFAULT_HISTORY_FLOOR
+#define DEFAULT_HISTORY_FLOOR 1
+#endif
+
+/* percent a benchmark may be slower than its baseline by */
+#define DEFAULT_BASELINE_THRESHOLD 10
+
 /*
  * When a process exits either normally, with exit(), or
  * by an uncaught signal, The lower 0x377 bits are passed
@@ -49,10 +65,13 @@ int check_minor_version = CHECK_MINOR_VERSION;
 int check_micro_version = CHECK_MICRO_VERSION;
 
 static int non_pass(int val);
-static Fixture *fixture_create(SFun fun, int ischecked);
+static Fixture *fixture_create(TCase * tc, SFun fun, int ischecked);
 static void tcase_add_fixture(TCase * tc, SFun setup, SFun teardown,
                               int ischecked);
 static void tr_init(TestResult * tr);
+
+/* see tr_pass_msg() */
+static char pass_msg[] = "Passed";
 static void suite_free(Suite * s);
 static void tcase_free(TCase * tc);
 
@@ -66,6 +85,8 @@ Suite *suite_create(const char *name)
     else
         s->name = name;
     s->tclst = check_list_create();
+    s->sflst = check_list_create();
+    s->tflst = check_list_create();
     return s;
 }
 
@@ -100,15 +121,82 @@ static void suite_free(Suite * s)
         tcase_free((TCase *)check_list_val(l));
     }
     check_list_free(s->tclst);
+    /* the fixtures of a suite are not in an arena */
+    l = s->sflst;
+    for(check_list_front(l); !check_list_at_end(l); check_list_advance(l))
+    {
+        free(check_list_val(l));
+    }
+    check_list_free(s->sflst);
+    l = s->tflst;
+    for(check_list_front(l); !check_list_at_end(l); check_list_advance(l))
+    {
+        free(check_list_val(l));
+    }
+    check_list_free(s->tflst);
     free(s);
 }
 
+/* Parse a number of bytes, with an optional K, M or G suffix for the
+   powers of 1024. Return 0 if str is not one */
+static int parse_bytes(const char *str, size_t * bytes)
+{
+    char *endptr = NULL;
+    double tmp = strtod(str, &endptr);
+
+    if(tmp < 0 || endptr == str)
+        return 0;
+    switch (*endptr)
+    {
+        case 'G':
+        case 'g':
+            tmp *= 1024;
+            /* fall through */
+        case 'M':
+        case 'm':
+            tmp *= 1024;
+            /* fall through */
+        case 'K':
+        case 'k':
+            tmp *= 1024;
+            endptr++;
+            break;
+        default:
+            break;
+    }
+    if(*endptr != '\0' || tmp >= (double)SIZE_MAX)
+        return 0;
+    *bytes = (size_t)tmp;
+    return 1;
+}
+
+/* The factor CK_TIMEOUT_MULTIPLIER scales timeouts and limits by, or 1
+   if it is not set to one */
+static double timeout_multiplier(void)
+{
+    char *env = getenv("CK_TIMEOUT_MULTIPLIER");
+
+    if(env != NULL)
+    {
+        char *endptr = NULL;
+        double tmp = strtod(env, &endptr);
+
+        if(tmp >= 0 && endptr != env && (*endptr) == '\0')
+            return tmp;
+    }
+    return 1;
+}
+
 TCase *tcase_create(const char *name)
 {
     char *env;
     double timeout_sec = DEFAULT_TIMEOUT;
 
-    TCase *tc = (TCase *)emalloc(sizeof(TCase)); /*freed in tcase_free */
+    /* the test case, its tests and fixtures are freed with the arena */
+    Arena *arena = arena_create();
+    TCase *tc = (TCase *)arena_alloc(arena, sizeof(TCase));
+
+    tc->arena = arena;
 
     if(name == NULL)
         tc->name = "";
@@ -127,7 +215,19 @@ TCase *tcase_create(const char *name)
         }
     }
 
-    env = getenv("CK_TIMEOUT_MULTIPLIER");
+    timeout_sec = timeout_sec * timeout_multiplier();
+    tc->timeout.tv_sec = (time_t) floor(timeout_sec);
+    tc->timeout.tv_nsec =
+        (long)((timeout_sec -
+                floor(timeout_sec)) * (double)NANOS_PER_SECONDS);
+
+    tc->memory_limit = 0;
+    env = getenv("CK_DEFAULT_MEMORY_LIMIT");
+    if(env != NULL && !parse_bytes(env, &tc->memory_limit))
+        tc->memory_limit = 0;
+
+    tc->cpu_limit = 0;
+    env = getenv("CK_DEFAULT_CPU_LIMIT");
     if(env != NULL)
     {
         char *endptr = NULL;
@@ -135,15 +235,11 @@ TCase *tcase_create(const char *name)
 
         if(tmp >= 0 && endptr != env && (*endptr) == '\0')
         {
-            timeout_sec = timeout_sec * tmp;
+            tc->cpu_limit = tmp * timeout_multiplier();
         }
     }
 
-    tc->timeout.tv_sec = (time_t) floor(timeout_sec);
-    tc->timeout.tv_nsec =
-        (long)((timeout_sec -
-                floor(timeout_sec)) * (double)NANOS_PER_SECONDS);
-
+    tc->independent = 0;
     tc->tflst = check_list_create();
     tc->unch_sflst = check_list_create();
     tc->ch_sflst = check_list_create();
@@ -156,18 +252,13 @@ TCase *tcase_create(const char *name)
 
 static void tcase_free(TCase * tc)
 {
-    check_list_apply(tc->tflst, free);
-    check_list_apply(tc->unch_sflst, free);
-    check_list_apply(tc->ch_sflst, free);
-    check_list_apply(tc->unch_tflst, free);
-    check_list_apply(tc->ch_tflst, free);
     check_list_free(tc->tflst);
     check_list_free(tc->unch_sflst);
     check_list_free(tc->ch_sflst);
     check_list_free(tc->unch_tflst);
     check_list_free(tc->ch_tflst);
 
-    free(tc);
+    arena_free(tc->arena);
 }
 
 void suite_add_tcase(Suite * s, TCase * tc)
@@ -177,28 +268,66 @@ void suite_add_tcase(Suite * s, TCase * tc)
     check_list_add_end(s->tclst, tc);
 }
 
+void suite_add_fixture(Suite * s, SFun setup, SFun teardown)
+{
+    Fixture *f;
+
+    if(s == NULL)
+        return;
+
+    if(setup)
+    {
+        f = (Fixture *)emalloc(sizeof(Fixture)); /* freed in suite_free */
+        f->fun = setup;
+        f->ischecked = 0;
+        check_list_add_end(s->sflst, f);
+    }
+
+    /* Add teardowns at front so they are run in reverse order. */
+    if(teardown)
+    {
+        f = (Fixture *)emalloc(sizeof(Fixture));
+        f->fun = teardown;
+        f->ischecked = 0;
+        check_list_add_front(s->tflst, f);
+    }
+}
+
 void _tcase_add_test(TCase * tc, TFun fn, const char *name, int _signal,
                      int allowed_exit_value, int start, int end)
+{
+    _tcase_add_test_timeout(tc, fn, name, _signal, allowed_exit_value, start,
+                            end, -1);
+}
+
+void _tcase_add_test_timeout(TCase * tc, TFun fn, const char *name,
+                             int _signal, int allowed_exit_value, int start,
+                             int end, double timeout)
 {
     TF *tf;
 
     if(tc == NULL || fn == NULL || name == NULL)
         return;
-    tf = (TF *)emalloc(sizeof(TF));   /* freed in tcase_free */
+    tf = (TF *)arena_alloc(tc->arena, sizeof(TF));
     tf->fn = fn;
     tf->loop_start = start;
     tf->loop_end = end;
     tf->signal = _signal;       /* 0 means no signal expected */
     tf->allowed_exit_value = (WEXITSTATUS_MASK & allowed_exit_value);   /* 0 is default successful exit */
     tf->name = name;
+    tf->timeout = -1;
+    if(timeout >= 0)
+    {
+        tf->timeout = timeout * timeout_multiplier();
+    }
     check_list_add_end(tc->tflst, tf);
 }
 
-static Fixture *fixture_create(SFun fun, int ischecked)
+static Fixture *fixture_create(TCase * tc, SFun fun, int ischecked)
 {
     Fixture *f;
 
-    f = (Fixture *)emalloc(sizeof(Fixture));
+    f = (Fixture *)arena_alloc(tc->arena, sizeof(Fixture));
     f->fun = fun;
     f->ischecked = ischecked;
 
@@ -222,10 +351,10 @@ static void tcase_add_fixture(TCase * tc, SFun setup, SFun teardown,
     {
         if(ischecked)
             check_list_add_end(tc->ch_sflst,
-                               fixture_create(setup, ischecked));
+                               fixture_create(tc, setup, ischecked));
         else
             check_list_add_end(tc->unch_sflst,
-                               fixture_create(setup, ischecked));
+                               fixture_create(tc, setup, ischecked));
     }
 
     /* Add teardowns at front so they are run in reverse order. */
@@ -233,10 +362,10 @@ static void tcase_add_fixture(TCase * tc, SFun setup, SFun teardown,
     {
         if(ischecked)
             check_list_add_front(tc->ch_tflst,
-                                 fixture_create(teardown, ischecked));
+                                 fixture_create(tc, teardown, ischecked));
         else
             check_list_add_front(tc->unch_tflst,
-                                 fixture_create(teardown, ischecked));
+                                 fixture_create(tc, teardown, ischecked));
     }
 }
 
@@ -245,19 +374,7 @@ void tcase_set_timeout(TCase * tc, double timeout)
 #if defined(HAVE_FORK)
     if(timeout >= 0)
     {
-        char *env = getenv("CK_TIMEOUT_MULTIPLIER");
-
-        if(env != NULL)
-        {
-            char *endptr = NULL;
-            double tmp = strtod(env, &endptr);
-
-            if(tmp >= 0 && endptr != env && (*endptr) == '\0')
-            {
-                timeout = timeout * tmp;
-            }
-        }
-
+        timeout = timeout * timeout_multiplier();
         tc->timeout.tv_sec = (time_t) floor(timeout);
         tc->timeout.tv_nsec =
             (long)((timeout - floor(timeout)) * (double)NANOS_PER_SECONDS);
@@ -271,16 +388,453 @@ void tcase_set_timeout(TCase * tc, double timeout)
 #endif /* HAVE_FORK */
 }
 
+void tcase_set_independent(TCase * tc, int independent)
+{
+    tc->independent = independent != 0;
+}
+
+void tcase_set_memory_limit(TCase * tc, size_t bytes)
+{
+#if defined(HAVE_FORK)
+    tc->memory_limit = bytes;
+#else
+    (void)tc;
+    (void)bytes;
+    eprintf
+        ("This version does not support memory limits, as fork is not supported",
+         __FILE__, __LINE__);
+#endif /* HAVE_FORK */
+}
+
+void tcase_set_cpu_limit(TCase * tc, double seconds)
+{
+#if defined(HAVE_FORK)
+    if(seconds >= 0)
+    {
+        seconds = seconds * timeout_multiplier();
+        tc->cpu_limit = seconds;
+    }
+#else
+    (void)tc;
+    (void)seconds;
+    eprintf
+        ("This version does not support CPU limits, as fork is not supported",
+         __FILE__, __LINE__);
+#endif /* HAVE_FORK */
+}
+
+/* set while a benchmark calls its body, so that the points it passes
+   are not sent on every call */
+static int in_bench = 0;
+
 void tcase_fn_start(const char *fname CK_ATTRIBUTE_UNUSED, const char *file,
                     int line)
 {
+    in_bench = 0;
+    /* a scope left open by a test that failed in nofork mode */
+    alloc_scope_end(NULL);
     send_ctx_info(CK_CTX_TEST);
     send_loc_info(file, line);
 }
 
 void _mark_point(const char *file, int line)
 {
-    send_loc_info(file, line);
+    if(!in_bench)
+        send_loc_info(file, line);
+}
+
+/* The CPU time of the process in nanoseconds, or -1 if it is not known */
+static int64_t bench_cpu_ns(void)
+{
+#if defined(CLOCK_PROCESS_CPUTIME_ID)
+    struct timespec ts;
+
+    if(clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts) == 0)
+        return TIMESPEC_IN_NSEC(ts);
+#endif
+    return -1;
+}
+
+/* Time iterations calls of fn, storing the CPU time they took in cpu_ns,
+   -1 if it is not known, unless it is NULL */
+static int64_t bench_batch(TFun fn, int i, int64_t iterations,
+                           int64_t * cpu_ns)
+{
+    struct timespec ts_start, ts_end;
+    int64_t cpu_start = cpu_ns != NULL ? bench_cpu_ns() : -1;
+    int64_t n;
+
+    clock_gettime(check_get_clockid(), &ts_start);
+    for(n = 0; n < iterations; n++)
+        fn(i);
+    clock_gettime(check_get_clockid(), &ts_end);
+    if(cpu_ns != NULL)
+        *cpu_ns = cpu_start >= 0 ? bench_cpu_ns() - cpu_start : -1;
+    return DIFF_IN_NSEC(ts_start, ts_end);
+}
+
+/*
+ * Run the body of a benchmark. The number of calls in a sample is
+ * grown until a sample takes its share of CK_BENCH_TIME, which also
+ * warms up the caches, and then CK_BENCH_SAMPLES samples are timed.
+ */
+void _ck_run_bench(TFun fn, int i)
+{
+    double seconds = 0.5;
+    int nsamples = 100;
+    int64_t sample_ns;
+    int64_t iterations = 1;
+    int64_t t;
+    /* not allocated, as a failed assertion may leave this function */
+    int64_t samples[BENCH_MAX_SAMPLES];
+    int64_t cpu_samples[BENCH_MAX_SAMPLES];
+    int64_t cpu_ns;
+    int cpu_known = 1;
+    char *env;
+    int s;
+
+    env = getenv("CK_BENCH_TIME");
+    if(env != NULL && atof(env) > 0)
+        seconds = atof(env);
+    env = getenv("CK_BENCH_SAMPLES");
+    if(env != NULL)
+        nsamples = atoi(env);
+    if(nsamples < 2)
+        nsamples = 2;
+    else if(nsamples > BENCH_MAX_SAMPLES)
+        nsamples = BENCH_MAX_SAMPLES;
+    sample_ns = (int64_t)(seconds * NANOS_PER_SECONDS / nsamples);
+
+    in_bench = 1;
+    while((t = bench_batch(fn, i, iterations, NULL)) < sample_ns)
+    {
+        if(t <= sample_ns / 10)
+            iterations *= 10;
+        else
+            iterations = iterations * sample_ns / t + 1;
+    }
+
+    for(s = 0; s < nsamples; s++)
+    {
+        samples[s] = bench_batch(fn, i, iterations, &cpu_ns) * 1000 /
+            iterations;
+        if(cpu_ns < 0)
+            cpu_known = 0;
+        cpu_samples[s] = cpu_ns * 1000 / iterations;
+    }
+    in_bench = 0;
+    send_bench_info(iterations, nsamples, samples,
+                    cpu_known ? cpu_samples : NULL);
+}
+
+int64_t _ck_clock_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(check_get_clockid(), &ts);
+    return (int64_t)ts.tv_sec * NANOS_PER_SECONDS + ts.tv_nsec;
+}
+
+/*
+ * The time to read the clock, as the median of many back to back
+ * reads, to take off the times of the performance assertions.
+ */
+static int64_t clock_overhead(void)
+{
+    static int64_t overhead = -1;
+    int64_t reads[101];
+    int i, j;
+
+    if(overhead >= 0)
+        return overhead;
+    for(i = 0; i < 101; i++)
+    {
+        int64_t t = _ck_clock_ns();
+
+        reads[i] = _ck_clock_ns() - t;
+    }
+    /* sort just enough to find the median */
+    for(i = 0; i <= 50; i++)
+    {
+        for(j = i + 1; j < 101; j++)
+        {
+            if(reads[j] < reads[i])
+            {
+                int64_t t = reads[i];
+
+                reads[i] = reads[j];
+                reads[j] = t;
+            }
+        }
+    }
+    overhead = reads[50];
+    return overhead;
+}
+
+void _ck_assert_duration(int64_t start, int64_t end, int64_t ns,
+                         const char *expr, const char *file, int line)
+{
+    int64_t took = end - start - clock_overhead();
+    char t[2][32];
+
+    if(took < 0)
+        took = 0;
+    if(took <= ns)
+    {
+        _mark_point(file, line);
+        return;
+    }
+    stats_fmt_time(t[0], sizeof(t[0]), (double)took);
+    stats_fmt_time(t[1], sizeof(t[1]), (double)ns);
+    _ck_assert_failed(file, line, expr,
+                      "Assertion '%s' failed: took %s, over %s", expr, t[0],
+                      t[1], NULL);
+}
+
+void _ck_assert_p99_below(void (*fn) (void), int n, int64_t ns,
+                          const char *expr, const char *file, int line)
+{
+    int64_t overhead = clock_overhead();
+    double *samples;
+    double p99;
+    char msg[BUFSIZ];
+    char t[6][32];
+    int i;
+
+    if(n < 1)
+        n = 1;
+    samples = (double *)emalloc(n * sizeof(double));
+    for(i = 0; i < n; i++)
+    {
+        int64_t start = _ck_clock_ns();
+        int64_t took;
+
+        fn();
+        took = _ck_clock_ns() - start - overhead;
+        samples[i] = took < 0 ? 0 : (double)took;
+    }
+    stats_sort(samples, n);
+    p99 = stats_percentile(samples, n, 99);
+    if(p99 <= ns)
+    {
+        free(samples);
+        _mark_point(file, line);
+        return;
+    }
+    stats_fmt_time(t[0], sizeof(t[0]), p99);
+    stats_fmt_time(t[1], sizeof(t[1]), (double)ns);
+    stats_fmt_time(t[2], sizeof(t[2]), samples[0]);
+    stats_fmt_time(t[3], sizeof(t[3]), stats_percentile(samples, n, 50));
+    stats_fmt_time(t[4], sizeof(t[4]), stats_percentile(samples, n, 90));
+    stats_fmt_time(t[5], sizeof(t[5]), samples[n - 1]);
+    /* the message is put together first, as a failure does not return */
+    snprintf(msg, sizeof(msg), "Assertion '%s' failed: p99 %s, over %s; "
+             "min %s, median %s, p90 %s, max %s of %d calls", expr, t[0],
+             t[1], t[2], t[3], t[4], t[5], n);
+    free(samples);
+    _ck_assert_failed(file, line, expr, "%s", msg, NULL);
+}
+
+/* The least time, in nanoseconds, of a batch of calls measuring the
+   complexity of a function */
+#define COMPLEXITY_BATCH_NS 200000
+#define COMPLEXITY_BATCHES 5
+
+/*
+ * The cost of one call of fn(n): the least over a few batches of the
+ * instructions, or of the time, the calls of a batch took.
+ */
+static double complexity_cost(void (*fn) (size_t), size_t n,
+                              PerfCounters * pc)
+{
+    int64_t overhead = clock_overhead();
+    double best = -1;
+    int64_t batch = 1;
+    int64_t i;
+    int b;
+
+    /* grow the batch until it takes long enough to time */
+    for(;;)
+    {
+        int64_t start = _ck_clock_ns();
+
+        for(i = 0; i < batch; i++)
+            fn(n);
+        if(_ck_clock_ns() - start >= COMPLEXITY_BATCH_NS || batch >= 1 << 30)
+            break;
+        batch *= 2;
+    }
+
+    for(b = 0; b < COMPLEXITY_BATCHES; b++)
+    {
+        double cost;
+
+        if(pc != NULL)
+        {
+            PerfSample *ps;
+
+            perf_counters_start(pc);
+            for(i = 0; i < batch; i++)
+                fn(n);
+            ps = perf_counters_stop(pc);
+            cost = (double)ps->values[0];
+            free(ps);
+        }
+        else
+        {
+            int64_t start = _ck_clock_ns();
+
+            for(i = 0; i < batch; i++)
+                fn(n);
+            cost = (double)(_ck_clock_ns() - start - overhead);
+        }
+        cost = cost < 0 ? 0 : cost / batch;
+        if(best < 0 || cost < best)
+            best = cost;
+    }
+    return best;
+}
+
+void _ck_assert_complexity(void (*fn) (size_t), void (*setup) (size_t),
+                           const size_t * sizes, enum ck_complexity bound,
+                           const char *expr, const char *file, int line)
+{
+    PerfCounters *pc = perf_counters_open("instructions");
+    enum ck_complexity fit;
+    double *ns;
+    double *costs;
+    double rms;
+    char msg[BUFSIZ];
+    size_t len;
+    int count, i;
+
+    /* only count instructions, not the time the fallback counts */
+    if(pc != NULL)
+    {
+        PerfSample *ps;
+
+        perf_counters_start(pc);
+        ps = perf_counters_stop(pc);
+        if(strcmp(ps->names[0], "instructions") != 0 || ps->values[0] < 0)
+        {
+            perf_counters_close(pc);
+            pc = NULL;
+        }
+        free(ps);
+    }
+
+    for(count = 0; sizes[count] != 0; count++)
+        ;
+    if(count < 2)
+    {
+        if(pc != NULL)
+            perf_counters_close(pc);
+        _ck_assert_failed(file, line, expr,
+                          "Assertion '%s' failed: needs at least 2 sizes, "
+                          "got %d", expr, count, NULL);
+    }
+
+    ns = (double *)emalloc(count * sizeof(double));
+    costs = (double *)emalloc(count * sizeof(double));
+    for(i = 0; i < count; i++)
+    {
+        if(setup != NULL)
+            setup(sizes[i]);
+        ns[i] = (double)sizes[i];
+        costs[i] = complexity_cost(fn, sizes[i], pc);
+    }
+    fit = stats_fit_complexity(ns, costs, count, &rms);
+
+    if(fit <= bound)
+    {
+        free(ns);
+        free(costs);
+        if(pc != NULL)
+            perf_counters_close(pc);
+        _mark_point(file, line);
+        return;
+    }
+
+    /* the message is put together first, as a failure does not return */
+    len = snprintf(msg, sizeof(msg),
+                   "Assertion '%s' failed: fits %s (error %.1f%%), over %s;",
+                   expr, stats_complexity_name(fit), rms * 100,
+                   stats_complexity_name(bound));
+    for(i = 0; i < count && len < sizeof(msg); i++)
+    {
+        char t[32];
+
+        if(pc != NULL)
+            snprintf(t, sizeof(t), "%.0f instructions", costs[i]);
+        else
+            stats_fmt_time(t, sizeof(t), costs[i]);
+        len += snprintf(msg + len, sizeof(msg) - len, " n=%lu: %s%s",
+                        (unsigned long)sizes[i], t,
+                        i + 1 < count ? "," : "");
+    }
+    free(ns);
+    free(costs);
+    if(pc != NULL)
+        perf_counters_close(pc);
+    _ck_assert_failed(file, line, expr, "%s", msg, NULL);
+}
+
+void ck_alloc_scope_begin(void)
+{
+    alloc_scope_begin();
+}
+
+void _ck_assert_alloc_scope_end(int64_t max_allocs, int64_t max_bytes,
+                                const char *file, int line)
+{
+    AllocScope sc;
+    int64_t bytes = 0;
+    char msg[BUFSIZ];
+    char budget[64];
+    size_t len;
+    int i;
+
+    if(!alloc_scope_end(&sc) ||
+       ((max_allocs < 0 || sc.allocs <= max_allocs) &&
+        (max_bytes < 0 || sc.bytes <= max_bytes)))
+    {
+        _mark_point(file, line);
+        return;
+    }
+
+    /* the first allocation that went over the budget */
+    for(i = 0; i < sc.ntraces; i++)
+    {
+        bytes += sc.sizes[i];
+        if((max_allocs >= 0 && i >= max_allocs) ||
+           (max_bytes >= 0 && bytes > max_bytes))
+            break;
+    }
+
+    if(max_allocs >= 0 && max_bytes >= 0)
+        snprintf(budget, sizeof(budget), "%jd allocations and %jd bytes",
+                 (intmax_t)max_allocs, (intmax_t)max_bytes);
+    else if(max_allocs >= 0)
+        snprintf(budget, sizeof(budget), "%jd allocations",
+                 (intmax_t)max_allocs);
+    else
+        snprintf(budget, sizeof(budget), "%jd bytes", (intmax_t)max_bytes);
+    len = snprintf(msg, sizeof(msg), "Allocation scope made %jd allocations "
+                   "of %jd bytes, over the budget of %s; ",
+                   (intmax_t)sc.allocs, (intmax_t)sc.bytes, budget);
+    if(i < sc.ntraces)
+    {
+        len += snprintf(msg + len, sizeof(msg) - len,
+                        "allocation %d of %lu bytes went over it", i + 1,
+                        (unsigned long)sc.sizes[i]);
+        /* keep the message within what a message can carry */
+        if(len < 1024)
+            alloc_scope_describe(&sc, i, msg + len, 1024 - len);
+    }
+    else
+        snprintf(msg + len, sizeof(msg) - len,
+                 "allocation %d went over it, after those traced", i + 1);
+    _ck_assert_failed(file, line, "Allocation scope", "%s", msg, NULL);
 }
 
 void _ck_assert_failed(const char *file, int line, const char *expr, ...)
@@ -289,7 +843,10 @@ void _ck_assert_failed(const char *file, int line, const char *expr, ...)
     va_list ap;
     char buf[BUFSIZ];
     const char *to_send;
+    jmp_buf *jmp;
 
+    in_bench = 0;
+    alloc_scope_end(NULL);
     send_loc_info(file, line);
 
     va_start(ap, expr);
@@ -311,9 +868,17 @@ void _ck_assert_failed(const char *file, int line, const char *expr, ...)
 
     va_end(ap);
     send_failure_info(to_send);
-    if(cur_fork_status() == CK_FORK)
+    jmp = thread_error_jmp_buffer();
+    if(jmp != NULL)
+    {
+        /* a fixture run ahead in a thread of its own */
+        longjmp(*jmp, 1);
+    }
+    else if(cur_fork_status() == CK_FORK)
     {
 #if defined(HAVE_FORK) && HAVE_FORK==1
+        /* the time the test process was done, for its reap phase */
+        send_duration_info(-1, -1, -1, _ck_clock_ns());
         _exit(1);
 #endif /* HAVE_FORK */
     }
@@ -325,18 +890,55 @@ void _ck_assert_failed(const char *file, int line, const char *expr, ...)
 
 SRunner *srunner_create(Suite * s)
 {
-    SRunner *sr = (SRunner *)emalloc(sizeof(SRunner));     /* freed in srunner_free */
+    /* the runner and what it allocates are freed with the arena */
+    Arena *arena = arena_create();
+    SRunner *sr = (SRunner *)arena_alloc(arena, sizeof(SRunner));
+    int i;
 
+    sr->arena = arena;
+    sr->test_arena = arena_create();
     sr->slst = check_list_create();
     if(s != NULL)
         check_list_add_end(sr->slst, s);
-    sr->stats = (TestStats *)emalloc(sizeof(TestStats));     /* freed in srunner_free */
+    sr->stats = (TestStats *)arena_alloc(arena, sizeof(TestStats));
     sr->stats->n_checked = sr->stats->n_failed = sr->stats->n_errors = 0;
     sr->resultlst = check_list_create();
+    sr->sflst = check_list_create();
+    sr->tflst = check_list_create();
+    sr->pipelined_setup = -1;
+    sr->ahead = NULL;
+    for(i = 0; i < NPHASES; i++)
+        sr->phases[i] = 0;
+    sr->run_start = 0;
+    sr->run_ns = 0;
+    sr->phase_summary = -1;
     sr->log_fname = NULL;
     sr->xml_fname = NULL;
     sr->tap_fname = NULL;
+    sr->junit_fname = NULL;
+    sr->jsonl_fname = NULL;
+    sr->binlog_fname = NULL;
+    sr->bench_json_fname = NULL;
+    sr->baseline_save_fname = NULL;
     sr->loglst = NULL;
+    sr->flush_interval = -1;
+    sr->logq = NULL;
+    sr->streaming = -1;
+    sr->strs = strtab_create(sr->arena);
+    sr->perf_spec = NULL;
+    sr->perf = NULL;
+    sr->baseline_fname = NULL;
+    sr->baseline_threshold = -1;
+    sr->baseline = NULL;
+    sr->alloc_tracking = -1;
+    for(i = 0; i < ALLOC_NSTATS; i++)
+        sr->alloc_limits[i] = -2;
+    sr->timeout_clock = CK_TIMEOUT_CLOCK_GETENV;
+    sr->timeout_ceiling = -1;
+    sr->history_fname = NULL;
+    sr->history_factor = DEFAULT_HISTORY_FACTOR;
+    sr->history_floor = DEFAULT_HISTORY_FLOOR;
+    sr->history = NULL;
 
 #if defined(HAVE_FORK)
     sr->fstat = CK_FORK_GETENV;
@@ -359,31 +961,70 @@ void srunner_add_suite(SRunner * sr, Suite * s)
     check_list_add_end(sr->slst, s);
 }
 
+void srunner_add_fixture(SRunner * sr, SFun setup, SFun teardown)
+{
+    Fixture *f;
+
+    if(sr == NULL)
+        return;
+
+    if(setup)
+    {
+        f = (Fixture *)arena_alloc(sr->arena, sizeof(Fixture));
+        f->fun = setup;
+        f->ischecked = 0;
+        check_list_add_end(sr->sflst, f);
+    }
+
+    /* Add teardowns at front so they are run in reverse order. */
+    if(teardown)
+    {
+        f = (Fixture *)arena_alloc(sr->arena, sizeof(Fixture));
+        f->fun = teardown;
+        f->ischecked = 0;
+        check_list_add_front(sr->tflst, f);
+    }
+}
+
 void srunner_free(SRunner * sr)
 {
     List *l;
-    TestResult *tr;
 
     if(sr == NULL)
         return;
 
-    free(sr->stats);
     l = sr->slst;
     for(check_list_front(l); !check_list_at_end(l); check_list_advance(l))
     {
         suite_free((Suite *)check_list_val(l));
     }
     check_list_free(sr->slst);
+    check_list_free(sr->sflst);
+    check_list_free(sr->tflst);
 
-    l = sr->resultlst;
-    for(check_list_front(l); !check_list_at_end(l); check_list_advance(l))
-    {
-        tr = (TestResult *)check_list_val(l);
-        tr_free(tr);
-    }
+    /* the results are all in the arena */
     check_list_free(sr->resultlst);
+    strtab_free(sr->strs);
+    arena_free(sr->test_arena);
+    arena_free(sr->arena);
+}
 
-    free(sr);
+int srunner_allocs_saved(SRunner * sr)
+{
+    unsigned long saved;
+    List *sl;
+
+    saved = arena_allocs_saved(sr->arena) + arena_allocs_saved(sr->test_arena);
+    sl = sr->slst;
+    for(check_list_front(sl); !check_list_at_end(sl); check_list_advance(sl))
+    {
+        List *tcl = ((Suite *)check_list_val(sl))->tclst;
+
+        for(check_list_front(tcl); !check_list_at_end(tcl);
+            check_list_advance(tcl))
+            saved += arena_allocs_saved(((TCase *)check_list_val(tcl))->arena);
+    }
+    return (int)saved;
 }
 
 int srunner_ntests_failed(SRunner * sr)
@@ -431,9 +1072,175 @@ TestResult **srunner_results(SRunner * sr)
     {
         trarray[i++] = (TestResult *)check_list_val(rlst);
     }
+    /* passed tests not kept in streaming mode */
+    while(i < srunner_ntests_run(sr))
+        trarray[i++] = NULL;
     return trarray;
 }
 
+void srunner_set_streaming(SRunner * sr, int streaming)
+{
+    sr->streaming = streaming != 0;
+}
+
+int srunner_streaming(SRunner * sr)
+{
+    char *env;
+
+    if(sr->streaming >= 0)
+        return sr->streaming;
+
+    env = getenv("CK_STREAMING");
+    return env != NULL && strcmp(env, "yes") == 0;
+}
+
+void srunner_set_pipelined_setup(SRunner * sr, int pipelined)
+{
+    sr->pipelined_setup = pipelined != 0;
+}
+
+int srunner_pipelined_setup(SRunner * sr)
+{
+    char *env;
+
+    if(sr->pipelined_setup >= 0)
+        return sr->pipelined_setup;
+
+    env = getenv("CK_PIPELINED_SETUP");
+    return env != NULL && strcmp(env, "yes") == 0;
+}
+
+int64_t srunner_phase_ns(SRunner * sr, enum ck_phase phase)
+{
+    if((int)phase < 0 || phase >= NPHASES)
+        return 0;
+    return sr->phases[phase];
+}
+
+void srunner_set_phase_summary(SRunner * sr, int summary)
+{
+    sr->phase_summary = summary != 0;
+}
+
+int srunner_phase_summary(SRunner * sr)
+{
+    char *env;
+
+    if(sr->phase_summary >= 0)
+        return sr->phase_summary;
+
+    env = getenv("CK_PHASE_SUMMARY");
+    return env != NULL && strcmp(env, "yes") == 0;
+}
+
+void srunner_set_perf_counters(SRunner * sr, const char *events)
+{
+    sr->perf_spec = events;
+}
+
+const char *srunner_perf_counters(SRunner * sr)
+{
+    const char *events = sr->perf_spec;
+
+    if(events == NULL)
+        events = getenv("CK_PERF_COUNTERS");
+    return events == NULL || events[0] == '\0' ? NULL : events;
+}
+
+void srunner_set_baseline(SRunner * sr, const char *fname)
+{
+    sr->baseline_fname = fname;
+}
+
+const char *srunner_baseline_fname(SRunner * sr)
+{
+    const char *fname = sr->baseline_fname;
+
+    if(fname == NULL)
+        fname = getenv("CK_BASELINE");
+    return fname == NULL || fname[0] == '\0' ? NULL : fname;
+}
+
+void srunner_set_baseline_threshold(SRunner * sr, double percent)
+{
+    sr->baseline_threshold = percent;
+}
+
+double srunner_baseline_threshold(SRunner * sr)
+{
+    char *env;
+
+    if(sr->baseline_threshold >= 0)
+        return sr->baseline_threshold;
+
+    env = getenv("CK_BASELINE_THRESHOLD");
+    if(env != NULL)
+    {
+        char *endptr = NULL;
+        double tmp = strtod(env, &endptr);
+
+        if(tmp >= 0 && endptr != env && (*endptr) == '\0')
+            return tmp;
+    }
+    return DEFAULT_BASELINE_THRESHOLD;
+}
+
+void srunner_set_alloc_tracking(SRunner * sr, int track)
+{
+    sr->alloc_tracking = track != 0;
+}
+
+int srunner_alloc_tracking(SRunner * sr)
+{
+    char *env;
+
+    if(sr->alloc_tracking >= 0)
+        return sr->alloc_tracking;
+
+    env = getenv("CK_ALLOC_TRACKING");
+    return env != NULL && strcmp(env, "yes") == 0;
+}
+
+void srunner_set_alloc_limit(SRunner * sr, enum ck_alloc_stat stat,
+                             int64_t limit)
+{
+    if((int)stat < 0 || stat >= ALLOC_NSTATS)
+        eprintf("Bad allocation count in srunner_set_alloc_limit", __FILE__,
+                __LINE__);
+    sr->alloc_limits[stat] = limit < 0 ? -1 : limit;
+}
+
+int64_t srunner_alloc_limit(SRunner * sr, enum ck_alloc_stat stat)
+{
+    const char *env;
+    size_t len;
+
+    if((int)stat < 0 || stat >= ALLOC_NSTATS)
+        return -1;
+    if(sr->alloc_limits[stat] >= -1)
+        return sr->alloc_limits[stat];
+
+    /* look for name=limit in the list */
+    env = getenv("CK_ALLOC_LIMITS");
+    len = strlen(alloc_stat_names[stat]);
+    while(env != NULL && *env != '\0')
+    {
+        if(strncmp(env, alloc_stat_names[stat], len) == 0 && env[len] == '=')
+        {
+            char *endptr = NULL;
+            long long tmp = strtoll(env + len + 1, &endptr, 10);
+
+            if(tmp >= 0 && endptr != env + len + 1 &&
+               (*endptr == ',' || *endptr == '\0'))
+                return tmp;
+        }
+        env = strchr(env, ',');
+        if(env != NULL)
+            env++;
+    }
+    return stat == CK_ALLOC_LEAKS ? 0 : -1;
+}
+
 static int non_pass(int val)
 {
     return val != CK_PASS;
@@ -450,23 +1257,81 @@ TestResult *tr_create(void)
 
 static void tr_init(TestResult * tr)
 {
+    int i;
+
     tr->ctx = CK_CTX_INVALID;
     tr->line = -1;
+    tr->iter = 0;
     tr->rtype = CK_TEST_RESULT_INVALID;
     tr->msg = NULL;
     tr->file = NULL;
     tr->tcname = NULL;
     tr->tname = NULL;
     tr->duration = -1;
+    tr->utime = -1;
+    tr->stime = -1;
+    tr->rusage.maxrss = -1;
+    tr->rusage.minflt = -1;
+    tr->rusage.majflt = -1;
+    tr->rusage.nvcsw = -1;
+    tr->rusage.nivcsw = -1;
+    tr->rusage.inblock = -1;
+    tr->rusage.oublock = -1;
+    tr->perf = NULL;
+    tr->bench = NULL;
+    alloc_stats_reset(&tr->allocs);
+    for(i = 0; i < NPHASES; i++)
+        tr->phases[i] = -1;
 }
 
 void tr_free(TestResult * tr)
 {
-    free(tr->file);
-    free(tr->msg);
+    free((char *)tr->file);
+    if(tr->msg != pass_msg)
+        free(tr->msg);
+    free(tr->perf);
+    bench_result_free(tr->bench);
     free(tr);
 }
 
+char *tr_pass_msg(void)
+{
+    return pass_msg;
+}
+
+TestResult *srunner_store_result(SRunner * sr, TestResult * tr)
+{
+    TestResult *kept = (TestResult *)arena_alloc(sr->arena, sizeof(TestResult));
+
+    *kept = *tr;
+    kept->file = strtab_intern(sr->strs, tr->file);
+    if(tr->msg != NULL && tr->msg != pass_msg)
+        kept->msg = arena_strdup(sr->arena, tr->msg);
+    if(tr->perf != NULL)
+    {
+        kept->perf = (PerfSample *)arena_alloc(sr->arena, sizeof(PerfSample));
+        *kept->perf = *tr->perf;
+    }
+    if(tr->bench != NULL)
+    {
+        size_t size = tr->bench->nsamples * sizeof(double);
+
+        kept->bench = (BenchResult *)arena_alloc(sr->arena,
+                                                 sizeof(BenchResult));
+        *kept->bench = *tr->bench;
+        kept->bench->samples = (double *)arena_alloc(sr->arena, size);
+        memcpy(kept->bench->samples, tr->bench->samples, size);
+        if(tr->bench->cpu_samples != NULL)
+        {
+            kept->bench->cpu_samples =
+                (double *)arena_alloc(sr->arena, size);
+            memcpy(kept->bench->cpu_samples, tr->bench->cpu_samples, size);
+        }
+    }
+    tr_free(tr);
+    return kept;
+}
+
 
 const char *tr_msg(TestResult * tr)
 {
@@ -490,7 +1355,7 @@ int tr_rtype(TestResult * tr)
 
 enum ck_result_ctx tr_ctx(TestResult * tr)
 {
-    return tr->ctx;
+    return (enum ck_result_ctx)tr->ctx;
 }
 
 const char *tr_tcname(TestResult * tr)
@@ -498,6 +1363,62 @@ const char *tr_tcname(TestResult * tr)
     return tr->tcname;
 }
 
+int64_t tr_duration_ns(TestResult * tr)
+{
+    return tr->duration;
+}
+
+int64_t tr_utime_ns(TestResult * tr)
+{
+    return tr->utime;
+}
+
+int64_t tr_stime_ns(TestResult * tr)
+{
+    return tr->stime;
+}
+
+int64_t tr_perf_counter(TestResult * tr, const char *name)
+{
+    int i;
+
+    if(tr->perf == NULL)
+        return -1;
+    for(i = 0; i < tr->perf->n; i++)
+    {
+        if(strcmp(tr->perf->names[i], name) == 0)
+            return tr->perf->values[i];
+    }
+    return -1;
+}
+
+double tr_bench_stat(TestResult * tr, enum ck_bench_stat stat)
+{
+    double values[BENCH_NSTATS];
+
+    if(tr->bench == NULL || (int)stat < 0 || stat >= BENCH_NSTATS)
+        return -1;
+    bench_stat_values(tr->bench, values);
+    return values[stat];
+}
+
+int64_t tr_alloc_stat(TestResult * tr, enum ck_alloc_stat stat)
+{
+    int64_t values[ALLOC_NSTATS];
+
+    if((int)stat < 0 || stat >= ALLOC_NSTATS)
+        return -1;
+    alloc_stat_values(&tr->allocs, values);
+    return values[stat];
+}
+
+int64_t tr_phase_ns(TestResult * tr, enum ck_phase phase)
+{
+    if((int)phase < 0 || phase >= NPHASES)
+        return -1;
+    return tr->phases[phase];
+}
+
 static enum fork_status _fstat = CK_FORK;
 
 void set_fork_status(enum fork_status fstat)
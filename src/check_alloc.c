@@ -0,0 +1,580 @@
+/*
+ * Check: a unit test framework for C
+ * Copyright (C) 2001, 2002 Arien Malec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "../lib/libcompat.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#if defined(HAVE_EXECINFO_H)
+#include <execinfo.h>
+#endif
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#include <sys/mman.h>
+#if defined(MAP_ANONYMOUS)
+#define CK_ALLOC_FAILURE_WATCH 1
+#endif
+#endif
+
+#include "check.h"
+#include "check_error.h"
+#include "check_list.h"
+#include "check_impl.h"
+#include "check_alloc.h"
+
+const char *const alloc_stat_names[ALLOC_NSTATS] = {
+    "allocs", "bytes", "peak_bytes", "leaks", "leaked_bytes"
+};
+
+void alloc_stat_values(const TestAllocs * ta, int64_t * values)
+{
+    values[CK_ALLOC_COUNT] = ta->allocs;
+    values[CK_ALLOC_BYTES] = ta->bytes;
+    values[CK_ALLOC_PEAK_BYTES] = ta->peak_bytes;
+    values[CK_ALLOC_LEAKS] = ta->leaks;
+    values[CK_ALLOC_LEAKED_BYTES] = ta->leaked_bytes;
+}
+
+void alloc_stats_reset(TestAllocs * ta)
+{
+    ta->allocs = -1;
+    ta->bytes = -1;
+    ta->peak_bytes = -1;
+    ta->leaks = -1;
+    ta->leaked_bytes = -1;
+}
+
+#if defined(HAVE___LIBC_MALLOC)
+
+/* the allocator of the GNU C library, under the names it exports */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void *__libc_valloc(size_t size);
+extern void *__libc_pvalloc(size_t size);
+
+/* replaced below, and not declared by stdlib.h in every mode */
+void *reallocarray(void *ptr, size_t nmemb, size_t size);
+void *memalign(size_t alignment, size_t size);
+void *aligned_alloc(size_t alignment, size_t size);
+void *valloc(size_t size);
+void *pvalloc(size_t size);
+
+#ifndef HAVE_PTHREAD
+#define pthread_mutex_lock(arg)
+#define pthread_mutex_unlock(arg)
+#else
+static pthread_mutex_t alloc_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+typedef struct LiveBlock
+{
+    void *ptr;                  /* NULL for an empty slot */
+    size_t size;
+} LiveBlock;
+
+/* a table of the blocks live, with linear probing; it is allocated
+   with the C library's allocator, so that it is not tracked itself */
+static LiveBlock *live;
+static size_t live_size;        /* slots, a power of two */
+static size_t live_n;
+static size_t live_bytes;
+
+static int tracking;
+static int paused;
+static TestAllocs counts;
+
+static int in_scope;
+static AllocScope scope;
+#if defined(HAVE_PTHREAD)
+/* the thread whose allocations the scope counts, so that those of
+   Check's own threads, such as the logging thread, are left out */
+static pthread_t scope_thread;
+#endif
+
+#if defined(CK_ALLOC_FAILURE_WATCH)
+/* a page shared with the children forked by watch_pid, where the first
+   of them to fail an allocation writes its size */
+static volatile size_t *failed_size;
+static pid_t watch_pid;
+#endif
+
+static void note_failure(size_t size)
+{
+#if defined(CK_ALLOC_FAILURE_WATCH)
+    if(failed_size != NULL && *failed_size == 0)
+        *failed_size = size;
+#else
+    (void)size;
+#endif
+}
+
+static size_t live_hash(void *ptr)
+{
+    uint64_t h = (uint64_t)(uintptr_t) ptr;
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (size_t)h & (live_size - 1);
+}
+
+static int live_grow(void)
+{
+    LiveBlock *old = live;
+    size_t old_size = live_size;
+    size_t i;
+
+    live_size = old_size == 0 ? 1024 : old_size * 2;
+    live = (LiveBlock *)__libc_calloc(live_size, sizeof(LiveBlock));
+    if(live == NULL)
+    {
+        live = old;
+        live_size = old_size;
+        return 0;
+    }
+    for(i = 0; i < old_size; i++)
+    {
+        if(old[i].ptr != NULL)
+        {
+            size_t j = live_hash(old[i].ptr);
+
+            while(live[j].ptr != NULL)
+                j = (j + 1) & (live_size - 1);
+            live[j] = old[i];
+        }
+    }
+    __libc_free(old);
+    return 1;
+}
+
+static void live_add(void *ptr, size_t size)
+{
+    size_t i;
+
+    counts.allocs++;
+    counts.bytes += size;
+    /* keep at most half the slots full */
+    if(2 * (live_n + 1) > live_size && !live_grow())
+        return;
+    i = live_hash(ptr);
+    while(live[i].ptr != NULL)
+        i = (i + 1) & (live_size - 1);
+    live[i].ptr = ptr;
+    live[i].size = size;
+    live_n++;
+    live_bytes += size;
+    if((int64_t)live_bytes > counts.peak_bytes)
+        counts.peak_bytes = live_bytes;
+}
+
+static void live_remove(void *ptr)
+{
+    size_t i, j;
+
+    if(live_size == 0)
+        return;
+    for(i = live_hash(ptr); live[i].ptr != ptr; i = (i + 1) & (live_size - 1))
+    {
+        if(live[i].ptr == NULL)
+            return;
+    }
+    live_n--;
+    live_bytes -= live[i].size;
+    live[i].ptr = NULL;
+
+    /* move back the blocks after it that would not be found past the
+       empty slot */
+    for(j = (i + 1) & (live_size - 1); live[j].ptr != NULL;
+        j = (j + 1) & (live_size - 1))
+    {
+        size_t home = live_hash(live[j].ptr);
+
+        if(((j - home) & (live_size - 1)) >= ((j - i) & (live_size - 1)))
+        {
+            live[i] = live[j];
+            live[j].ptr = NULL;
+            i = j;
+        }
+    }
+}
+
+/*
+ * Count an allocation in the scope, made from caller. The backtrace is
+ * taken before the lock, as backtrace() may take locks of its own.
+ */
+static void scope_add(size_t size, void *caller)
+{
+    void *frames[ALLOC_SCOPE_FRAMES + 4];
+    int first = 0;
+    int nframes = 0;
+
+#if defined(HAVE_EXECINFO_H)
+    if(scope.ntraces < ALLOC_SCOPE_TRACES && !paused)
+    {
+        nframes = backtrace(frames, ALLOC_SCOPE_FRAMES + 4);
+        /* start from the caller of malloc() */
+        while(first < nframes && first < 4 && frames[first] != caller)
+            first++;
+        if(first == nframes || first == 4)
+            first = 0;
+        nframes -= first;
+        if(nframes > ALLOC_SCOPE_FRAMES)
+            nframes = ALLOC_SCOPE_FRAMES;
+    }
+#else
+    (void)caller;
+#endif
+    pthread_mutex_lock(&alloc_lock);
+    if(in_scope && !paused)
+    {
+        int i = scope.ntraces;
+
+        if(i < ALLOC_SCOPE_TRACES)
+        {
+            scope.sizes[i] = size;
+            scope.nframes[i] = nframes;
+            memcpy(scope.frames[i], frames + first,
+                   nframes * sizeof(void *));
+            scope.ntraces++;
+        }
+        scope.allocs++;
+        scope.bytes += size;
+    }
+    pthread_mutex_unlock(&alloc_lock);
+}
+
+/* Whether the calling thread is the one the scope counts */
+static int in_scope_thread(void)
+{
+#if defined(HAVE_PTHREAD)
+    return pthread_equal(pthread_self(), scope_thread);
+#else
+    return 1;
+#endif
+}
+
+/* Count a new block of size bytes at ptr, allocated from caller */
+static void track_add(void *ptr, size_t size, void *caller)
+{
+    if(in_scope && in_scope_thread())
+        scope_add(size, caller);
+    if(tracking)
+    {
+        pthread_mutex_lock(&alloc_lock);
+        if(tracking && !paused)
+            live_add(ptr, size);
+        pthread_mutex_unlock(&alloc_lock);
+    }
+}
+
+/* Count a new block of size bytes at ptr, or its failure, and return it */
+static void *track_new(void *ptr, size_t size, void *caller)
+{
+    if((tracking || in_scope) && ptr != NULL)
+        track_add(ptr, size, caller);
+    else if(ptr == NULL && size != 0)
+        note_failure(size);
+    return ptr;
+}
+
+void *malloc(size_t size)
+{
+    return track_new(__libc_malloc(size), size,
+                     __builtin_return_address(0));
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    void *ptr = __libc_calloc(nmemb, size);
+
+    if((tracking || in_scope) && ptr != NULL)
+        track_add(ptr, nmemb * size, __builtin_return_address(0));
+    else if(ptr == NULL && nmemb != 0 && size != 0)
+        note_failure(nmemb * size);
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    void *moved = __libc_realloc(ptr, size);
+
+    /* on failure the block is left as it was */
+    if(tracking && ptr != NULL && (moved != NULL || size == 0))
+    {
+        pthread_mutex_lock(&alloc_lock);
+        if(tracking && !paused)
+            live_remove(ptr);
+        pthread_mutex_unlock(&alloc_lock);
+    }
+    if((tracking || in_scope) && moved != NULL)
+        track_add(moved, size, __builtin_return_address(0));
+    else if(moved == NULL && size != 0)
+        note_failure(size);
+    return moved;
+}
+
+void *reallocarray(void *ptr, size_t nmemb, size_t size)
+{
+    if(size != 0 && nmemb > (size_t)-1 / size)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return realloc(ptr, nmemb * size);
+}
+
+/*
+ * The aligned allocators of the C library do not go through malloc(),
+ * so they are replaced too, or their blocks would be missed.
+ */
+void *memalign(size_t alignment, size_t size)
+{
+    return track_new(__libc_memalign(alignment, size), size,
+                     __builtin_return_address(0));
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    return track_new(__libc_memalign(alignment, size), size,
+                     __builtin_return_address(0));
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    void *ptr;
+
+    if(alignment % sizeof(void *) != 0 ||
+       (alignment & (alignment - 1)) != 0 || alignment == 0)
+        return EINVAL;
+    ptr = track_new(__libc_memalign(alignment, size), size,
+                    __builtin_return_address(0));
+    if(ptr == NULL && size != 0)
+        return ENOMEM;
+    *memptr = ptr;
+    return 0;
+}
+
+void *valloc(size_t size)
+{
+    return track_new(__libc_valloc(size), size,
+                     __builtin_return_address(0));
+}
+
+void *pvalloc(size_t size)
+{
+    return track_new(__libc_pvalloc(size), size,
+                     __builtin_return_address(0));
+}
+
+void free(void *ptr)
+{
+    if(tracking && ptr != NULL)
+    {
+        pthread_mutex_lock(&alloc_lock);
+        if(tracking && !paused)
+            live_remove(ptr);
+        pthread_mutex_unlock(&alloc_lock);
+    }
+    __libc_free(ptr);
+}
+
+int alloc_track_available(void)
+{
+    return 1;
+}
+
+void alloc_track_start(void)
+{
+    pthread_mutex_lock(&alloc_lock);
+    __libc_free(live);
+    live = NULL;
+    live_size = live_n = live_bytes = 0;
+    counts.allocs = counts.bytes = counts.peak_bytes = 0;
+    paused = 0;
+    tracking = 1;
+    pthread_mutex_unlock(&alloc_lock);
+}
+
+void alloc_track_stop(TestAllocs * ta)
+{
+    pthread_mutex_lock(&alloc_lock);
+    tracking = 0;
+    *ta = counts;
+    ta->leaks = live_n;
+    ta->leaked_bytes = live_bytes;
+    __libc_free(live);
+    live = NULL;
+    live_size = live_n = live_bytes = 0;
+    pthread_mutex_unlock(&alloc_lock);
+}
+
+void alloc_track_pause(void)
+{
+    pthread_mutex_lock(&alloc_lock);
+    paused++;
+    pthread_mutex_unlock(&alloc_lock);
+}
+
+void alloc_track_resume(void)
+{
+    pthread_mutex_lock(&alloc_lock);
+    paused--;
+    pthread_mutex_unlock(&alloc_lock);
+}
+
+void alloc_scope_begin(void)
+{
+#if defined(HAVE_EXECINFO_H)
+    void *frames[1];
+
+    /* the first backtrace() loads what it needs, allocating */
+    alloc_track_pause();
+    backtrace(frames, 1);
+    alloc_track_resume();
+#endif
+    pthread_mutex_lock(&alloc_lock);
+    scope.allocs = scope.bytes = 0;
+    scope.ntraces = 0;
+#if defined(HAVE_PTHREAD)
+    scope_thread = pthread_self();
+#endif
+    in_scope = 1;
+    pthread_mutex_unlock(&alloc_lock);
+}
+
+void alloc_failure_watch(void)
+{
+#if defined(CK_ALLOC_FAILURE_WATCH)
+    /* a page inherited from a runner further up is left to it */
+    if(failed_size == NULL || watch_pid != getpid())
+    {
+        void *page = mmap(NULL, sizeof(size_t), PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+        if(page == MAP_FAILED)
+        {
+            failed_size = NULL;
+            return;
+        }
+        failed_size = (volatile size_t *)page;
+        watch_pid = getpid();
+    }
+    *failed_size = 0;
+#endif /* CK_ALLOC_FAILURE_WATCH */
+}
+
+size_t alloc_failure(void)
+{
+#if defined(CK_ALLOC_FAILURE_WATCH)
+    if(failed_size != NULL && watch_pid == getpid())
+        return *failed_size;
+#endif
+    return 0;
+}
+
+int alloc_scope_end(AllocScope * sc)
+{
+    pthread_mutex_lock(&alloc_lock);
+    in_scope = 0;
+    if(sc != NULL)
+        *sc = scope;
+    pthread_mutex_unlock(&alloc_lock);
+    return 1;
+}
+
+#else /* HAVE___LIBC_MALLOC */
+
+int alloc_track_available(void)
+{
+    return 0;
+}
+
+void alloc_track_start(void)
+{
+}
+
+void alloc_track_stop(TestAllocs * ta)
+{
+    alloc_stats_reset(ta);
+}
+
+void alloc_track_pause(void)
+{
+}
+
+void alloc_track_resume(void)
+{
+}
+
+void alloc_failure_watch(void)
+{
+}
+
+size_t alloc_failure(void)
+{
+    return 0;
+}
+
+void alloc_scope_begin(void)
+{
+}
+
+int alloc_scope_end(AllocScope * sc)
+{
+    if(sc != NULL)
+    {
+        sc->allocs = sc->bytes = 0;
+        sc->ntraces = 0;
+    }
+    return 0;
+}
+
+#endif /* HAVE___LIBC_MALLOC */
+
+void alloc_scope_describe(const AllocScope * sc, int i, char *buf,
+                          size_t size)
+{
+    size_t len = 0;
+
+    buf[0] = '\0';
+#if defined(HAVE_EXECINFO_H)
+    if(i < sc->ntraces && sc->nframes[i] > 0)
+    {
+        char **symbols = backtrace_symbols(sc->frames[i], sc->nframes[i]);
+        int j;
+
+        if(symbols == NULL)
+            return;
+        for(j = 0; j < sc->nframes[i] && len < size; j++)
+            len += snprintf(buf + len, size - len, "%s%s",
+                            j == 0 ? " from " : " <- ", symbols[j]);
+        free(symbols);
+    }
+#else
+    (void)sc;
+    (void)i;
+    (void)size;
+    (void)len;
+#endif /* HAVE_EXECINFO_H */
+}
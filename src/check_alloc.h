@@ -0,0 +1,85 @@
+/*
+ * Check: a unit test framework for C
+ * Copyright (C) 2001, 2002 Arien Malec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef CHECK_ALLOC_H
+#define CHECK_ALLOC_H
+
+/*
+ * Tracking of the heap allocations of a test. With the GNU C library,
+ * libcheck replaces malloc(), calloc(), realloc() and free() with
+ * functions that call the library's own and, while tracking, count the
+ * allocations and remember the blocks still live in a hash table.
+ * Blocks allocated before the tracking started are not counted when
+ * they are freed.
+ */
+
+/* the names of the counts in the logs and CK_ALLOC_LIMITS, in the order
+   of enum ck_alloc_stat */
+extern const char *const alloc_stat_names[ALLOC_NSTATS];
+/* store the counts of ta in values, in the order of alloc_stat_names */
+void alloc_stat_values(const TestAllocs * ta, int64_t * values);
+/* set all the counts of ta to -1 */
+void alloc_stats_reset(TestAllocs * ta);
+
+/* whether allocations can be tracked in this build */
+int alloc_track_available(void);
+/* forget what was tracked before, and start tracking */
+void alloc_track_start(void);
+/* stop tracking, and store what was tracked since the start in ta */
+void alloc_track_stop(TestAllocs * ta);
+/* leave out the allocations of Check itself while tracking, such as
+   those of sending messages; calls nest */
+void alloc_track_pause(void);
+void alloc_track_resume(void);
+
+/* record the first allocation that fails in the processes forked from
+   now on, where alloc_failure() sees it */
+void alloc_failure_watch(void);
+/* the size of the first allocation that failed in a process forked
+   since alloc_failure_watch(), or 0 if none did or it cannot be seen */
+size_t alloc_failure(void);
+
+/*
+ * An allocation scope counts the allocations made between its begin and
+ * end, in any mode, and keeps the backtraces of the first ones.
+ */
+#define ALLOC_SCOPE_TRACES 16
+#define ALLOC_SCOPE_FRAMES 16
+
+typedef struct AllocScope
+{
+    int64_t allocs;
+    int64_t bytes;
+    int ntraces;                /* the first allocations, with backtraces */
+    size_t sizes[ALLOC_SCOPE_TRACES];
+    int nframes[ALLOC_SCOPE_TRACES];
+    void *frames[ALLOC_SCOPE_TRACES][ALLOC_SCOPE_FRAMES];
+} AllocScope;
+
+void alloc_scope_begin(void);
+/* end the scope and store what it counted in sc. Return 0 if nothing
+   could be counted, in builds that cannot track allocations */
+int alloc_scope_end(AllocScope * sc);
+/* write where the i-th traced allocation of sc was made to buf, as
+   " from" and its callers, or nothing without backtrace() */
+void alloc_scope_describe(const AllocScope * sc, int i, char *buf,
+                          size_t size);
+
+#endif /* CHECK_ALLOC_H */
@@ -0,0 +1,249 @@
+/*
+ * Check: a unit test framework for C
+ * Copyright (C) 2001, 2002 Arien Malec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "../lib/libcompat.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "check_error.h"
+#include "check_arena.h"
+
+/* Alignment of all allocations; enough for pointers, longs and doubles */
+#define ARENA_ALIGN 8
+#define ARENA_ROUND(n) (((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+/* Sizes of the first chunk and of the largest chunk made by doubling */
+#define ARENA_MIN_CHUNK (4 * 1024)
+#define ARENA_MAX_CHUNK (1024 * 1024)
+
+typedef struct ArenaChunk
+{
+    struct ArenaChunk *prev;    /* chunk allocated before this one */
+    size_t size;                /* including this header */
+} ArenaChunk;
+
+#define ARENA_CHUNK_HEADER ARENA_ROUND(sizeof(ArenaChunk))
+
+struct Arena
+{
+    ArenaChunk *chunk;          /* most recent chunk, NULL if none */
+    char *next;                 /* free space in chunk */
+    char *end;
+    size_t chunk_size;          /* size of the next chunk */
+    unsigned long nallocs;      /* calls to arena_alloc() */
+    unsigned long nchunks;      /* chunks allocated */
+};
+
+Arena *arena_create(void)
+{
+    Arena *a = (Arena *)emalloc(sizeof(Arena));
+
+    a->chunk = NULL;
+    a->next = NULL;
+    a->end = NULL;
+    a->chunk_size = ARENA_MIN_CHUNK;
+    a->nallocs = 0;
+    a->nchunks = 0;
+    return a;
+}
+
+static void arena_add_chunk(Arena * a, size_t chunk_size)
+{
+    ArenaChunk *chunk = (ArenaChunk *)emalloc(chunk_size);
+
+    chunk->prev = a->chunk;
+    chunk->size = chunk_size;
+    a->chunk = chunk;
+    a->next = (char *)chunk + ARENA_CHUNK_HEADER;
+    a->end = (char *)chunk + chunk_size;
+    a->nchunks++;
+}
+
+/*
+ * Start a new chunk with room for at least size bytes. What is left in
+ * the old chunk is wasted.
+ */
+static void arena_grow(Arena * a, size_t size)
+{
+    size_t chunk_size = a->chunk_size;
+
+    if(size + ARENA_CHUNK_HEADER > chunk_size)
+        chunk_size = size + ARENA_CHUNK_HEADER;
+    else if(a->chunk_size < ARENA_MAX_CHUNK)
+        a->chunk_size *= 2;
+    arena_add_chunk(a, chunk_size);
+}
+
+static void arena_free_chunks(Arena * a)
+{
+    ArenaChunk *chunk;
+
+    while((chunk = a->chunk) != NULL)
+    {
+        a->chunk = chunk->prev;
+        free(chunk);
+    }
+    a->next = NULL;
+    a->end = NULL;
+}
+
+void *arena_alloc(Arena * a, size_t size)
+{
+    void *p;
+
+    size = ARENA_ROUND(size);
+    if((size_t)(a->end - a->next) < size)
+        arena_grow(a, size);
+    a->nallocs++;
+    p = a->next;
+    a->next += size;
+    return p;
+}
+
+char *arena_strdup(Arena * a, const char *str)
+{
+    size_t len = strlen(str) + 1;
+
+    return (char *)memcpy(arena_alloc(a, len), str, len);
+}
+
+void arena_reset(Arena * a)
+{
+    ArenaChunk *chunk;
+    size_t total = 0;
+
+    if(a->chunk == NULL)
+        return;
+    if(a->chunk->prev == NULL)
+    {
+        a->next = (char *)a->chunk + ARENA_CHUNK_HEADER;
+        return;
+    }
+
+    /*
+     * Replace the chunks with one that holds all of them, so that doing
+     * the same allocations again takes no more chunks.
+     */
+    for(chunk = a->chunk; chunk != NULL; chunk = chunk->prev)
+        total += chunk->size - ARENA_CHUNK_HEADER;
+    arena_free_chunks(a);
+    arena_add_chunk(a, total + ARENA_CHUNK_HEADER);
+}
+
+unsigned long arena_allocs_saved(Arena * a)
+{
+    return a->nallocs > a->nchunks ? a->nallocs - a->nchunks : 0;
+}
+
+void arena_free(Arena * a)
+{
+    if(a == NULL)
+        return;
+    arena_free_chunks(a);
+    free(a);
+}
+
+typedef struct StrEntry
+{
+    const char *str;            /* NULL if the slot is free */
+    unsigned int hash;
+} StrEntry;
+
+struct StrTable
+{
+    Arena *arena;
+    StrEntry *entries;          /* open addressed, size a power of 2 */
+    unsigned int size;
+    unsigned int n;
+};
+
+StrTable *strtab_create(Arena * a)
+{
+    StrTable *t = (StrTable *)emalloc(sizeof(StrTable));
+
+    t->arena = a;
+    t->size = 16;
+    t->n = 0;
+    t->entries = (StrEntry *)emalloc(t->size * sizeof(StrEntry));
+    memset(t->entries, 0, t->size * sizeof(StrEntry));
+    return t;
+}
+
+static void strtab_grow(StrTable * t)
+{
+    StrEntry *old = t->entries;
+    unsigned int old_size = t->size;
+    unsigned int i;
+
+    t->size *= 2;
+    t->entries = (StrEntry *)emalloc(t->size * sizeof(StrEntry));
+    memset(t->entries, 0, t->size * sizeof(StrEntry));
+    for(i = 0; i < old_size; i++)
+    {
+        unsigned int j;
+
+        if(old[i].str == NULL)
+            continue;
+        for(j = old[i].hash & (t->size - 1); t->entries[j].str != NULL;
+            j = (j + 1) & (t->size - 1))
+            ;
+        t->entries[j] = old[i];
+    }
+    free(old);
+}
+
+const char *strtab_intern(StrTable * t, const char *str)
+{
+    /* FNV-1a */
+    unsigned int hash = 2166136261u;
+    const unsigned char *p;
+    const char *copy;
+    unsigned int i;
+
+    if(str == NULL)
+        return NULL;
+
+    for(p = (const unsigned char *)str; *p != '\0'; p++)
+        hash = (hash ^ *p) * 16777619u;
+
+    for(i = hash & (t->size - 1); t->entries[i].str != NULL;
+        i = (i + 1) & (t->size - 1))
+    {
+        if(t->entries[i].hash == hash && strcmp(t->entries[i].str, str) == 0)
+            return t->entries[i].str;
+    }
+
+    copy = arena_strdup(t->arena, str);
+    t->entries[i].str = copy;
+    t->entries[i].hash = hash;
+    t->n++;
+    if(t->n * 2 > t->size)
+        strtab_grow(t);
+    return copy;
+}
+
+void strtab_free(StrTable * t)
+{
+    if(t == NULL)
+        return;
+    free(t->entries);
+    free(t);
+}
@@ -0,0 +1,67 @@
+/*
+ * Check: a unit test framework for C
+ * Copyright (C) 2001, 2002 Arien Malec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef CHECK_ARENA_H
+#define CHECK_ARENA_H
+
+/*
+ * An arena hands out memory by moving a pointer through large chunks,
+ * and frees all of it at once. Nothing allocated from it can be freed
+ * or grown on its own.
+ */
+typedef struct Arena Arena;
+
+/* Create an empty arena */
+Arena *arena_create(void);
+
+/* Allocate size bytes, aligned for any of Check's own types */
+void *arena_alloc(Arena * a, size_t size);
+
+/* Copy str into the arena */
+char *arena_strdup(Arena * a, const char *str);
+
+/* Free everything allocated from the arena, but keep its memory for
+   reuse */
+void arena_reset(Arena * a);
+
+/* The number of allocations made from the arena, less the chunks it
+   took from malloc, over the life of the arena */
+unsigned long arena_allocs_saved(Arena * a);
+
+/* Free the arena and everything allocated from it */
+void arena_free(Arena * a);
+
+/*
+ * A string table keeps one copy of each distinct string given to it,
+ * in an arena, so equal strings can share memory.
+ */
+typedef struct StrTable StrTable;
+
+/* Create an empty string table storing its strings in a */
+StrTable *strtab_create(Arena * a);
+
+/* Return the copy of str in the table, adding it if needed.
+   NULL is returned as is */
+const char *strtab_intern(StrTable * t, const char *str);
+
+/* Free the table, but not its strings, which belong to the arena */
+void strtab_free(StrTable * t);
+
+#endif /* CHECK_ARENA_H */
@@ -0,0 +1,230 @@
+/*
+ * Check: a unit test framework for C
+ * Copyright (C) 2001, 2002 Arien Malec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "../lib/libcompat.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+#include "check_error.h"
+#include "check_list.h"
+#include "check_impl.h"
+#include "check_baseline.h"
+#include "check_stats.h"
+#include "check_str.h"
+
+struct Baseline
+{
+    int n;
+    int max;
+    char **names;
+    BenchResult **benches;
+};
+
+static void baseline_add(Baseline * b, char *name, BenchResult * br)
+{
+    if(b->n == b->max)
+    {
+        b->max = b->max == 0 ? 16 : 2 * b->max;
+        b->names = (char **)erealloc(b->names, b->max * sizeof(char *));
+        b->benches = (BenchResult **)erealloc(b->benches,
+                                              b->max * sizeof(BenchResult *));
+    }
+    b->names[b->n] = strdup(name);
+    b->benches[b->n] = br;
+    b->n++;
+}
+
+/* Parse the fields after the name of a benchmark; NULL if they are bad */
+static BenchResult *parse_bench(char *fields)
+{
+    char *end;
+    int64_t iterations = strtoll(fields, &end, 10);
+    double *ns = NULL;
+    int n = 0;
+
+    if(end == fields || *end != '\t' || iterations <= 0)
+        return NULL;
+    fields = end + 1;
+    while(*fields != '\0')
+    {
+        double v = strtod(fields, &end);
+
+        if(end == fields || (*end != ' ' && *end != '\0'))
+        {
+            free(ns);
+            return NULL;
+        }
+        if(n % 64 == 0)
+            ns = (double *)erealloc(ns, (n + 64) * sizeof(double));
+        ns[n++] = v;
+        fields = *end == ' ' ? end + 1 : end;
+    }
+    if(n < 2)
+    {
+        free(ns);
+        return NULL;
+    }
+    return bench_result_from_ns(iterations, ns, n);
+}
+
+Baseline *baseline_load(const char *fname)
+{
+    FILE *file = fopen(fname, "r");
+    Baseline *b;
+    size_t size = 1024;
+    char *line;
+    int lineno = 1;
+
+    if(file == NULL)
+        eprintf("Error in call to fopen while opening baseline %s:", __FILE__,
+                __LINE__ - 2, fname);
+    line = (char *)emalloc(size);
+    if(!ck_read_line(file, &line, &size) || strcmp(line, BASELINE_MAGIC) != 0)
+        eprintf("%s is not a Check baseline", __FILE__, __LINE__, fname);
+
+    b = (Baseline *)emalloc(sizeof(Baseline));
+    b->n = b->max = 0;
+    b->names = NULL;
+    b->benches = NULL;
+    while(ck_read_line(file, &line, &size))
+    {
+        char *name = strchr(line, '\t');
+        char *fields = name == NULL ? NULL : strchr(name + 1, '\t');
+        BenchResult *br;
+
+        lineno++;
+        if(fields == NULL)
+            eprintf("Bad line %d in baseline %s", __FILE__, __LINE__, lineno,
+                    fname);
+        if(strncmp(line, "T\t", 2) == 0)
+            continue;
+        *fields++ = '\0';
+        br = strncmp(line, "B\t", 2) == 0 ? parse_bench(fields) : NULL;
+        if(br == NULL)
+            eprintf("Bad line %d in baseline %s", __FILE__, __LINE__, lineno,
+                    fname);
+        baseline_add(b, name + 1, br);
+    }
+    free(line);
+    fclose(file);
+    return b;
+}
+
+void baseline_free(Baseline * b)
+{
+    int i;
+
+    for(i = 0; i < b->n; i++)
+    {
+        free(b->names[i]);
+        bench_result_free(b->benches[i]);
+    }
+    free(b->names);
+    free(b->benches);
+    free(b);
+}
+
+static BenchResult *baseline_find(Baseline * b, const char *name)
+{
+    int i;
+
+    for(i = 0; i < b->n; i++)
+    {
+        if(strcmp(b->names[i], name) == 0)
+            return b->benches[i];
+    }
+    return NULL;
+}
+
+void baseline_write_header(FILE * file)
+{
+    fprintf(file, "%s\n", BASELINE_MAGIC);
+}
+
+static void baseline_write_name(FILE * file, const char *name)
+{
+    for(; *name != '\0'; name++)
+        fputc(*name == '\t' || *name == '\n' ? ' ' : *name, file);
+}
+
+void baseline_write_result(FILE * file, TestResult * tr, const char *sname)
+{
+    char *name = bench_name(sname, tr->tcname, tr->tname, tr->iter);
+    int i;
+
+    if(tr->bench != NULL)
+    {
+        fputs("B\t", file);
+        baseline_write_name(file, name);
+        fprintf(file, "\t%jd\t", (intmax_t)tr->bench->iterations);
+        for(i = 0; i < tr->bench->nsamples; i++)
+            fprintf(file, i == 0 ? "%.3f" : " %.3f", tr->bench->samples[i]);
+    }
+    else
+    {
+        fputs("T\t", file);
+        baseline_write_name(file, name);
+        fprintf(file, "\t%jd", (intmax_t)tr->duration);
+    }
+    fputc('\n', file);
+    free(name);
+}
+
+void baseline_compare(Baseline * b, TestResult * tr, const char *sname,
+                      double threshold)
+{
+    BenchResult *base;
+    BenchResult *cur = tr->bench;
+    char *name;
+    char *change;
+    char *msg;
+    double p, delta, lo, hi;
+
+    if(cur == NULL || tr->rtype != CK_PASS)
+        return;
+    name = bench_name(sname, tr->tcname, tr->tname, tr->iter);
+    base = baseline_find(b, name);
+    free(name);
+    if(base == NULL || base->median <= 0)
+        return;
+
+    p = stats_mann_whitney(base->samples, base->nsamples, cur->samples,
+                           cur->nsamples);
+    delta = cur->median / base->median - 1;
+    stats_bootstrap_ratio(base->samples, base->nsamples, cur->samples,
+                          cur->nsamples, BASELINE_CI_LEVEL, &lo, &hi);
+    change = ck_strdup_printf("%+.1f%% [%d%% CI %+.1f%%, %+.1f%%] against "
+                              "the baseline, p = %.2g", delta * 100,
+                              BASELINE_CI_LEVEL, lo * 100, hi * 100, p);
+    if(p < BASELINE_ALPHA && delta * 100 > threshold)
+    {
+        tr->rtype = CK_FAILURE;
+        msg = ck_strdup_printf("Regressed %s, over the threshold of %g%%; "
+                               "%s", change, threshold, tr->msg);
+    }
+    else
+        msg = ck_strdup_printf("%s; %s", tr->msg, change);
+    free(change);
+    free(tr->msg);
+    tr->msg = msg;
+}
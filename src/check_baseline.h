@@ -0,0 +1,63 @@
+/*
+ * Check: a unit test framework for C
+ * Copyright (C) 2001, 2002 Arien Malec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef CHECK_BASELINE_H
+#define CHECK_BASELINE_H
+
+/*
+ * A baseline is a text file with the timings of a run, that later
+ * runs are compared with. A line with BASELINE_MAGIC is followed by a
+ * line for each test, of fields separated by tabs:
+ *
+ *   B  name  iterations  samples   a passed benchmark, with its samples
+ *                                  in nanoseconds per call separated
+ *                                  by spaces
+ *   T  name  duration              any other test, with its wall time
+ *                                  in nanoseconds, or -1
+ *
+ * Names are those of bench_name(), with any tab or newline written as
+ * a space.
+ */
+#define BASELINE_MAGIC "CKBASE01"
+
+/* A benchmark regresses when it is slower with this significance */
+#define BASELINE_ALPHA 0.01
+/* The level of the confidence intervals reported, in percent */
+#define BASELINE_CI_LEVEL 95
+
+typedef struct Baseline Baseline;
+
+/* Read the benchmarks of a baseline file; an error if it cannot be
+   read */
+Baseline *baseline_load(const char *fname);
+void baseline_free(Baseline * b);
+
+void baseline_write_header(FILE * file);
+void baseline_write_result(FILE * file, TestResult * tr, const char *sname);
+
+/*
+ * Compare a passed benchmark of the suite sname with the baseline, and
+ * add the change of its median to its message. It fails if it is
+ * significantly slower, by more than threshold percent.
+ */
+void baseline_compare(Baseline * b, TestResult * tr, const char *sname,
+                      double threshold);
+
+#endif /* CHECK_BASELINE_H */
@@ -0,0 +1,588 @@
+/*
+ * Check: a unit test framework for C
+ * Copyright (C) 2001, 2002 Arien Malec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "../lib/libcompat.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#if defined(HAVE_MMAP) && defined(HAVE_SYS_MMAN_H)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define CK_BINLOG_MMAP 1
+#endif
+
+#include "check.h"
+#include "check_error.h"
+#include "check_list.h"
+#include "check_impl.h"
+#include "check_alloc.h"
+#include "check_perf.h"
+#include "check_stats.h"
+#include "check_binlog.h"
+
+/* typedef an unsigned int that has at least 4 bytes */
+typedef uint32_t ck_uint32;
+
+#define BINLOG_TAG_STR 'S'
+#define BINLOG_TAG_SUITE 'U'
+#define BINLOG_TAG_RESULT 'R'
+#define BINLOG_TAG_PERF 'P'
+#define BINLOG_TAG_BENCH 'B'
+
+#define BINLOG_STR_HEAD_LEN (1 + 4)
+#define BINLOG_SUITE_LEN (1 + 4)
+#define BINLOG_PERF_HEAD_LEN (1 + 4)
+#define BINLOG_PERF_COUNTER_LEN (4 + 8)
+#define BINLOG_BENCH_HEAD_LEN (1 + 8 + 4 + 4)
+#define BINLOG_RESULT_LEN (1 + 8 * 4 + (10 + NPHASES + ALLOC_NSTATS) * 8)
+/* offsets of the times of the phases and the allocations in a result */
+#define BINLOG_PHASES_POS 113
+#define BINLOG_ALLOCS_POS (BINLOG_PHASES_POS + NPHASES * 8)
+
+typedef struct BinLogString
+{
+    char *str;                  /* NULL if the slot is free */
+    size_t len;
+    ck_uint32 hash;
+    ck_uint32 id;
+} BinLogString;
+
+struct BinLogWriter
+{
+    FILE *file;
+    BinLogString *table;        /* open addressed, size a power of 2 */
+    unsigned int size;
+    unsigned int nstrs;
+};
+
+static void put_uint(unsigned char *buf, ck_uint32 val)
+{
+    buf[0] = (unsigned char)((val >> 24) & 0xFF);
+    buf[1] = (unsigned char)((val >> 16) & 0xFF);
+    buf[2] = (unsigned char)((val >> 8) & 0xFF);
+    buf[3] = (unsigned char)(val & 0xFF);
+}
+
+static ck_uint32 get_uint(const unsigned char *buf)
+{
+    return ((ck_uint32) buf[0] << 24) | ((ck_uint32) buf[1] << 16) |
+        ((ck_uint32) buf[2] << 8) | (ck_uint32) buf[3];
+}
+
+static void put_int64(unsigned char *buf, int64_t val)
+{
+    uint64_t uval = (uint64_t)val;
+
+    put_uint(buf, (ck_uint32) (uval >> 32));
+    put_uint(buf + 4, (ck_uint32) (uval & 0xFFFFFFFF));
+}
+
+static int64_t get_int64(const unsigned char *buf)
+{
+    return (int64_t)(((uint64_t)get_uint(buf) << 32) | get_uint(buf + 4));
+}
+
+static void binlog_fwrite(BinLogWriter * w, const void *buf, size_t len)
+{
+    if(fwrite(buf, 1, len, w->file) != len)
+        eprintf("Error in call to fwrite while writing binary log:",
+                __FILE__, __LINE__ - 1);
+}
+
+BinLogWriter *binlog_writer_create(FILE * file)
+{
+    BinLogWriter *w = (BinLogWriter *)emalloc(sizeof(BinLogWriter));
+
+    w->file = file;
+    w->size = 64;
+    w->nstrs = 0;
+    w->table = (BinLogString *)emalloc(w->size * sizeof(BinLogString));
+    memset(w->table, 0, w->size * sizeof(BinLogString));
+    binlog_fwrite(w, BINLOG_MAGIC, BINLOG_MAGIC_LEN);
+    return w;
+}
+
+void binlog_writer_free(BinLogWriter * w)
+{
+    unsigned int i;
+
+    if(w == NULL)
+        return;
+    for(i = 0; i < w->size; i++)
+        free(w->table[i].str);
+    free(w->table);
+    free(w);
+}
+
+static void binlog_grow(BinLogWriter * w)
+{
+    BinLogString *old = w->table;
+    unsigned int old_size = w->size;
+    unsigned int i;
+
+    w->size *= 2;
+    w->table = (BinLogString *)emalloc(w->size * sizeof(BinLogString));
+    memset(w->table, 0, w->size * sizeof(BinLogString));
+    for(i = 0; i < old_size; i++)
+    {
+        unsigned int j;
+
+        if(old[i].str == NULL)
+            continue;
+        for(j = old[i].hash & (w->size - 1); w->table[j].str != NULL;
+            j = (j + 1) & (w->size - 1))
+            ;
+        w->table[j] = old[i];
+    }
+    free(old);
+}
+
+/*
+ * Return the number of str, writing it out first if it was not seen
+ * before.
+ */
+static ck_uint32 binlog_intern(BinLogWriter * w, const char *str)
+{
+    /* FNV-1a, computed along with the length */
+    ck_uint32 hash = 2166136261u;
+    const unsigned char *p;
+    unsigned char head[BINLOG_STR_HEAD_LEN];
+    BinLogString *e;
+    unsigned int i;
+    size_t len;
+
+    if(str == NULL)
+        return BINLOG_NO_STR;
+
+    for(p = (const unsigned char *)str; *p != '\0'; p++)
+        hash = (hash ^ *p) * 16777619u;
+    len = (size_t)(p - (const unsigned char *)str);
+
+    for(i = hash & (w->size - 1); w->table[i].str != NULL;
+        i = (i + 1) & (w->size - 1))
+    {
+        e = &w->table[i];
+        if(e->hash == hash && e->len == len && memcmp(e->str, str, len) == 0)
+            return e->id;
+    }
+
+    head[0] = BINLOG_TAG_STR;
+    put_uint(head + 1, (ck_uint32) len);
+    binlog_fwrite(w, head, sizeof(head));
+    binlog_fwrite(w, str, len + 1);
+
+    e = &w->table[i];
+    e->str = (char *)emalloc(len + 1);
+    memcpy(e->str, str, len + 1);
+    e->len = len;
+    e->hash = hash;
+    e->id = w->nstrs++;
+    if(w->nstrs * 2 > w->size)
+        binlog_grow(w);
+    return w->nstrs - 1;
+}
+
+void binlog_write_suite(BinLogWriter * w, const char *name)
+{
+    unsigned char rec[BINLOG_SUITE_LEN];
+
+    rec[0] = BINLOG_TAG_SUITE;
+    put_uint(rec + 1, binlog_intern(w, name));
+    binlog_fwrite(w, rec, sizeof(rec));
+}
+
+static void binlog_write_perf(BinLogWriter * w, const PerfSample * ps)
+{
+    unsigned char rec[BINLOG_PERF_HEAD_LEN +
+                      PERF_MAX_COUNTERS * BINLOG_PERF_COUNTER_LEN];
+    unsigned char *p = rec + BINLOG_PERF_HEAD_LEN;
+    int i;
+
+    for(i = 0; i < ps->n; i++, p += BINLOG_PERF_COUNTER_LEN)
+    {
+        put_uint(p, binlog_intern(w, ps->names[i]));
+        put_int64(p + 4, ps->values[i]);
+    }
+    rec[0] = BINLOG_TAG_PERF;
+    put_uint(rec + 1, (ck_uint32) ps->n);
+    binlog_fwrite(w, rec, (size_t)(p - rec));
+}
+
+static int64_t ns_to_ps(double ns)
+{
+    return (int64_t)(ns * 1000 + (ns < 0 ? -0.5 : 0.5));
+}
+
+static void binlog_write_bench(BinLogWriter * w, const BenchResult * br)
+{
+    int cpu = br->cpu_samples != NULL;
+    size_t len = BINLOG_BENCH_HEAD_LEN +
+        (size_t)br->nsamples * (cpu ? 2 : 1) * 8;
+    unsigned char *rec = (unsigned char *)emalloc(len);
+    unsigned char *p = rec + BINLOG_BENCH_HEAD_LEN;
+    int i;
+
+    rec[0] = BINLOG_TAG_BENCH;
+    put_int64(rec + 1, br->iterations);
+    put_uint(rec + 9, (ck_uint32) br->nsamples);
+    put_uint(rec + 13, (ck_uint32) cpu);
+    for(i = 0; i < br->nsamples; i++, p += 8)
+        put_int64(p, ns_to_ps(br->samples[i]));
+    for(i = 0; cpu && i < br->nsamples; i++, p += 8)
+        put_int64(p, ns_to_ps(br->cpu_samples[i]));
+    binlog_fwrite(w, rec, len);
+    free(rec);
+}
+
+void binlog_write_result(BinLogWriter * w, TestResult * tr)
+{
+    unsigned char rec[BINLOG_RESULT_LEN];
+    int64_t allocs[ALLOC_NSTATS];
+    int i;
+
+    /* strings first, as their records must come before this one */
+    put_uint(rec + 17, binlog_intern(w, tr->file));
+    put_uint(rec + 21, binlog_intern(w, tr->tcname));
+    put_uint(rec + 25, binlog_intern(w, tr->tname));
+    put_uint(rec + 29, binlog_intern(w, tr->msg));
+    if(tr->perf != NULL)
+        binlog_write_perf(w, tr->perf);
+    if(tr->bench != NULL)
+        binlog_write_bench(w, tr->bench);
+
+    rec[0] = BINLOG_TAG_RESULT;
+    put_uint(rec + 1, (ck_uint32) tr->rtype);
+    put_uint(rec + 5, (ck_uint32) tr->ctx);
+    put_uint(rec + 9, (ck_uint32) tr->line);
+    put_uint(rec + 13, (ck_uint32) tr->iter);
+    put_int64(rec + 33, tr->duration);
+    put_int64(rec + 41, tr->utime);
+    put_int64(rec + 49, tr->stime);
+    put_int64(rec + 57, tr->rusage.maxrss);
+    put_int64(rec + 65, tr->rusage.minflt);
+    put_int64(rec + 73, tr->rusage.majflt);
+    put_int64(rec + 81, tr->rusage.nvcsw);
+    put_int64(rec + 89, tr->rusage.nivcsw);
+    put_int64(rec + 97, tr->rusage.inblock);
+    put_int64(rec + 105, tr->rusage.oublock);
+    for(i = 0; i < NPHASES; i++)
+        put_int64(rec + BINLOG_PHASES_POS + 8 * i, tr->phases[i]);
+    alloc_stat_values(&tr->allocs, allocs);
+    for(i = 0; i < ALLOC_NSTATS; i++)
+        put_int64(rec + BINLOG_ALLOCS_POS + 8 * i, allocs[i]);
+    binlog_fwrite(w, rec, sizeof(rec));
+}
+
+/* read all of fname into memory, for systems without mmap() */
+static unsigned char *binlog_read_file(const char *fname, size_t * len)
+{
+    FILE *f = fopen(fname, "rb");
+    unsigned char *data = NULL;
+    size_t size = 0;
+    size_t n;
+
+    *len = 0;
+    if(f == NULL)
+        return NULL;
+    do
+    {
+        if(*len == size)
+        {
+            size = size == 0 ? 64 * 1024 : size * 2;
+            data = (unsigned char *)erealloc(data, size);
+        }
+        n = fread(data + *len, 1, size - *len, f);
+        *len += n;
+    }
+    while(n > 0);
+    if(ferror(f))
+    {
+        int err = errno;
+
+        fclose(f);
+        free(data);
+        errno = err;
+        return NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+BinLogReader *binlog_reader_open(const char *fname)
+{
+    BinLogReader *r = (BinLogReader *)emalloc(sizeof(BinLogReader));
+
+    memset(r, 0, sizeof(BinLogReader));
+    r->fname = fname;
+
+#if defined(CK_BINLOG_MMAP)
+    {
+        struct stat st;
+        int fd = open(fname, O_RDONLY);
+
+        if(fd < 0)
+        {
+            free(r);
+            return NULL;
+        }
+        if(fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *data = mmap(NULL, (size_t)st.st_size, PROT_READ,
+                              MAP_PRIVATE, fd, 0);
+
+            if(data != MAP_FAILED)
+            {
+                r->data = (unsigned char *)data;
+                r->len = (size_t)st.st_size;
+                r->mapped = 1;
+            }
+        }
+        close(fd);
+    }
+#endif /* CK_BINLOG_MMAP */
+
+    if(!r->mapped)
+    {
+        r->data = binlog_read_file(fname, &r->len);
+        if(r->data == NULL)
+        {
+            free(r);
+            return NULL;
+        }
+    }
+
+    if(r->len < BINLOG_MAGIC_LEN ||
+       memcmp(r->data, BINLOG_MAGIC, BINLOG_MAGIC_LEN) != 0)
+    {
+        binlog_reader_close(r);
+        errno = 0;
+        return NULL;
+    }
+    r->pos = BINLOG_MAGIC_LEN;
+    return r;
+}
+
+void binlog_reader_close(BinLogReader * r)
+{
+    if(r == NULL)
+        return;
+#if defined(CK_BINLOG_MMAP)
+    if(r->mapped)
+        munmap(r->data, r->len);
+    else
+#endif /* CK_BINLOG_MMAP */
+        free(r->data);
+    free(r->strs);
+    free(r->perf);
+    bench_result_free(r->tr.bench);
+    free(r);
+}
+
+/*
+ * Look up string number id, which may stand for NULL if null_ok.
+ * Return 0 if there is no such string.
+ */
+static int binlog_str(BinLogReader * r, ck_uint32 id, int null_ok,
+                      const char **str)
+{
+    if(id == BINLOG_NO_STR && null_ok)
+    {
+        *str = NULL;
+        return 1;
+    }
+    if(id >= r->nstrs)
+        return 0;
+    *str = r->strs[id];
+    return 1;
+}
+
+/* Read the performance counter record at rec, of at most left bytes,
+   into r->perf. Return its length, or 0 if it is bad */
+static size_t binlog_read_perf(BinLogReader * r, const unsigned char *rec,
+                               size_t left)
+{
+    ck_uint32 n, i;
+    size_t len;
+
+    if(left < BINLOG_PERF_HEAD_LEN)
+        return 0;
+    n = get_uint(rec + 1);
+    if(n > PERF_MAX_COUNTERS)
+        return 0;
+    len = BINLOG_PERF_HEAD_LEN + n * BINLOG_PERF_COUNTER_LEN;
+    if(left < len)
+        return 0;
+    if(r->perf == NULL)
+        r->perf = (PerfSample *)emalloc(sizeof(PerfSample));
+    r->perf->n = (int)n;
+    for(i = 0; i < n; i++)
+    {
+        const unsigned char *p = rec + BINLOG_PERF_HEAD_LEN +
+            i * BINLOG_PERF_COUNTER_LEN;
+
+        if(!binlog_str(r, get_uint(p), 0, &r->perf->names[i]))
+            return 0;
+        r->perf->values[i] = get_int64(p + 4);
+    }
+    return len;
+}
+
+/* Read the benchmark record at rec, of at most left bytes, into
+   r->tr.bench. Return its length, or 0 if it is bad */
+static size_t binlog_read_bench(BinLogReader * r, const unsigned char *rec,
+                                size_t left)
+{
+    int64_t iterations;
+    ck_uint32 n, cpu, i;
+    int64_t *ps;
+    size_t len;
+
+    if(left < BINLOG_BENCH_HEAD_LEN)
+        return 0;
+    iterations = get_int64(rec + 1);
+    n = get_uint(rec + 9);
+    cpu = get_uint(rec + 13);
+    if(n == 0 || n > BENCH_MAX_SAMPLES || cpu > 1)
+        return 0;
+    len = BINLOG_BENCH_HEAD_LEN + (size_t)n * (cpu + 1) * 8;
+    if(left < len)
+        return 0;
+
+    ps = (int64_t *)emalloc((size_t)n * (cpu + 1) * sizeof(int64_t));
+    for(i = 0; i < n * (cpu + 1); i++)
+        ps[i] = get_int64(rec + BINLOG_BENCH_HEAD_LEN + 8 * i);
+    r->tr.bench = bench_result_create(iterations, ps, cpu ? ps + n : NULL,
+                                      (int)n);
+    free(ps);
+    return len;
+}
+
+enum binlog_record binlog_read(BinLogReader * r)
+{
+    /* the records that belong to a result are read along with it */
+    r->tr.perf = NULL;
+    bench_result_free(r->tr.bench);
+    r->tr.bench = NULL;
+    for(;;)
+    {
+        const unsigned char *rec = r->data + r->pos;
+        size_t left = r->len - r->pos;
+        ck_uint32 len, rtype, ctx;
+        size_t reclen;
+        const char *file;
+        const char *msg;
+        int i;
+
+        if(left == 0)
+            return BINLOG_END;
+
+        switch (rec[0])
+        {
+            case BINLOG_TAG_STR:
+                if(left < BINLOG_STR_HEAD_LEN + 1)
+                    return BINLOG_BAD;
+                len = get_uint(rec + 1);
+                if(len > left - BINLOG_STR_HEAD_LEN - 1 ||
+                   rec[BINLOG_STR_HEAD_LEN + len] != '\0')
+                    return BINLOG_BAD;
+                if(r->nstrs == r->maxstrs)
+                {
+                    r->maxstrs = r->maxstrs == 0 ? 64 : r->maxstrs * 2;
+                    r->strs = (const char **)erealloc((void *)r->strs,
+                                                      r->maxstrs *
+                                                      sizeof(const char *));
+                }
+                r->strs[r->nstrs++] = (const char *)rec + BINLOG_STR_HEAD_LEN;
+                r->pos += BINLOG_STR_HEAD_LEN + len + 1;
+                break;
+            case BINLOG_TAG_PERF:
+                reclen = binlog_read_perf(r, rec, left);
+                if(reclen == 0)
+                    return BINLOG_BAD;
+                r->tr.perf = r->perf;
+                r->pos += reclen;
+                break;
+            case BINLOG_TAG_BENCH:
+                if(r->tr.bench != NULL)
+                    return BINLOG_BAD;
+                reclen = binlog_read_bench(r, rec, left);
+                if(reclen == 0)
+                    return BINLOG_BAD;
+                r->pos += reclen;
+                break;
+            case BINLOG_TAG_SUITE:
+                if(left < BINLOG_SUITE_LEN || r->tr.perf != NULL ||
+                   r->tr.bench != NULL ||
+                   !binlog_str(r, get_uint(rec + 1), 0, &r->sname))
+                    return BINLOG_BAD;
+                r->pos += BINLOG_SUITE_LEN;
+                return BINLOG_SUITE;
+            case BINLOG_TAG_RESULT:
+                if(left < BINLOG_RESULT_LEN || r->sname == NULL ||
+                   !binlog_str(r, get_uint(rec + 17), 1, &file) ||
+                   !binlog_str(r, get_uint(rec + 21), 1, &r->tr.tcname) ||
+                   !binlog_str(r, get_uint(rec + 25), 1, &r->tr.tname) ||
+                   !binlog_str(r, get_uint(rec + 29), 1, &msg))
+                    return BINLOG_BAD;
+                rtype = get_uint(rec + 1);
+                ctx = get_uint(rec + 5);
+                if(rtype != CK_PASS && rtype != CK_FAILURE && rtype != CK_ERROR)
+                    return BINLOG_BAD;
+                if(ctx != CK_CTX_INVALID && ctx != CK_CTX_SETUP &&
+                   ctx != CK_CTX_TEST && ctx != CK_CTX_TEARDOWN)
+                    return BINLOG_BAD;
+                r->tr.rtype = (unsigned char)rtype;
+                r->tr.ctx = (unsigned char)ctx;
+                r->tr.line = (int)get_uint(rec + 9);
+                r->tr.iter = (int)get_uint(rec + 13);
+                r->tr.duration = get_int64(rec + 33);
+                r->tr.utime = get_int64(rec + 41);
+                r->tr.stime = get_int64(rec + 49);
+                r->tr.rusage.maxrss = (long)get_int64(rec + 57);
+                r->tr.rusage.minflt = (long)get_int64(rec + 65);
+                r->tr.rusage.majflt = (long)get_int64(rec + 73);
+                r->tr.rusage.nvcsw = (long)get_int64(rec + 81);
+                r->tr.rusage.nivcsw = (long)get_int64(rec + 89);
+                r->tr.rusage.inblock = (long)get_int64(rec + 97);
+                r->tr.rusage.oublock = (long)get_int64(rec + 105);
+                for(i = 0; i < NPHASES; i++)
+                    r->tr.phases[i] =
+                        get_int64(rec + BINLOG_PHASES_POS + 8 * i);
+                r->tr.allocs.allocs = get_int64(rec + BINLOG_ALLOCS_POS);
+                r->tr.allocs.bytes = get_int64(rec + BINLOG_ALLOCS_POS + 8);
+                r->tr.allocs.peak_bytes =
+                    get_int64(rec + BINLOG_ALLOCS_POS + 16);
+                r->tr.allocs.leaks = get_int64(rec + BINLOG_ALLOCS_POS + 24);
+                r->tr.allocs.leaked_bytes =
+                    get_int64(rec + BINLOG_ALLOCS_POS + 32);
+                /* the lfuns never write through these */
+                r->tr.file = file;
+                r->tr.msg = (char *)msg;
+                r->pos += BINLOG_RESULT_LEN;
+                return BINLOG_RESULT;
+            default:
+                return BINLOG_BAD;
+        }
+    }
+}
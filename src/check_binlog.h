@@ -0,0 +1,96 @@
+/*
+ * Check: a unit test framework for C
+ * Copyright (C) 2001, 2002 Arien Malec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef CHECK_BINLOG_H
+#define CHECK_BINLOG_H
+
+/*
+ * The binary log is a header followed by records, each starting with
+ * a one byte tag. Integers are 4 bytes, or 8 bytes for times, most
+ * significant first.
+ *
+ *   header:  "CKBLOG07"
+ *   'S'      string: length, the bytes and a terminating '\0'.
+ *            Strings are numbered from 0 in the order they appear,
+ *            and each is written once, before its first use.
+ *   'U'      suite start: name
+ *   'R'      test result: rtype, ctx, line, iter, file, tcname, tname,
+ *            msg, then the wall, user and system times of the test in
+ *            nanoseconds, the fields of its TestRusage and the times
+ *            of its phases in the order of enum ck_phase and its
+ *            heap allocations in the order of enum ck_alloc_stat, all
+ *            -1 if unknown
+ *   'P'      performance counters of the next result: the number of
+ *            counters, then the name and count of each
+ *   'B'      benchmark of the next result: iterations, the number of
+ *            samples, 1 if their CPU times follow and 0 if not, then
+ *            the samples and their CPU times in picoseconds
+ *
+ * Strings in suite and result records are referred to by number, or
+ * by BINLOG_NO_STR for NULL, so those records have a fixed size. The
+ * records that belong to a result come right before it, with only
+ * strings in between.
+ */
+
+#define BINLOG_MAGIC "CKBLOG07"
+#define BINLOG_MAGIC_LEN 8
+#define BINLOG_NO_STR 0xFFFFFFFFu
+
+typedef struct BinLogWriter BinLogWriter;
+
+/* write the header to file and return a writer appending to it */
+BinLogWriter *binlog_writer_create(FILE * file);
+void binlog_write_suite(BinLogWriter * w, const char *name);
+void binlog_write_result(BinLogWriter * w, TestResult * tr);
+void binlog_writer_free(BinLogWriter * w);
+
+enum binlog_record
+{
+    BINLOG_END,                 /* no more records */
+    BINLOG_SUITE,               /* a suite started; see sname */
+    BINLOG_RESULT,              /* a test ended; see tr */
+    BINLOG_BAD                  /* the file is truncated or corrupt */
+};
+
+typedef struct BinLogReader
+{
+    const char *fname;
+    unsigned char *data;        /* the whole file, mapped if possible */
+    size_t len;
+    size_t pos;                 /* offset of the next record */
+    int mapped;
+    const char **strs;          /* strings seen so far, pointing into data */
+    unsigned int nstrs;
+    unsigned int maxstrs;
+    const char *sname;          /* name of the current suite */
+    TestResult tr;              /* last result read */
+    struct PerfSample *perf;    /* where tr.perf points if it is set */
+} BinLogReader;
+
+/* open a binary log for reading; NULL with errno set if it could not
+   be read, or with errno 0 if it is not a binary log */
+BinLogReader *binlog_reader_open(const char *fname);
+/* read up to the next suite or result record. The strings of sname
+   and tr stay valid until the reader is closed, and the performance
+   counters and benchmark of tr until the next read */
+enum binlog_record binlog_read(BinLogReader * r);
+void binlog_reader_close(BinLogReader * r);
+
+#endif /* CHECK_BINLOG_H */
@@ -0,0 +1,245 @@
+/*
+ * Check: a unit test framework for C
+ * Copyright (C) 2001, 2002 Arien Malec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "../lib/libcompat.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "check.h"
+#include "check_error.h"
+#include "check_list.h"
+#include "check_impl.h"
+#include "check_history.h"
+#include "check_stats.h"
+#include "check_str.h"
+
+typedef struct HistEntry
+{
+    char *name;
+    int n;                      /* durations kept, at most HISTORY_RUNS */
+    int64_t durations[HISTORY_RUNS];    /* oldest first */
+} HistEntry;
+
+/* the tests, found by name in a table with linear probing */
+struct History
+{
+    HistEntry **entries;        /* in the order they were added */
+    int n;
+    int max;
+    int *slots;                 /* indexes of entries, -1 for none */
+    unsigned int nslots;        /* a power of two */
+};
+
+static unsigned int name_hash(const char *name)
+{
+    unsigned int h = 2166136261u;
+
+    for(; *name != '\0'; name++)
+        h = (h ^ (unsigned char)*name) * 16777619u;
+    return h;
+}
+
+static void history_rehash(History * h)
+{
+    unsigned int i;
+    int j;
+
+    h->nslots = h->nslots == 0 ? 64 : 2 * h->nslots;
+    h->slots = (int *)erealloc(h->slots, h->nslots * sizeof(int));
+    for(i = 0; i < h->nslots; i++)
+        h->slots[i] = -1;
+    for(j = 0; j < h->n; j++)
+    {
+        i = name_hash(h->entries[j]->name) & (h->nslots - 1);
+        while(h->slots[i] >= 0)
+            i = (i + 1) & (h->nslots - 1);
+        h->slots[i] = j;
+    }
+}
+
+/* The entry of the test name, added if create and it has none */
+static HistEntry *history_find(History * h, const char *name, int create)
+{
+    unsigned int i;
+    HistEntry *e;
+
+    if(h->nslots == 0)
+    {
+        if(!create)
+            return NULL;
+        history_rehash(h);
+    }
+    for(i = name_hash(name) & (h->nslots - 1); h->slots[i] >= 0;
+        i = (i + 1) & (h->nslots - 1))
+    {
+        if(strcmp(h->entries[h->slots[i]]->name, name) == 0)
+            return h->entries[h->slots[i]];
+    }
+    if(!create)
+        return NULL;
+
+    if(h->n == h->max)
+    {
+        h->max = h->max == 0 ? 64 : 2 * h->max;
+        h->entries = (HistEntry **)erealloc(h->entries,
+                                            h->max * sizeof(HistEntry *));
+    }
+    e = (HistEntry *)emalloc(sizeof(HistEntry));
+    e->name = strdup(name);
+    e->n = 0;
+    h->entries[h->n] = e;
+    h->slots[i] = h->n++;
+    /* keep at most half the slots full */
+    if(2 * (unsigned int)h->n > h->nslots)
+        history_rehash(h);
+    return e;
+}
+
+History *history_load(const char *fname)
+{
+    FILE *file = fopen(fname, "r");
+    History *h = (History *)emalloc(sizeof(History));
+    size_t size = 1024;
+    char *line;
+    int lineno = 1;
+
+    h->entries = NULL;
+    h->n = h->max = 0;
+    h->slots = NULL;
+    h->nslots = 0;
+    if(file == NULL)
+    {
+        if(errno != ENOENT)
+            eprintf("Error in call to fopen while opening history %s:",
+                    __FILE__, __LINE__ - 5, fname);
+        return h;
+    }
+
+    line = (char *)emalloc(size);
+    if(!ck_read_line(file, &line, &size) || strcmp(line, HISTORY_MAGIC) != 0)
+        eprintf("%s is not a Check duration history", __FILE__, __LINE__,
+                fname);
+    while(ck_read_line(file, &line, &size))
+    {
+        char *fields = strchr(line, '\t');
+
+        lineno++;
+        if(fields == NULL)
+            eprintf("Bad line %d in history %s", __FILE__, __LINE__, lineno,
+                    fname);
+        *fields++ = '\0';
+        while(*fields != '\0')
+        {
+            char *end;
+            int64_t d = strtoll(fields, &end, 10);
+
+            if(end == fields || (*end != ' ' && *end != '\0') || d < 0)
+                eprintf("Bad line %d in history %s", __FILE__, __LINE__,
+                        lineno, fname);
+            history_add(h, line, d);
+            fields = *end == ' ' ? end + 1 : end;
+        }
+    }
+    free(line);
+    fclose(file);
+    return h;
+}
+
+void history_free(History * h)
+{
+    int i;
+
+    for(i = 0; i < h->n; i++)
+    {
+        free(h->entries[i]->name);
+        free(h->entries[i]);
+    }
+    free(h->entries);
+    free(h->slots);
+    free(h);
+}
+
+static void history_write_name(FILE * file, const char *name)
+{
+    for(; *name != '\0'; name++)
+        fputc(*name == '\t' || *name == '\n' ? ' ' : *name, file);
+}
+
+void history_save(History * h, const char *fname)
+{
+    char *tmp = ck_strdup_printf("%s.tmp", fname);
+    FILE *file = fopen(tmp, "w");
+    int i, j;
+
+    if(file == NULL)
+        eprintf("Error in call to fopen while opening history %s:", __FILE__,
+                __LINE__ - 2, tmp);
+    fprintf(file, "%s\n", HISTORY_MAGIC);
+    for(i = 0; i < h->n; i++)
+    {
+        HistEntry *e = h->entries[i];
+
+        if(e->n == 0)
+            continue;
+        history_write_name(file, e->name);
+        for(j = 0; j < e->n; j++)
+            fprintf(file, "%c%jd", j == 0 ? '\t' : ' ',
+                    (intmax_t)e->durations[j]);
+        fputc('\n', file);
+    }
+    /* so that a run stopped while writing leaves the old history */
+    if(fclose(file) != 0)
+        eprintf("Error in call to fclose while writing history %s:",
+                __FILE__, __LINE__, tmp);
+    if(rename(tmp, fname) != 0)
+        eprintf("Error in call to rename while writing history %s:",
+                __FILE__, __LINE__, fname);
+    free(tmp);
+}
+
+void history_add(History * h, const char *name, int64_t duration)
+{
+    HistEntry *e = history_find(h, name, 1);
+
+    if(e->n == HISTORY_RUNS)
+    {
+        memmove(e->durations, e->durations + 1,
+                (HISTORY_RUNS - 1) * sizeof(int64_t));
+        e->n--;
+    }
+    e->durations[e->n++] = duration;
+}
+
+double history_p99(History * h, const char *name)
+{
+    HistEntry *e = history_find(h, name, 0);
+    double sorted[HISTORY_RUNS];
+    int i;
+
+    if(e == NULL || e->n < HISTORY_MIN_RUNS)
+        return -1;
+    for(i = 0; i < e->n; i++)
+        sorted[i] = (double)e->durations[i];
+    stats_sort(sorted, e->n);
+    return stats_percentile(sorted, e->n, 99);
+}
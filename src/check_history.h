@@ -0,0 +1,54 @@
+/*
+ * Check: a unit test framework for C
+ * Copyright (C) 2001, 2002 Arien Malec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef CHECK_HISTORY_H
+#define CHECK_HISTORY_H
+
+/*
+ * A duration history is a text file with the durations of each test
+ * over its last passed runs, that the timeouts of later runs are taken
+ * from. A line with HISTORY_MAGIC is followed by a line for each test,
+ * its name, a tab and its wall times in nanoseconds separated by
+ * spaces, oldest first. Names are those of bench_name(), with any tab
+ * or newline written as a space.
+ */
+#define HISTORY_MAGIC "CKHIST01"
+/* the durations kept of each test */
+#define HISTORY_RUNS 50
+/* the durations a test needs before its history sets its timeout */
+#define HISTORY_MIN_RUNS 5
+
+typedef struct History History;
+
+/* Read a history file, or start an empty history if there is none; an
+   error if it cannot be read */
+History *history_load(const char *fname);
+void history_free(History * h);
+/* Write the history to fname, replacing it once it is complete */
+void history_save(History * h, const char *fname);
+
+/* Add a duration of the test name, dropping its oldest past
+   HISTORY_RUNS */
+void history_add(History * h, const char *name, int64_t duration);
+/* The 99th percentile of the durations of the test name, or -1 if it
+   has fewer than HISTORY_MIN_RUNS */
+double history_p99(History * h, const char *name);
+
+#endif /* CHECK_HISTORY_H */
@@ -34,6 +34,19 @@
   ( (((end).tv_sec - (begin).tv_sec) * US_PER_SEC) + \
     ((end).tv_nsec/1000) - ((begin).tv_nsec/1000) )
 
+/** calculate the difference in nanoseconds out of two "struct timespec"s */
+#define DIFF_IN_NSEC(begin, end) \
+  ( ((int64_t)((end).tv_sec - (begin).tv_sec) * NANOS_PER_SECONDS) + \
+    ((end).tv_nsec - (begin).tv_nsec) )
+
+/** convert a "struct timeval" to nanoseconds */
+#define TIMEVAL_IN_NSEC(tv) \
+  ( ((int64_t)(tv).tv_sec * NANOS_PER_SECONDS) + ((int64_t)(tv).tv_usec * 1000) )
+
+/** convert a "struct timespec" to nanoseconds */
+#define TIMESPEC_IN_NSEC(ts) \
+  ( ((int64_t)(ts).tv_sec * NANOS_PER_SECONDS) + (ts).tv_nsec )
+
 typedef struct TF
 {
     TFun fn;
@@ -42,12 +55,15 @@ typedef struct TF
     const char *name;
     int signal;
     signed char allowed_exit_value;
+    double timeout;             /* seconds, negative for the test case's */
 } TF;
 
 struct Suite
 {
     const char *name;
     List *tclst;                /* List of test cases */
+    List *sflst;                /* fixtures run once around the suite */
+    List *tflst;
 };
 
 typedef struct Fixture
@@ -60,11 +76,16 @@ struct TCase
 {
     const char *name;
     struct timespec timeout;
+    size_t memory_limit;        /* bytes, or 0 for none */
+    double cpu_limit;           /* seconds, or 0 for none */
+    int independent;            /* 1 if its unchecked setup may run while
+                                   the test case before it runs */
     List *tflst;                /* list of test functions */
     List *unch_sflst;
     List *unch_tflst;
     List *ch_sflst;
     List *ch_tflst;
+    struct Arena *arena;        /* holds the TCase, its TFs and Fixtures */
 };
 
 typedef struct TestStats
@@ -74,22 +95,97 @@ typedef struct TestStats
     int n_errors;
 } TestStats;
 
+/*
+ * Resources used by a test, as counted by getrusage() or wait4(). Each
+ * is -1 when it is unknown.
+ */
+typedef struct TestRusage
+{
+    long maxrss;                /* peak resident set size in kilobytes */
+    long minflt;                /* page faults serviced without I/O */
+    long majflt;                /* page faults that needed I/O */
+    long nvcsw;                 /* voluntary context switches */
+    long nivcsw;                /* involuntary context switches */
+    long inblock;               /* block input operations */
+    long oublock;               /* block output operations */
+} TestRusage;
+
+/*
+ * The heap allocations of a test, as tracked in its child process; see
+ * check_alloc.h. Each is -1 unless they were tracked.
+ */
+typedef struct TestAllocs
+{
+    int64_t allocs;             /* calls of malloc(), calloc(), realloc() */
+    int64_t bytes;              /* bytes those calls asked for */
+    int64_t peak_bytes;         /* most bytes live at once */
+    int64_t leaks;              /* blocks still live after the teardown */
+    int64_t leaked_bytes;       /* bytes of those blocks */
+} TestAllocs;
+
+/* the fields of TestAllocs, in the order of enum ck_alloc_stat */
+#define ALLOC_NSTATS 5
+
+/* the phases of enum ck_phase */
+#define NPHASES 6
+
+/*
+ * The samples of a benchmark and their statistics, in nanoseconds per
+ * call of its body; see check_stats.h.
+ */
+typedef struct BenchResult
+{
+    int64_t iterations;         /* calls of the body in each sample */
+    int nsamples;
+    double *samples;            /* sorted, fastest first */
+    double *cpu_samples;        /* the CPU time of each of samples, or
+                                   NULL if it is not known */
+    double min;
+    double median;
+    double mean;
+    double p90;
+    double p99;
+    double mad;                 /* median absolute deviation */
+} BenchResult;
+
+/*
+ * Results kept by a runner are copied into its arena, with file names
+ * shared through its string table; see srunner_store_result(). Until
+ * then, file and msg are malloc'ed, unless msg is tr_pass_msg().
+ *
+ * The times are -1 when they are unknown. The wall time only covers the
+ * test function, and is unknown if it did not return. The CPU times and
+ * rusage cover the test function in nofork mode, but the whole child
+ * process, fixtures included, in fork mode. In nofork mode maxrss is the
+ * peak of the whole runner up to the end of the test.
+ */
 struct TestResult
 {
-    enum test_result rtype;     /* Type of result */
-    enum ck_result_ctx ctx;     /* When the result occurred */
-    char *file;                 /* File where the test occured */
-    int line;                   /* Line number where the test occurred */
-    int iter;                   /* The iteration value for looping tests */
-    int duration;               /* duration of this test in microseconds */
+    const char *file;           /* File where the test occured */
     const char *tcname;         /* Test case that generated the result */
     const char *tname;          /* Test that generated the result */
     char *msg;                  /* Failure message */
+    int64_t duration;           /* wall time of the test in nanoseconds */
+    int64_t utime;              /* user CPU time in nanoseconds */
+    int64_t stime;              /* system CPU time in nanoseconds */
+    TestRusage rusage;          /* other resources the test used */
+    struct PerfSample *perf;    /* performance counters of the test, NULL
+                                   unless they are on; see check_perf.h */
+    BenchResult *bench;         /* NULL unless a benchmark passed */
+    TestAllocs allocs;          /* heap allocations of a passed test */
+    int64_t phases[NPHASES];    /* wall time of each enum ck_phase */
+    int line;                   /* Line number where the test occurred */
+    int iter;                   /* The iteration value for looping tests */
+    unsigned char rtype;        /* Type of result, an enum test_result */
+    unsigned char ctx;          /* When the result occurred,
+                                   an enum ck_result_ctx */
 };
 
 TestResult *tr_create(void);
 void tr_reset(TestResult * tr);
 void tr_free(TestResult * tr);
+/* The message of all passed tests, which is shared and never freed */
+char *tr_pass_msg(void);
 
 enum cl_event
 {
@@ -103,8 +199,12 @@ enum cl_event
     CLEND_T                     /* Test case end */
 };
 
+/*
+ * The last argument points to state an lfun may keep for one log,
+ * which is NULL when the log is opened.
+ */
 typedef void (*LFun) (SRunner *, FILE *, enum print_output,
-                      void *, enum cl_event);
+                      void *, enum cl_event, void **);
 
 typedef struct Log
 {
@@ -112,6 +212,9 @@ typedef struct Log
     LFun lfun;
     int close;
     enum print_output mode;
+    char *buf;                  /* stdio buffer of lfile, NULL if not ours */
+    struct timespec last_flush; /* when lfile was last flushed */
+    void *data;                 /* state of lfun for this log */
 } Log;
 
 struct SRunner
@@ -122,12 +225,64 @@ struct SRunner
     const char *log_fname;      /* name of log file */
     const char *xml_fname;      /* name of xml output file */
     const char *tap_fname;      /* name of tap output file */
+    const char *junit_fname;    /* name of JUnit XML output file */
+    const char *jsonl_fname;    /* name of JSON Lines output file */
+    const char *binlog_fname;   /* name of binary output file */
+    const char *bench_json_fname;       /* name of benchmark JSON file */
+    const char *baseline_save_fname;    /* name of baseline to write */
     List *loglst;               /* list of Log objects */
+    double flush_interval;      /* seconds between forced log flushes,
+                                   negative to only flush at suite end */
+    struct LogQueue *logq;      /* events waiting for the logging thread,
+                                   NULL if logging is synchronous */
+    int streaming;              /* 1 to drop the results of passed tests,
+                                   -1 to look at CK_STREAMING */
     enum fork_status fstat;     /* controls if suites are forked or not
                                    NOTE: Don't use this value directly,
                                    instead use srunner_fork_status */
+    struct Arena *arena;        /* holds the SRunner, its stats, logs and
+                                   the results in resultlst */
+    struct Arena *test_arena;   /* scratch space for receiving the result
+                                   of one test */
+    struct StrTable *strs;      /* file names of the results */
+    const char *perf_spec;      /* performance counters to count, NULL to
+                                   look at CK_PERF_COUNTERS */
+    struct PerfCounters *perf;  /* the counters open while running */
+    const char *baseline_fname; /* baseline to compare with, NULL to look
+                                   at CK_BASELINE */
+    double baseline_threshold;  /* percent a benchmark may regress by,
+                                   negative to look at
+                                   CK_BASELINE_THRESHOLD */
+    struct Baseline *baseline;  /* the baseline loaded while running */
+    int alloc_tracking;         /* 1 to track the allocations of tests,
+                                   -1 to look at CK_ALLOC_TRACKING */
+    int64_t alloc_limits[ALLOC_NSTATS]; /* -1 for no limit, -2 to look
+                                           at CK_ALLOC_LIMITS */
+    enum ck_timeout_clock timeout_clock;        /* the clock of timeouts */
+    double timeout_ceiling;     /* multiple of the timeout a CPU time
+                                   timeout may last, negative to look at
+                                   CK_TIMEOUT_CEILING */
+    const char *history_fname;  /* durations to take timeouts from, NULL
+                                   to look at CK_TIMEOUT_HISTORY */
+    double history_factor;      /* multiple of the p99 duration a test
+                                   may last */
+    double history_floor;       /* shortest timeout taken from it */
+    struct History *history;    /* the history loaded while running */
+    List *sflst;                /* fixtures run once around the run */
+    List *tflst;
+    int pipelined_setup;        /* 1 to run unchecked setup ahead, -1 to
+                                   look at CK_PIPELINED_SETUP */
+    struct SetupAhead *ahead;   /* the setup running ahead, if any */
+    int64_t phases[NPHASES];    /* time of each phase over the run */
+    int64_t run_start;          /* when the run started, in nanoseconds */
+    int64_t run_ns;             /* wall time of the whole run */
+    int phase_summary;          /* 1 to print the share of each phase,
+                                   -1 to look at CK_PHASE_SUMMARY */
 };
 
+/* Move tr into the arena of sr, free it and return the copy */
+TestResult *srunner_store_result(SRunner * sr, TestResult * tr);
+
 
 void set_fork_status(enum fork_status fstat);
 enum fork_status cur_fork_status(void);
@@ -22,15 +22,26 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <signal.h>
 #include <check.h>
 #if ENABLE_SUBUNIT
 #include <subunit/child.h>
 #endif
+#if HAVE_STDIO_EXT_H
+#include <stdio_ext.h>
+#endif
 
+#include "check_arena.h"
 #include "check_error.h"
 #include "check_list.h"
 #include "check_impl.h"
+#include "check_alloc.h"
+#include "check_baseline.h"
+#include "check_binlog.h"
 #include "check_log.h"
+#include "check_perf.h"
+#include "check_stats.h"
 #include "check_print.h"
 #include "check_str.h"
 
@@ -40,7 +51,25 @@
  */
 #define STDOUT_OVERRIDE_LOG_FILE_NAME "-"
 
+/*
+ * Size of the buffer given to each log file opened by the runner.
+ * Log output is only written out when the buffer fills up, at the
+ * end of a suite, or when the flush interval has elapsed.
+ */
+#define CK_LOG_BUFSIZ (64 * 1024)
+
 static void srunner_send_evt(SRunner * sr, void *obj, enum cl_event evt);
+static void srunner_dispatch_evt(SRunner * sr, void *obj,
+                                 enum cl_event evt);
+static void log_flush(SRunner * sr, Log * lg, enum cl_event evt);
+#if defined(HAVE_PTHREAD)
+typedef struct LogQueue LogQueue;
+static void log_queue_push(LogQueue * q, void *obj, enum cl_event evt,
+                           int free_obj);
+#endif
+static double get_env_flush_interval(void);
+static void install_crash_handlers(void);
+static void restore_crash_handlers(int all);
 
 void srunner_set_log(SRunner * sr, const char *fname)
 {
@@ -110,10 +139,125 @@ const char *srunner_tap_fname(SRunner * sr)
     return getenv("CK_TAP_LOG_FILE_NAME");
 }
 
+void srunner_set_junit(SRunner * sr, const char *fname)
+{
+    if(sr->junit_fname)
+        return;
+    sr->junit_fname = fname;
+}
+
+int srunner_has_junit(SRunner * sr)
+{
+    return srunner_junit_fname(sr) != NULL;
+}
+
+const char *srunner_junit_fname(SRunner * sr)
+{
+    /* check if JUnit log filename have been set explicitly */
+    if(sr->junit_fname != NULL)
+    {
+        return sr->junit_fname;
+    }
+
+    return getenv("CK_JUNIT_LOG_FILE_NAME");
+}
+
+void srunner_set_jsonl(SRunner * sr, const char *fname)
+{
+    if(sr->jsonl_fname)
+        return;
+    sr->jsonl_fname = fname;
+}
+
+int srunner_has_jsonl(SRunner * sr)
+{
+    return srunner_jsonl_fname(sr) != NULL;
+}
+
+const char *srunner_jsonl_fname(SRunner * sr)
+{
+    /* check if JSON Lines log filename have been set explicitly */
+    if(sr->jsonl_fname != NULL)
+    {
+        return sr->jsonl_fname;
+    }
+
+    return getenv("CK_JSONL_LOG_FILE_NAME");
+}
+
+void srunner_set_binlog(SRunner * sr, const char *fname)
+{
+    if(sr->binlog_fname)
+        return;
+    sr->binlog_fname = fname;
+}
+
+int srunner_has_binlog(SRunner * sr)
+{
+    return srunner_binlog_fname(sr) != NULL;
+}
+
+const char *srunner_binlog_fname(SRunner * sr)
+{
+    /* check if binary log filename have been set explicitly */
+    if(sr->binlog_fname != NULL)
+    {
+        return sr->binlog_fname;
+    }
+
+    return getenv("CK_BIN_LOG_FILE_NAME");
+}
+
+void srunner_set_bench_json(SRunner * sr, const char *fname)
+{
+    if(sr->bench_json_fname)
+        return;
+    sr->bench_json_fname = fname;
+}
+
+int srunner_has_bench_json(SRunner * sr)
+{
+    return srunner_bench_json_fname(sr) != NULL;
+}
+
+const char *srunner_bench_json_fname(SRunner * sr)
+{
+    /* check if benchmark filename have been set explicitly */
+    if(sr->bench_json_fname != NULL)
+    {
+        return sr->bench_json_fname;
+    }
+
+    return getenv("CK_BENCH_JSON_FILE_NAME");
+}
+
+void srunner_set_baseline_save(SRunner * sr, const char *fname)
+{
+    if(sr->baseline_save_fname)
+        return;
+    sr->baseline_save_fname = fname;
+}
+
+int srunner_has_baseline_save(SRunner * sr)
+{
+    return srunner_baseline_save_fname(sr) != NULL;
+}
+
+const char *srunner_baseline_save_fname(SRunner * sr)
+{
+    /* check if baseline filename have been set explicitly */
+    if(sr->baseline_save_fname != NULL)
+    {
+        return sr->baseline_save_fname;
+    }
+
+    return getenv("CK_BASELINE_SAVE");
+}
+
 void srunner_register_lfun(SRunner * sr, FILE * lfile, int close,
                            LFun lfun, enum print_output printmode)
 {
-    Log *l = (Log *)emalloc(sizeof(Log));
+    Log *l = (Log *)arena_alloc(sr->arena, sizeof(Log));
 
     if(printmode == CK_ENV)
     {
@@ -124,6 +268,23 @@ void srunner_register_lfun(SRunner * sr, FILE * lfile, int close,
     l->lfun = lfun;
     l->close = close;
     l->mode = printmode;
+    l->buf = NULL;
+    l->data = NULL;
+    /*
+     * Only files opened by the runner are block buffered. Output to
+     * stdout keeps being flushed after every event so that it stays
+     * in order with whatever the tests themselves print.
+     */
+    if(close && lfile != stdout)
+    {
+        l->buf = (char *)emalloc(CK_LOG_BUFSIZ);
+        if(setvbuf(lfile, l->buf, _IOFBF, CK_LOG_BUFSIZ) != 0)
+        {
+            free(l->buf);
+            l->buf = NULL;
+        }
+    }
+    clock_gettime(check_get_clockid(), &l->last_flush);
     check_list_add_end(sr->loglst, l);
     return;
 }
@@ -161,7 +322,22 @@ void log_test_end(SRunner * sr, TestResult * tr)
     srunner_send_evt(sr, tr, CLEND_T);
 }
 
-static void srunner_send_evt(SRunner * sr, void *obj, enum cl_event evt)
+void log_test_end_free(SRunner * sr, TestResult * tr)
+{
+#if defined(HAVE_PTHREAD)
+    if(sr->logq != NULL)
+    {
+        /* the logging thread frees it */
+        log_queue_push(sr->logq, tr, CLEND_T, 1);
+        return;
+    }
+#endif /* HAVE_PTHREAD */
+    srunner_dispatch_evt(sr, tr, CLEND_T);
+    tr_free(tr);
+}
+
+static void srunner_dispatch_evt(SRunner * sr, void *obj,
+                                 enum cl_event evt)
 {
     List *l;
     Log *lg;
@@ -170,14 +346,423 @@ static void srunner_send_evt(SRunner * sr, void *obj, enum cl_event evt)
     for(check_list_front(l); !check_list_at_end(l); check_list_advance(l))
     {
         lg = (Log *)check_list_val(l);
+        lg->lfun(sr, lg->lfile, lg->mode, obj, evt, &lg->data);
+        log_flush(sr, lg, evt);
+    }
+}
+
+static void srunner_send_evt(SRunner * sr, void *obj, enum cl_event evt)
+{
+#if defined(HAVE_PTHREAD)
+    if(sr->logq != NULL)
+    {
+        log_queue_push(sr->logq, obj, evt, 0);
+        return;
+    }
+#endif /* HAVE_PTHREAD */
+    srunner_dispatch_evt(sr, obj, evt);
+}
+
+#if defined(HAVE_PTHREAD)
+/*
+ * Number of events the runner may get ahead of the logging thread
+ * before it has to wait for it.
+ */
+#define CK_LOG_QUEUE_LEN 1024
+
+typedef struct LogEvent
+{
+    enum cl_event evt;
+    void *obj;
+    char name[100];             /* copy of the test name of CLSTART_T */
+    int free_obj;               /* obj is a TestResult to free once logged */
+} LogEvent;
+
+struct LogQueue
+{
+    SRunner *sr;
+    LogQueue *next;             /* next queue in active_queues */
+    pid_t pid;                  /* process the logging thread runs in */
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_mutex_t busy;       /* held while an event is dispatched */
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    unsigned int head;          /* next event to be dispatched */
+    unsigned int tail;          /* next free slot */
+    int done;                   /* no more events will be queued */
+    LogEvent events[CK_LOG_QUEUE_LEN];
+};
+
+/* Queues of all runners currently running in this process */
+static LogQueue *active_queues;
+
+/*
+ * Body of the logging thread. An event stays in its slot until all
+ * loggers have seen it, so the runner can not overwrite it meanwhile.
+ */
+static void *log_queue_run(void *arg)
+{
+    LogQueue *q = (LogQueue *)arg;
+    LogEvent *e;
+
+    for(;;)
+    {
+        pthread_mutex_lock(&q->lock);
+        while(q->head == q->tail && !q->done)
+            pthread_cond_wait(&q->not_empty, &q->lock);
+        if(q->head == q->tail)
+        {
+            pthread_mutex_unlock(&q->lock);
+            break;
+        }
+        e = &q->events[q->head % CK_LOG_QUEUE_LEN];
+        pthread_mutex_unlock(&q->lock);
+
+        pthread_mutex_lock(&q->busy);
+        srunner_dispatch_evt(q->sr, e->obj, e->evt);
+        pthread_mutex_unlock(&q->busy);
+        if(e->free_obj)
+            tr_free((TestResult *)e->obj);
+
+        pthread_mutex_lock(&q->lock);
+        q->head++;
+        pthread_cond_signal(&q->not_full);
+        pthread_mutex_unlock(&q->lock);
+    }
+    return NULL;
+}
+
+static void log_queue_push(LogQueue * q, void *obj, enum cl_event evt,
+                           int free_obj)
+{
+    LogEvent *e;
+
+    pthread_mutex_lock(&q->lock);
+    while(q->tail - q->head == CK_LOG_QUEUE_LEN)
+        pthread_cond_wait(&q->not_full, &q->lock);
+    e = &q->events[q->tail % CK_LOG_QUEUE_LEN];
+    e->evt = evt;
+    e->obj = obj;
+    e->free_obj = free_obj;
+    if(evt == CLSTART_T)
+    {
+        /* The name lives on the caller's stack */
+        strncpy(e->name, (const char *)obj, sizeof(e->name) - 1);
+        e->name[sizeof(e->name) - 1] = '\0';
+        e->obj = e->name;
+    }
+    q->tail++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/*
+ * Called at exit(), which in CK_NOFORK mode may come from a test. Let
+ * the logging threads catch up, so the logs show the tests that ran.
+ */
+static void log_queues_drain(void)
+{
+    LogQueue *q;
+
+    for(q = active_queues; q != NULL; q = q->next)
+    {
+        if(q->pid != getpid() || pthread_equal(q->thread, pthread_self()))
+            continue;
+        pthread_mutex_lock(&q->lock);
+        while(q->head != q->tail)
+            pthread_cond_wait(&q->not_full, &q->lock);
+        pthread_mutex_unlock(&q->lock);
+    }
+}
+
+static void log_queue_start(SRunner * sr)
+{
+    static int drain_registered = 0;
+
+    LogQueue *q = (LogQueue *)emalloc(sizeof(LogQueue));
+    int rval;
+
+    q->sr = sr;
+    q->pid = getpid();
+    q->head = 0;
+    q->tail = 0;
+    q->done = 0;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_mutex_init(&q->busy, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+
+    rval = pthread_create(&q->thread, NULL, log_queue_run, q);
+    if(rval != 0)
+    {
+        /* Not fatal, the runner just logs by itself */
+        pthread_cond_destroy(&q->not_full);
+        pthread_cond_destroy(&q->not_empty);
+        pthread_mutex_destroy(&q->busy);
+        pthread_mutex_destroy(&q->lock);
+        free(q);
+        return;
+    }
+    sr->logq = q;
+    q->next = active_queues;
+    active_queues = q;
+    if(!drain_registered)
+    {
+        drain_registered = 1;
+        atexit(log_queues_drain);
+    }
+}
+
+/*
+ * Wait for the logging thread to write out all queued events.
+ */
+static void log_queue_stop(SRunner * sr)
+{
+    LogQueue *q = sr->logq;
+    LogQueue **qp;
+
+    for(qp = &active_queues; *qp != NULL; qp = &(*qp)->next)
+    {
+        if(*qp == q)
+        {
+            *qp = q->next;
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&q->lock);
+    q->done = 1;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+    pthread_join(q->thread, NULL);
+
+    pthread_cond_destroy(&q->not_full);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_mutex_destroy(&q->busy);
+    pthread_mutex_destroy(&q->lock);
+    free(q);
+    sr->logq = NULL;
+}
+
+static int get_env_async_logging(void)
+{
+    char *env = getenv("CK_ASYNC_LOGGING");
+
+    return env != NULL && strcmp(env, "yes") == 0;
+}
+#endif /* HAVE_PTHREAD */
+
+/*
+ * Write out buffered log output if the event ends a suite or the
+ * run, or if the configured flush interval has elapsed.
+ */
+static void log_flush(SRunner * sr, Log * lg, enum cl_event evt)
+{
+    struct timespec now;
+    int flush;
+
+    switch (evt)
+    {
+        case CLEND_S:
+        case CLEND_SR:
+        case CLENDLOG_SR:
+            flush = 1;
+            break;
+        default:
+            flush = (lg->buf == NULL || sr->flush_interval == 0);
+            break;
+    }
+
+    if(flush || sr->flush_interval > 0)
+    {
+        clock_gettime(check_get_clockid(), &now);
+        if(!flush && DIFF_IN_USEC(lg->last_flush, now) >=
+           sr->flush_interval * US_PER_SEC)
+        {
+            flush = 1;
+        }
+    }
+
+    if(flush)
+    {
         fflush(lg->lfile);
-        lg->lfun(sr, lg->lfile, lg->mode, obj, evt);
-        fflush(lg->lfile);
+        lg->last_flush = now;
+    }
+}
+
+void srunner_prepare_fork(SRunner * sr)
+{
+#if defined(HAVE_PTHREAD)
+    /*
+     * Wait for the logging thread to finish the event it is working
+     * on, so the child does not inherit a stream that is half way
+     * through being written to. The thread is held there until
+     * srunner_forked_parent().
+     */
+    if(sr->logq != NULL)
+    {
+        pthread_mutex_lock(&sr->logq->busy);
+    }
+#endif /* HAVE_PTHREAD */
+#if !HAVE___FPURGE && !HAVE_FPURGE
+    {
+        List *l;
+
+        /*
+         * Without a way to discard the child's copy of the buffers,
+         * they must be empty when fork() is called.
+         */
+        l = sr->loglst;
+        for(check_list_front(l); !check_list_at_end(l);
+            check_list_advance(l))
+        {
+            fflush(((Log *)check_list_val(l))->lfile);
+        }
+    }
+#else
+    (void)sr;
+#endif
+}
+
+void srunner_forked_parent(SRunner * sr)
+{
+#if defined(HAVE_PTHREAD)
+    if(sr->logq != NULL)
+    {
+        pthread_mutex_unlock(&sr->logq->busy);
+    }
+#else
+    (void)sr;
+#endif /* HAVE_PTHREAD */
+}
+
+void srunner_forked_child(SRunner * sr)
+{
+    List *l;
+
+    /*
+     * There is no logging thread in the child, and its queue is still
+     * locked by the parent. Leave it alone.
+     */
+    sr->logq = NULL;
+    restore_crash_handlers(1);
+
+    l = sr->loglst;
+    for(check_list_front(l); !check_list_at_end(l); check_list_advance(l))
+    {
+        Log *lg = (Log *)check_list_val(l);
+
+        /*
+         * The child has a copy of whatever the parent had buffered.
+         * Drop it, or the child's exit() would write it a second time.
+         */
+        if(lg->buf != NULL)
+        {
+#if HAVE___FPURGE
+            __fpurge(lg->lfile);
+#elif HAVE_FPURGE
+            fpurge(lg->lfile);
+#endif
+        }
+    }
+}
+
+static double get_env_flush_interval(void)
+{
+    char *env = getenv("CK_LOG_FLUSH_INTERVAL");
+
+    if(env != NULL)
+    {
+        char *endptr = NULL;
+        double tmp = strtod(env, &endptr);
+
+        if(tmp >= 0 && endptr != env && (*endptr) == '\0')
+        {
+            return tmp;
+        }
+    }
+
+    return -1;
+}
+
+#if defined(HAVE_SIGACTION)
+static const int crash_signals[] = {
+    SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT, SIGTERM, SIGINT
+};
+
+#define N_CRASH_SIGNALS (sizeof(crash_signals) / sizeof(crash_signals[0]))
+
+static struct sigaction crash_old_actions[N_CRASH_SIGNALS];
+static int crash_handlers_installed;
+
+/*
+ * Write out whatever the logs still hold before the runner dies, then
+ * let the signal take its usual course. fflush() is not async-signal
+ * safe, but at this point losing the log output is the alternative.
+ */
+static void crash_handler(int sig_nr)
+{
+    unsigned int i;
+
+    fflush(NULL);
+    for(i = 0; i < N_CRASH_SIGNALS; i++)
+    {
+        if(crash_signals[i] == sig_nr)
+        {
+            sigaction(sig_nr, &crash_old_actions[i], NULL);
+        }
+    }
+    raise(sig_nr);
+}
+#endif /* HAVE_SIGACTION */
+
+/*
+ * Runners may be nested, so only the outermost one installs and
+ * removes the handlers. A forked child removes them altogether, so
+ * tests see the signal dispositions they would see without Check.
+ */
+static void install_crash_handlers(void)
+{
+#if defined(HAVE_SIGACTION)
+    unsigned int i;
+    struct sigaction action;
+
+    if(crash_handlers_installed++ > 0)
+        return;
+
+    memset(&action, 0, sizeof action);
+    action.sa_handler = crash_handler;
+    sigemptyset(&action.sa_mask);
+    for(i = 0; i < N_CRASH_SIGNALS; i++)
+    {
+        sigaction(crash_signals[i], &action, &crash_old_actions[i]);
+    }
+#endif /* HAVE_SIGACTION */
+}
+
+static void restore_crash_handlers(int all)
+{
+#if defined(HAVE_SIGACTION)
+    unsigned int i;
+
+    if(crash_handlers_installed == 0)
+        return;
+    crash_handlers_installed = all ? 0 : crash_handlers_installed - 1;
+    if(crash_handlers_installed > 0)
+        return;
+
+    for(i = 0; i < N_CRASH_SIGNALS; i++)
+    {
+        sigaction(crash_signals[i], &crash_old_actions[i], NULL);
     }
+#else
+    (void)all;
+#endif /* HAVE_SIGACTION */
 }
 
 void stdout_lfun(SRunner * sr, FILE * file, enum print_output printmode,
-                 void *obj, enum cl_event evt)
+                 void *obj, enum cl_event evt, void **data CK_ATTRIBUTE_UNUSED)
 {
     Suite *s;
 
@@ -226,7 +811,7 @@ void stdout_lfun(SRunner * sr, FILE * file, enum print_output printmode,
 
 void lfile_lfun(SRunner * sr, FILE * file,
                 enum print_output printmode CK_ATTRIBUTE_UNUSED, void *obj,
-                enum cl_event evt)
+                enum cl_event evt, void **data CK_ATTRIBUTE_UNUSED)
 {
     TestResult *tr;
     Suite *s;
@@ -265,7 +850,7 @@ void lfile_lfun(SRunner * sr, FILE * file,
 
 void xml_lfun(SRunner * sr CK_ATTRIBUTE_UNUSED, FILE * file,
               enum print_output printmode CK_ATTRIBUTE_UNUSED, void *obj,
-              enum cl_event evt)
+              enum cl_event evt, void **data CK_ATTRIBUTE_UNUSED)
 {
     TestResult *tr;
     Suite *s;
@@ -299,13 +884,12 @@ void xml_lfun(SRunner * sr CK_ATTRIBUTE_UNUSED, FILE * file,
         case CLENDLOG_SR:
         {
             struct timespec ts_end = { 0, 0 };
-            unsigned long duration;
 
             /* calculate time the test were running */
             clock_gettime(check_get_clockid(), &ts_end);
-            duration = (unsigned long)DIFF_IN_USEC(ts_start, ts_end);
-            fprintf(file, "  <duration>%lu.%06lu</duration>\n",
-                    duration / US_PER_SEC, duration % US_PER_SEC);
+            fprintf(file, "  <duration>");
+            fprint_seconds(file, DIFF_IN_NSEC(ts_start, ts_end), 9);
+            fprintf(file, "</duration>\n");
             fprintf(file, "</testsuites>\n");
         }
             break;
@@ -336,9 +920,80 @@ void xml_lfun(SRunner * sr CK_ATTRIBUTE_UNUSED, FILE * file,
 
 }
 
+/* Print the known times and rusage of tr as a TAP version 13 YAML block */
+static void tap_print_usage(FILE * file, TestResult * tr)
+{
+    long rusage[RUSAGE_NFIELDS];
+    int nphases = 0;
+    int i;
+
+    for(i = 0; i < NPHASES; i++)
+    {
+        if(tr->phases[i] >= 0)
+            nphases++;
+    }
+    if(tr->duration < 0 && tr->utime < 0 && tr->stime < 0 &&
+       tr->rusage.maxrss < 0 && tr->perf == NULL && tr->bench == NULL &&
+       tr->allocs.allocs < 0 && nphases == 0)
+        return;
+    fprintf(file, "  ---\n");
+    if(tr->duration >= 0)
+        fprintf(file, "  duration_ns: %jd\n", (intmax_t)tr->duration);
+    if(tr->utime >= 0)
+        fprintf(file, "  user_ns: %jd\n", (intmax_t)tr->utime);
+    if(tr->stime >= 0)
+        fprintf(file, "  system_ns: %jd\n", (intmax_t)tr->stime);
+    if(nphases > 0)
+    {
+        fprintf(file, "  phases:\n");
+        for(i = 0; i < NPHASES; i++)
+        {
+            if(tr->phases[i] >= 0)
+                fprintf(file, "    %s_ns: %jd\n", phase_names[i],
+                        (intmax_t)tr->phases[i]);
+        }
+    }
+    if(tr->rusage.maxrss >= 0)
+    {
+        rusage_values(&tr->rusage, rusage);
+        fprintf(file, "  rusage:\n");
+        for(i = 0; i < RUSAGE_NFIELDS; i++)
+            fprintf(file, "    %s: %ld\n", rusage_names[i], rusage[i]);
+    }
+    if(tr->perf != NULL)
+    {
+        fprintf(file, "  perf:\n");
+        for(i = 0; i < tr->perf->n; i++)
+            fprintf(file, "    %s: %jd\n", tr->perf->names[i],
+                    (intmax_t)tr->perf->values[i]);
+    }
+    if(tr->allocs.allocs >= 0)
+    {
+        int64_t allocs[ALLOC_NSTATS];
+
+        alloc_stat_values(&tr->allocs, allocs);
+        fprintf(file, "  allocs:\n");
+        for(i = 0; i < ALLOC_NSTATS; i++)
+            fprintf(file, "    %s: %jd\n", alloc_stat_names[i],
+                    (intmax_t)allocs[i]);
+    }
+    if(tr->bench != NULL)
+    {
+        double stats[BENCH_NSTATS];
+
+        bench_stat_values(tr->bench, stats);
+        fprintf(file, "  bench:\n");
+        fprintf(file, "    iterations: %jd\n", (intmax_t)tr->bench->iterations);
+        fprintf(file, "    samples: %d\n", tr->bench->nsamples);
+        for(i = 0; i < BENCH_NSTATS; i++)
+            fprintf(file, "    %s_ns: %.3f\n", bench_stat_names[i], stats[i]);
+    }
+    fprintf(file, "  ...\n");
+}
+
 void tap_lfun(SRunner * sr CK_ATTRIBUTE_UNUSED, FILE * file,
               enum print_output printmode CK_ATTRIBUTE_UNUSED, void *obj,
-              enum cl_event evt)
+              enum cl_event evt, void **data CK_ATTRIBUTE_UNUSED)
 {
     TestResult *tr;
 
@@ -349,11 +1004,12 @@ void tap_lfun(SRunner * sr CK_ATTRIBUTE_UNUSED, FILE * file,
         case CLINITLOG_SR:
             /* As this is a new log file, reset the number of tests executed */
             num_tests_run = 0;
+            /* needed for the timings in YAML blocks */
+            fprintf(file, "TAP version 13\n");
             break;
         case CLENDLOG_SR:
             /* Output the test plan as the last line */
             fprintf(file, "1..%d\n", num_tests_run);
-            fflush(file);
             break;
         case CLSTART_SR:
             break;
@@ -372,7 +1028,7 @@ void tap_lfun(SRunner * sr CK_ATTRIBUTE_UNUSED, FILE * file,
             fprintf(file, "%s %d - %s:%s:%s: %s\n",
                     tr->rtype == CK_PASS ? "ok" : "not ok", num_tests_run,
                     tr->file, tr->tcname, tr->tname, tr->msg);
-            fflush(file);
+            tap_print_usage(file, tr);
             break;
         default:
             eprintf("Bad event type received in tap_lfun", __FILE__,
@@ -380,9 +1036,290 @@ void tap_lfun(SRunner * sr CK_ATTRIBUTE_UNUSED, FILE * file,
     }
 }
 
+/*
+ * Room left in each <testsuite> start tag for the counts, which are
+ * only known once the suite has run. Attributes may be followed by
+ * any amount of white space, so unused room is left as spaces.
+ */
+#define JUNIT_COUNTS_LEN \
+    (sizeof(" tests=\"2147483647\" failures=\"2147483647\"" \
+            " errors=\"2147483647\" time=\"4294967295.999999\"") - 1)
+
+/*
+ * Write the counts of a suite into the room reserved at pos, and
+ * return to the end of the file.
+ */
+static void junit_fprint_counts(FILE * file, long pos, int ntests,
+                                int nfailures, int nerrors,
+                                unsigned long duration)
+{
+    char counts[JUNIT_COUNTS_LEN + 1];
+    long end;
+    int len;
+
+    len = snprintf(counts, sizeof(counts),
+                   " tests=\"%d\" failures=\"%d\" errors=\"%d\""
+                   " time=\"%lu.%06lu\"", ntests, nfailures, nerrors,
+                   duration / US_PER_SEC, duration % US_PER_SEC);
+    if(len < 0 || (size_t)len > JUNIT_COUNTS_LEN)
+        return;
+
+    end = ftell(file);
+    if(end < 0 || fseek(file, pos, SEEK_SET) != 0)
+        return;
+    fwrite(counts, 1, (size_t)len, file);
+    if(fseek(file, end, SEEK_SET) != 0)
+        eprintf("Error in call to fseek while writing JUnit log:",
+                __FILE__, __LINE__ - 1);
+}
+
+/* State of a JUnit log */
+typedef struct JUnitLog
+{
+    long counts_pos;            /* where the counts of the current suite
+                                   go, -1 if nowhere */
+    int ntests;
+    int nfailures;
+    int nerrors;
+    struct timespec ts_start;   /* when the current suite started */
+} JUnitLog;
+
+void junit_lfun(SRunner * sr CK_ATTRIBUTE_UNUSED, FILE * file,
+                enum print_output printmode CK_ATTRIBUTE_UNUSED, void *obj,
+                enum cl_event evt, void **data)
+{
+    TestResult *tr;
+    Suite *s;
+    JUnitLog *jl = (JUnitLog *)*data;
+
+    switch (evt)
+    {
+        case CLINITLOG_SR:
+            jl = (JUnitLog *)emalloc(sizeof(JUnitLog));
+            jl->counts_pos = -1;
+            jl->ntests = 0;
+            jl->nfailures = 0;
+            jl->nerrors = 0;
+            *data = jl;
+            fprintf(file, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+            fprintf(file, "<testsuites>\n");
+            break;
+        case CLENDLOG_SR:
+            fprintf(file, "</testsuites>\n");
+            free(jl);
+            *data = NULL;
+            break;
+        case CLSTART_SR:
+            break;
+        case CLSTART_S:
+            s = (Suite *)obj;
+            jl->ntests = 0;
+            jl->nfailures = 0;
+            jl->nerrors = 0;
+            clock_gettime(check_get_clockid(), &jl->ts_start);
+            fprintf(file, "  <testsuite name=\"");
+            fprint_xml_esc(file, s->name);
+            fprintf(file, "\"");
+            /*
+             * Output to stdout may be a pipe, or be shared with other
+             * output, so it is never seeked.
+             */
+            jl->counts_pos = file == stdout ? -1 : ftell(file);
+            fprintf(file, "%*s>\n", (int)JUNIT_COUNTS_LEN, "");
+            break;
+        case CLEND_SR:
+            break;
+        case CLEND_S:
+            if(jl->counts_pos >= 0)
+            {
+                struct timespec ts_end = { 0, 0 };
+
+                clock_gettime(check_get_clockid(), &ts_end);
+                junit_fprint_counts(file, jl->counts_pos, jl->ntests,
+                                    jl->nfailures, jl->nerrors,
+                                    (unsigned long)
+                                    DIFF_IN_USEC(jl->ts_start, ts_end));
+            }
+            fprintf(file, "  </testsuite>\n");
+            break;
+        case CLSTART_T:
+            break;
+        case CLEND_T:
+            tr = (TestResult *)obj;
+            jl->ntests++;
+            if(tr->rtype == CK_FAILURE)
+                jl->nfailures++;
+            else if(tr->rtype == CK_ERROR)
+                jl->nerrors++;
+            tr_junitprint(file, tr, CK_VERBOSE);
+            break;
+        default:
+            eprintf("Bad event type received in junit_lfun", __FILE__,
+                    __LINE__);
+    }
+}
+
+void jsonl_lfun(SRunner * sr CK_ATTRIBUTE_UNUSED, FILE * file,
+                enum print_output printmode CK_ATTRIBUTE_UNUSED, void *obj,
+                enum cl_event evt, void **data)
+{
+    /* the state is the suite being run */
+    Suite *s = (Suite *)*data;
+
+    switch (evt)
+    {
+        case CLINITLOG_SR:
+            *data = NULL;
+            break;
+        case CLENDLOG_SR:
+            *data = NULL;
+            break;
+        case CLSTART_SR:
+            break;
+        case CLSTART_S:
+            *data = obj;
+            break;
+        case CLEND_SR:
+            break;
+        case CLEND_S:
+            break;
+        case CLSTART_T:
+            break;
+        case CLEND_T:
+            tr_jsonprint(file, (TestResult *)obj, s != NULL ? s->name : NULL);
+            break;
+        default:
+            eprintf("Bad event type received in jsonl_lfun", __FILE__,
+                    __LINE__);
+    }
+}
+
+void bin_lfun(SRunner * sr CK_ATTRIBUTE_UNUSED, FILE * file,
+              enum print_output printmode CK_ATTRIBUTE_UNUSED, void *obj,
+              enum cl_event evt, void **data)
+{
+    BinLogWriter *w = (BinLogWriter *)*data;
+
+    switch (evt)
+    {
+        case CLINITLOG_SR:
+            *data = binlog_writer_create(file);
+            break;
+        case CLENDLOG_SR:
+            binlog_writer_free(w);
+            *data = NULL;
+            break;
+        case CLSTART_SR:
+            break;
+        case CLSTART_S:
+            binlog_write_suite(w, ((Suite *)obj)->name);
+            break;
+        case CLEND_SR:
+            break;
+        case CLEND_S:
+            break;
+        case CLSTART_T:
+            break;
+        case CLEND_T:
+            binlog_write_result(w, (TestResult *)obj);
+            break;
+        default:
+            eprintf("Bad event type received in bin_lfun", __FILE__,
+                    __LINE__);
+    }
+}
+
+/* State of a benchmark JSON log */
+typedef struct BenchJsonLog
+{
+    const char *sname;          /* the suite being run */
+    int nbenches;               /* benchmarks written so far */
+} BenchJsonLog;
+
+void bench_json_lfun(SRunner * sr CK_ATTRIBUTE_UNUSED, FILE * file,
+                     enum print_output printmode CK_ATTRIBUTE_UNUSED,
+                     void *obj, enum cl_event evt, void **data)
+{
+    BenchJsonLog *bl = (BenchJsonLog *)*data;
+    TestResult *tr;
+
+    switch (evt)
+    {
+        case CLINITLOG_SR:
+            bl = (BenchJsonLog *)emalloc(sizeof(BenchJsonLog));
+            bl->sname = NULL;
+            bl->nbenches = 0;
+            *data = bl;
+            gbench_fprint_start(file);
+            break;
+        case CLENDLOG_SR:
+            gbench_fprint_end(file);
+            free(bl);
+            *data = NULL;
+            break;
+        case CLSTART_SR:
+            break;
+        case CLSTART_S:
+            bl->sname = ((Suite *)obj)->name;
+            break;
+        case CLEND_SR:
+            break;
+        case CLEND_S:
+            break;
+        case CLSTART_T:
+            break;
+        case CLEND_T:
+            tr = (TestResult *)obj;
+            if(tr->bench != NULL)
+                tr_gbenchprint(file, tr, bl->sname, bl->nbenches++ == 0);
+            break;
+        default:
+            eprintf("Bad event type received in bench_json_lfun", __FILE__,
+                    __LINE__);
+    }
+}
+
+void baseline_lfun(SRunner * sr CK_ATTRIBUTE_UNUSED, FILE * file,
+                   enum print_output printmode CK_ATTRIBUTE_UNUSED,
+                   void *obj, enum cl_event evt, void **data)
+{
+    /* the state is the suite being run */
+    Suite *s = (Suite *)*data;
+
+    switch (evt)
+    {
+        case CLINITLOG_SR:
+            *data = NULL;
+            baseline_write_header(file);
+            break;
+        case CLENDLOG_SR:
+            *data = NULL;
+            break;
+        case CLSTART_SR:
+            break;
+        case CLSTART_S:
+            *data = obj;
+            break;
+        case CLEND_SR:
+            break;
+        case CLEND_S:
+            break;
+        case CLSTART_T:
+            break;
+        case CLEND_T:
+            baseline_write_result(file, (TestResult *)obj,
+                                  s != NULL ? s->name : NULL);
+            break;
+        default:
+            eprintf("Bad event type received in baseline_lfun", __FILE__,
+                    __LINE__);
+    }
+}
+
 #if ENABLE_SUBUNIT
 void subunit_lfun(SRunner * sr, FILE * file, enum print_output printmode,
-                  void *obj, enum cl_event evt)
+                  void *obj, enum cl_event evt,
+                  void **data CK_ATTRIBUTE_UNUSED)
 {
     TestResult *tr;
     char const *name;
@@ -445,7 +1382,7 @@ void subunit_lfun(SRunner * sr, FILE * file, enum print_output printmode,
 }
 #endif
 
-static FILE *srunner_open_file(const char *filename)
+static FILE *srunner_open_file(const char *filename, const char *mode)
 {
     FILE *f = NULL;
 
@@ -455,7 +1392,7 @@ static FILE *srunner_open_file(const char *filename)
     }
     else
     {
-        f = fopen(filename, "w");
+        f = fopen(filename, mode);
         if(f == NULL)
         {
             eprintf("Error in call to fopen while opening file %s:", __FILE__,
@@ -471,7 +1408,7 @@ FILE *srunner_open_lfile(SRunner * sr)
 
     if(srunner_has_log(sr))
     {
-        f = srunner_open_file(srunner_log_fname(sr));
+        f = srunner_open_file(srunner_log_fname(sr), "w");
     }
     return f;
 }
@@ -482,7 +1419,7 @@ FILE *srunner_open_xmlfile(SRunner * sr)
 
     if(srunner_has_xml(sr))
     {
-        f = srunner_open_file(srunner_xml_fname(sr));
+        f = srunner_open_file(srunner_xml_fname(sr), "w");
     }
     return f;
 }
@@ -493,7 +1430,62 @@ FILE *srunner_open_tapfile(SRunner * sr)
 
     if(srunner_has_tap(sr))
     {
-        f = srunner_open_file(srunner_tap_fname(sr));
+        f = srunner_open_file(srunner_tap_fname(sr), "w");
+    }
+    return f;
+}
+
+FILE *srunner_open_junitfile(SRunner * sr)
+{
+    FILE *f = NULL;
+
+    if(srunner_has_junit(sr))
+    {
+        f = srunner_open_file(srunner_junit_fname(sr), "w");
+    }
+    return f;
+}
+
+FILE *srunner_open_jsonlfile(SRunner * sr)
+{
+    FILE *f = NULL;
+
+    if(srunner_has_jsonl(sr))
+    {
+        f = srunner_open_file(srunner_jsonl_fname(sr), "w");
+    }
+    return f;
+}
+
+FILE *srunner_open_binfile(SRunner * sr)
+{
+    FILE *f = NULL;
+
+    if(srunner_has_binlog(sr))
+    {
+        f = srunner_open_file(srunner_binlog_fname(sr), "wb");
+    }
+    return f;
+}
+
+FILE *srunner_open_benchfile(SRunner * sr)
+{
+    FILE *f = NULL;
+
+    if(srunner_has_bench_json(sr))
+    {
+        f = srunner_open_file(srunner_bench_json_fname(sr), "w");
+    }
+    return f;
+}
+
+FILE *srunner_open_baselinefile(SRunner * sr)
+{
+    FILE *f = NULL;
+
+    if(srunner_has_baseline_save(sr))
+    {
+        f = srunner_open_file(srunner_baseline_save_fname(sr), "w");
     }
     return f;
 }
@@ -503,6 +1495,7 @@ void srunner_init_logging(SRunner * sr, enum print_output print_mode)
     FILE *f;
 
     sr->loglst = check_list_create();
+    sr->flush_interval = get_env_flush_interval();
 #if ENABLE_SUBUNIT
     if(print_mode != CK_SUBUNIT)
 #endif
@@ -526,6 +1519,39 @@ void srunner_init_logging(SRunner * sr, enum print_output print_mode)
     {
         srunner_register_lfun(sr, f, f != stdout, tap_lfun, print_mode);
     }
+    f = srunner_open_junitfile(sr);
+    if(f)
+    {
+        srunner_register_lfun(sr, f, f != stdout, junit_lfun, print_mode);
+    }
+    f = srunner_open_jsonlfile(sr);
+    if(f)
+    {
+        srunner_register_lfun(sr, f, f != stdout, jsonl_lfun, print_mode);
+    }
+    f = srunner_open_binfile(sr);
+    if(f)
+    {
+        srunner_register_lfun(sr, f, f != stdout, bin_lfun, print_mode);
+    }
+    f = srunner_open_benchfile(sr);
+    if(f)
+    {
+        srunner_register_lfun(sr, f, f != stdout, bench_json_lfun,
+                              print_mode);
+    }
+    f = srunner_open_baselinefile(sr);
+    if(f)
+    {
+        srunner_register_lfun(sr, f, f != stdout, baseline_lfun, print_mode);
+    }
+    install_crash_handlers();
+#if defined(HAVE_PTHREAD)
+    if(get_env_async_logging())
+    {
+        log_queue_start(sr);
+    }
+#endif /* HAVE_PTHREAD */
     srunner_send_evt(sr, NULL, CLINITLOG_SR);
 }
 
@@ -535,6 +1561,13 @@ void srunner_end_logging(SRunner * sr)
     int rval;
 
     srunner_send_evt(sr, NULL, CLENDLOG_SR);
+#if defined(HAVE_PTHREAD)
+    if(sr->logq != NULL)
+    {
+        log_queue_stop(sr);
+    }
+#endif /* HAVE_PTHREAD */
+    restore_crash_handlers(0);
 
     l = sr->loglst;
     for(check_list_front(l); !check_list_at_end(l); check_list_advance(l))
@@ -548,7 +1581,8 @@ void srunner_end_logging(SRunner * sr)
                 eprintf("Error in call to fclose while closing log file:",
                         __FILE__, __LINE__ - 2);
         }
-        free(lg);
+        /* the Log itself is in the runner's arena */
+        free(lg->buf);
     }
     check_list_free(l);
     sr->loglst = NULL;
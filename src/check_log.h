@@ -26,22 +26,40 @@ void log_srunner_end(SRunner * sr);
 void log_suite_start(SRunner * sr, Suite * s);
 void log_suite_end(SRunner * sr, Suite * s);
 void log_test_end(SRunner * sr, TestResult * tr);
+/* log the end of a test whose result the runner does not keep, and
+   free the result once all logs have seen it */
+void log_test_end_free(SRunner * sr, TestResult * tr);
 void log_test_start(SRunner * sr, TCase * tc, TF * tfun);
 
 void stdout_lfun(SRunner * sr, FILE * file, enum print_output,
-                 void *obj, enum cl_event evt);
+                 void *obj, enum cl_event evt, void **data);
 
 void lfile_lfun(SRunner * sr, FILE * file, enum print_output,
-                void *obj, enum cl_event evt);
+                void *obj, enum cl_event evt, void **data);
 
 void xml_lfun(SRunner * sr, FILE * file, enum print_output,
-              void *obj, enum cl_event evt);
+              void *obj, enum cl_event evt, void **data);
 
 void tap_lfun(SRunner * sr, FILE * file, enum print_output,
-              void *obj, enum cl_event evt);
+              void *obj, enum cl_event evt, void **data);
+
+void junit_lfun(SRunner * sr, FILE * file, enum print_output,
+                void *obj, enum cl_event evt, void **data);
+
+void jsonl_lfun(SRunner * sr, FILE * file, enum print_output,
+                void *obj, enum cl_event evt, void **data);
+
+void bin_lfun(SRunner * sr, FILE * file, enum print_output,
+              void *obj, enum cl_event evt, void **data);
+
+void bench_json_lfun(SRunner * sr, FILE * file, enum print_output,
+                     void *obj, enum cl_event evt, void **data);
+
+void baseline_lfun(SRunner * sr, FILE * file, enum print_output,
+                   void *obj, enum cl_event evt, void **data);
 
 void subunit_lfun(SRunner * sr, FILE * file, enum print_output,
-                  void *obj, enum cl_event evt);
+                  void *obj, enum cl_event evt, void **data);
 
 void srunner_register_lfun(SRunner * sr, FILE * lfile, int close,
                            LFun lfun, enum print_output);
@@ -49,7 +67,19 @@ void srunner_register_lfun(SRunner * sr, FILE * lfile, int close,
 FILE *srunner_open_lfile(SRunner * sr);
 FILE *srunner_open_xmlfile(SRunner * sr);
 FILE *srunner_open_tapfile(SRunner * sr);
+FILE *srunner_open_junitfile(SRunner * sr);
+FILE *srunner_open_jsonlfile(SRunner * sr);
+FILE *srunner_open_binfile(SRunner * sr);
+FILE *srunner_open_benchfile(SRunner * sr);
+FILE *srunner_open_baselinefile(SRunner * sr);
 void srunner_init_logging(SRunner * sr, enum print_output print_mode);
 void srunner_end_logging(SRunner * sr);
 
+/* To be called by the parent right before a test is forked, and by
+   both processes right after, so that buffered log output is written
+   out by the parent only and the logging thread is idle at fork() */
+void srunner_prepare_fork(SRunner * sr);
+void srunner_forked_parent(SRunner * sr);
+void srunner_forked_child(SRunner * sr);
+
 #endif /* CHECK_LOG_H */
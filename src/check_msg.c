@@ -28,9 +28,11 @@
 #include "check_error.h"
 #include "check.h"
 #include "check_list.h"
+#include "check_arena.h"
 #include "check_impl.h"
 #include "check_msg.h"
 #include "check_pack.h"
+#include "check_stats.h"
 #include "check_str.h"
 
 
@@ -59,14 +61,43 @@ static char *send_file1_name;
 static FILE *send_file2;
 static char *send_file2_name;
 
+#if defined(HAVE_PTHREAD)
+/*
+ * A thread running fixtures while the tests run has a pipe of its own,
+ * and a jmp_buf of its own to return to when one of them fails.
+ */
+typedef struct ThreadPipe
+{
+    FILE *file;
+    char *name;
+    jmp_buf *jmp;
+} ThreadPipe;
+
+static pthread_key_t thread_pipe_key;
+static pthread_once_t thread_pipe_once = PTHREAD_ONCE_INIT;
+
+static ThreadPipe *thread_pipe(void);
+#endif /* HAVE_PTHREAD */
+
 static FILE *get_pipe(void);
 static void setup_pipe(void);
 static void teardown_pipe(void);
+static void reset_pipe(void);
+static void close_tmp_file(FILE * file, char *name);
 static TestResult *construct_test_result(RcvMsg * rmsg, int waserror);
 static void tr_set_loc_by_ctx(TestResult * tr, enum ck_result_ctx ctx,
                               RcvMsg * rmsg);
 static FILE *get_pipe(void)
 {
+#if defined(HAVE_PTHREAD)
+    ThreadPipe *tp = thread_pipe();
+
+    if(tp != NULL)
+    {
+        return tp->file;
+    }
+#endif /* HAVE_PTHREAD */
+
     if(send_file2 != 0)
     {
         return send_file2;
@@ -86,27 +117,56 @@ void send_failure_info(const char *msg)
 {
     FailMsg fmsg;
 
-    fmsg.msg = strdup(msg);
+    fmsg.msg = (char *)msg;
     ppack(get_pipe(), CK_MSG_FAIL, (CheckMsg *) & fmsg);
-    free(fmsg.msg);
 }
 
-void send_duration_info(int duration)
+void send_duration_info(int64_t duration, int64_t setup, int64_t teardown,
+                        int64_t end)
 {
     DurationMsg dmsg;
 
     dmsg.duration = duration;
+    dmsg.setup = setup;
+    dmsg.teardown = teardown;
+    dmsg.end = end;
     ppack(get_pipe(), CK_MSG_DURATION, (CheckMsg *) & dmsg);
 }
 
+void send_bench_info(int64_t iterations, int nsamples,
+                     const int64_t * samples, const int64_t * cpu_samples)
+{
+    BenchMsg bmsg;
+
+    bmsg.iterations = iterations;
+    bmsg.nsamples = nsamples;
+    bmsg.cpu = 0;
+    bmsg.samples = (int64_t *)samples;
+    ppack(get_pipe(), CK_MSG_BENCH, (CheckMsg *) & bmsg);
+    /* in a message of their own, to keep each within the size of one */
+    if(cpu_samples != NULL)
+    {
+        bmsg.cpu = 1;
+        bmsg.samples = (int64_t *)cpu_samples;
+        ppack(get_pipe(), CK_MSG_BENCH, (CheckMsg *) & bmsg);
+    }
+}
+
+void send_alloc_info(const TestAllocs * allocs)
+{
+    AllocMsg amsg;
+
+    amsg.allocs = *allocs;
+    ppack(get_pipe(), CK_MSG_ALLOC, (CheckMsg *) & amsg);
+}
+
 void send_loc_info(const char *file, int line)
 {
     LocMsg lmsg;
 
-    lmsg.file = strdup(file);
+    lmsg.file = (char *)file;
     lmsg.line = line;
     ppack(get_pipe(), CK_MSG_LOC, (CheckMsg *) & lmsg);
-    free(lmsg.file);
 }
 
 void send_ctx_info(enum ck_result_ctx ctx)
@@ -117,7 +177,7 @@ void send_ctx_info(enum ck_result_ctx ctx)
     ppack(get_pipe(), CK_MSG_CTX, (CheckMsg *) & cmsg);
 }
 
-TestResult *receive_test_result(int waserror)
+TestResult *receive_test_result(Arena * a, int waserror)
 {
     FILE *fp;
     RcvMsg *rmsg;
@@ -130,38 +190,36 @@ TestResult *receive_test_result(int waserror)
     }
 
     rewind(fp);
-    rmsg = punpack(fp);
+    rmsg = punpack(fp, a);
 
     if(rmsg == NULL)
     {
         eprintf("Error in call to punpack", __FILE__, __LINE__ - 4);
     }
 
-    teardown_pipe();
-    setup_pipe();
+    reset_pipe();
 
     result = construct_test_result(rmsg, waserror);
-    rcvmsg_free(rmsg);
+    arena_reset(a);
     return result;
 }
 
 static void tr_set_loc_by_ctx(TestResult * tr, enum ck_result_ctx ctx,
                               RcvMsg * rmsg)
 {
+    const char *file;
+
     if(ctx == CK_CTX_TEST)
     {
-        tr->file = rmsg->test_file;
+        file = rmsg->test_file;
         tr->line = rmsg->test_line;
-        rmsg->test_file = NULL;
-        rmsg->test_line = -1;
     }
     else
     {
-        tr->file = rmsg->fixture_file;
+        file = rmsg->fixture_file;
         tr->line = rmsg->fixture_line;
-        rmsg->fixture_file = NULL;
-        rmsg->fixture_line = -1;
     }
+    tr->file = file == NULL ? NULL : strdup(file);
 }
 
 static TestResult *construct_test_result(RcvMsg * rmsg, int waserror)
@@ -184,8 +242,9 @@ static TestResult *construct_test_result(RcvMsg * rmsg, int waserror)
             tr->ctx = rmsg->lastctx;
         }
 
-        tr->msg = rmsg->msg;
-        rmsg->msg = NULL;
+        tr->msg = rmsg->msg == NULL ? NULL : strdup(rmsg->msg);
+        /* sent by a test process that failed, not one that crashed */
+        tr->phases[CK_PHASE_REAP] = rmsg->end;
         tr_set_loc_by_ctx(tr, tr->ctx, rmsg);
     }
     else if(rmsg->lastctx == CK_CTX_SETUP)
@@ -199,6 +258,18 @@ static TestResult *construct_test_result(RcvMsg * rmsg, int waserror)
         tr->ctx = CK_CTX_TEST;
         tr->msg = NULL;
         tr->duration = rmsg->duration;
+        tr->phases[CK_PHASE_SETUP] = rmsg->setup;
+        tr->phases[CK_PHASE_TEST] = rmsg->duration;
+        tr->phases[CK_PHASE_TEARDOWN] = rmsg->teardown;
+        /* the time the test process was done, until the runner makes
+           it the time it took to reap it */
+        tr->phases[CK_PHASE_REAP] = rmsg->end;
+        tr->allocs = rmsg->allocs;
+        if(rmsg->bench_nsamples > 0)
+            tr->bench = bench_result_create(rmsg->bench_iterations,
+                                            rmsg->bench_samples,
+                                            rmsg->bench_cpu_samples,
+                                            rmsg->bench_nsamples);
         tr_set_loc_by_ctx(tr, CK_CTX_TEST, rmsg);
     }
 
@@ -215,6 +286,52 @@ void teardown_messaging(void)
     teardown_pipe();
 }
 
+#if defined(HAVE_PTHREAD)
+static void thread_pipe_key_create(void)
+{
+    if(pthread_key_create(&thread_pipe_key, NULL) != 0)
+        eprintf("Error in call to pthread_key_create:", __FILE__, __LINE__);
+}
+
+static ThreadPipe *thread_pipe(void)
+{
+    pthread_once(&thread_pipe_once, thread_pipe_key_create);
+    return (ThreadPipe *)pthread_getspecific(thread_pipe_key);
+}
+
+void setup_thread_messaging(jmp_buf * jmp)
+{
+    ThreadPipe *tp = (ThreadPipe *)emalloc(sizeof(ThreadPipe));
+
+    tp->file = open_tmp_file(&tp->name);
+    tp->jmp = jmp;
+    pthread_once(&thread_pipe_once, thread_pipe_key_create);
+    pthread_setspecific(thread_pipe_key, tp);
+}
+
+void teardown_thread_messaging(void)
+{
+    ThreadPipe *tp = thread_pipe();
+
+    if(tp == NULL)
+        eprintf("No messaging setup", __FILE__, __LINE__);
+    close_tmp_file(tp->file, tp->name);
+    free(tp);
+    pthread_setspecific(thread_pipe_key, NULL);
+}
+#endif /* HAVE_PTHREAD */
+
+jmp_buf *thread_error_jmp_buffer(void)
+{
+#if defined(HAVE_PTHREAD)
+    ThreadPipe *tp = thread_pipe();
+
+    if(tp != NULL)
+        return tp->jmp;
+#endif /* HAVE_PTHREAD */
+    return NULL;
+}
+
 /**
  * Open a temporary file.
  *
@@ -264,6 +381,16 @@ FILE *open_tmp_file(char **name)
     return file;
 }
 
+static void close_tmp_file(FILE * file, char *name)
+{
+    fclose(file);
+    if(name != NULL)
+    {
+        unlink(name);
+        free(name);
+    }
+}
+
 static void setup_pipe(void)
 {
     if(send_file1 == NULL)
@@ -308,3 +435,20 @@ static void teardown_pipe(void)
         eprintf("No messaging setup", __FILE__, __LINE__);
     }
 }
+
+/* empty the pipe of the calling thread after its messages were read */
+static void reset_pipe(void)
+{
+#if defined(HAVE_PTHREAD)
+    ThreadPipe *tp = thread_pipe();
+
+    if(tp != NULL)
+    {
+        close_tmp_file(tp->file, tp->name);
+        tp->file = open_tmp_file(&tp->name);
+        return;
+    }
+#endif /* HAVE_PTHREAD */
+    teardown_pipe();
+    setup_pipe();
+}
@@ -21,19 +21,38 @@
 #ifndef CHECK_MSG_NEW_H
 #define CHECK_MSG_NEW_H
 
+#include <setjmp.h>
+
 
 /* Functions implementing messaging during test runs */
 
 void send_failure_info(const char *msg);
 void send_loc_info(const char *file, int line);
 void send_ctx_info(enum ck_result_ctx ctx);
-void send_duration_info(int duration);
-
-TestResult *receive_test_result(int waserror);
+/* the wall times of the test function and of the checked fixtures
+   around it, and the time it was all done, in nanoseconds */
+void send_duration_info(int64_t duration, int64_t setup, int64_t teardown,
+                        int64_t end);
+/* the heap allocations of a test, when they are tracked */
+void send_alloc_info(const TestAllocs * allocs);
+/* the samples of a benchmark, in picoseconds per call of its body */
+void send_bench_info(int64_t iterations, int nsamples,
+                     const int64_t * samples, const int64_t * cpu_samples);
+
+/* The messages are read into a, which is reset before returning */
+TestResult *receive_test_result(struct Arena *a, int waserror);
 
 void setup_messaging(void);
 void teardown_messaging(void);
 
+/* Give the calling thread a pipe of its own, for running fixtures while
+   the tests run, and make failures in it jump to jmp whatever the fork
+   status. Only with pthreads. */
+void setup_thread_messaging(jmp_buf * jmp);
+void teardown_thread_messaging(void);
+/* the jmp_buf of the calling thread, or NULL to use error_jmp_buffer */
+jmp_buf *thread_error_jmp_buffer(void);
+
 FILE *open_tmp_file(char **name);
 
 #endif /*CHECK_MSG_NEW_H */
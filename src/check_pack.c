@@ -27,8 +27,10 @@
 #include "check.h"
 #include "check_error.h"
 #include "check_list.h"
+#include "check_arena.h"
 #include "check_impl.h"
 #include "check_pack.h"
+#include "check_alloc.h"
 
 #ifndef HAVE_PTHREAD
 #define pthread_mutex_lock(arg)
@@ -55,6 +57,8 @@ typedef uint32_t ck_uint32;
 
 static void pack_int(char **buf, int val);
 static int upack_int(char **buf);
+static void pack_int64(char **buf, int64_t val);
+static int64_t upack_int64(char **buf);
 static void pack_str(char **buf, const char *str);
 static char *upack_str(char **buf);
 
@@ -62,21 +66,25 @@ static int pack_ctx(char **buf, CtxMsg * cmsg);
 static int pack_loc(char **buf, LocMsg * lmsg);
 static int pack_fail(char **buf, FailMsg * fmsg);
 static int pack_duration(char **buf, DurationMsg * fmsg);
+static int pack_bench(char **buf, BenchMsg * bmsg);
+static int pack_alloc(char **buf, AllocMsg * amsg);
 static void upack_ctx(char **buf, CtxMsg * cmsg);
 static void upack_loc(char **buf, LocMsg * lmsg);
 static void upack_fail(char **buf, FailMsg * fmsg);
 static void upack_duration(char **buf, DurationMsg * fmsg);
+static void upack_bench(char **buf, BenchMsg * bmsg);
+static void upack_alloc(char **buf, AllocMsg * amsg);
 
 static void check_type(int type, const char *file, int line);
 static enum ck_msg_type upack_type(char **buf);
 static void pack_type(char **buf, enum ck_msg_type type);
 
 static int read_buf(FILE * fdes, int size, char *buf);
-static int get_result(char *buf, RcvMsg * rmsg);
+static int get_result(char *buf, RcvMsg * rmsg, Arena * a);
 static void rcvmsg_update_ctx(RcvMsg * rmsg, enum ck_result_ctx ctx);
-static void rcvmsg_update_loc(RcvMsg * rmsg, const char *file, int line);
-static RcvMsg *rcvmsg_create(void);
-void rcvmsg_free(RcvMsg * rmsg);
+static void rcvmsg_update_loc(RcvMsg * rmsg, const char *file, int line,
+                              Arena * a);
+static RcvMsg *rcvmsg_create(Arena * a);
 
 typedef int (*pfun) (char **, CheckMsg *);
 typedef void (*upfun) (char **, CheckMsg *);
@@ -85,14 +93,18 @@ static pfun pftab[] = {
     (pfun) pack_ctx,
     (pfun) pack_fail,
     (pfun) pack_loc,
-    (pfun) pack_duration
+    (pfun) pack_duration,
+    (pfun) pack_bench,
+    (pfun) pack_alloc
 };
 
 static upfun upftab[] = {
     (upfun) upack_ctx,
     (upfun) upack_fail,
     (upfun) upack_loc,
-    (upfun) upack_duration
+    (upfun) upack_duration,
+    (upfun) upack_bench,
+    (upfun) upack_alloc
 };
 
 int pack(enum ck_msg_type type, char **buf, CheckMsg * msg)
@@ -152,6 +164,23 @@ static int upack_int(char **buf)
     return (int)uval;
 }
 
+/* 64 bit values are packed as two ints, the high one first */
+static void pack_int64(char **buf, int64_t val)
+{
+    uint64_t uval = (uint64_t)val;
+
+    pack_int(buf, (int)(ck_uint32) (uval >> 32));
+    pack_int(buf, (int)(ck_uint32) (uval & 0xFFFFFFFF));
+}
+
+static int64_t upack_int64(char **buf)
+{
+    uint64_t uval = (uint64_t)(ck_uint32) upack_int(buf) << 32;
+
+    uval |= (ck_uint32) upack_int(buf);
+    return (int64_t)uval;
+}
+
 static void pack_str(char **buf, const char *val)
 {
     int strsz;
@@ -228,18 +257,82 @@ static int pack_duration(char **buf, DurationMsg * cmsg)
     char *ptr;
     int len;
 
-    len = 4 + 4;
+    len = 4 + 4 * 8;
     *buf = ptr = (char *)emalloc(len);
 
     pack_type(&ptr, CK_MSG_DURATION);
-    pack_int(&ptr, cmsg->duration);
+    pack_int64(&ptr, cmsg->duration);
+    pack_int64(&ptr, cmsg->setup);
+    pack_int64(&ptr, cmsg->teardown);
+    pack_int64(&ptr, cmsg->end);
 
     return len;
 }
 
 static void upack_duration(char **buf, DurationMsg * cmsg)
 {
-    cmsg->duration = upack_int(buf);
+    cmsg->duration = upack_int64(buf);
+    cmsg->setup = upack_int64(buf);
+    cmsg->teardown = upack_int64(buf);
+    cmsg->end = upack_int64(buf);
+}
+
+static int pack_bench(char **buf, BenchMsg * bmsg)
+{
+    char *ptr;
+    int len;
+    int i;
+
+    len = 4 + 8 + 4 + 4 + 8 * bmsg->nsamples;
+    *buf = ptr = (char *)emalloc(len);
+
+    pack_type(&ptr, CK_MSG_BENCH);
+    pack_int64(&ptr, bmsg->iterations);
+    pack_int(&ptr, bmsg->nsamples);
+    pack_int(&ptr, bmsg->cpu);
+    for(i = 0; i < bmsg->nsamples; i++)
+        pack_int64(&ptr, bmsg->samples[i]);
+
+    return len;
+}
+
+static void upack_bench(char **buf, BenchMsg * bmsg)
+{
+    int i;
+
+    bmsg->iterations = upack_int64(buf);
+    bmsg->nsamples = upack_int(buf);
+    bmsg->cpu = upack_int(buf);
+    bmsg->samples = (int64_t *)emalloc(bmsg->nsamples * sizeof(int64_t));
+    for(i = 0; i < bmsg->nsamples; i++)
+        bmsg->samples[i] = upack_int64(buf);
+}
+
+static int pack_alloc(char **buf, AllocMsg * amsg)
+{
+    int64_t values[ALLOC_NSTATS];
+    char *ptr;
+    int len;
+    int i;
+
+    len = 4 + 8 * ALLOC_NSTATS;
+    *buf = ptr = (char *)emalloc(len);
+
+    pack_type(&ptr, CK_MSG_ALLOC);
+    alloc_stat_values(&amsg->allocs, values);
+    for(i = 0; i < ALLOC_NSTATS; i++)
+        pack_int64(&ptr, values[i]);
+
+    return len;
+}
+
+static void upack_alloc(char **buf, AllocMsg * amsg)
+{
+    amsg->allocs.allocs = upack_int64(buf);
+    amsg->allocs.bytes = upack_int64(buf);
+    amsg->allocs.peak_bytes = upack_int64(buf);
+    amsg->allocs.leaks = upack_int64(buf);
+    amsg->allocs.leaked_bytes = upack_int64(buf);
 }
 
 static int pack_loc(char **buf, LocMsg * lmsg)
@@ -290,10 +383,33 @@ static void check_type(int type, const char *file, int line)
 
 #ifdef HAVE_PTHREAD
 static pthread_mutex_t ck_mutex_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t ck_atfork_once = PTHREAD_ONCE_INIT;
 static void ppack_cleanup(void *mutex)
 {
     pthread_mutex_unlock((pthread_mutex_t *)mutex);
 }
+
+static void ppack_lock(void)
+{
+    pthread_mutex_lock(&ck_mutex_lock);
+}
+
+static void ppack_unlock(void)
+{
+    pthread_mutex_unlock(&ck_mutex_lock);
+}
+
+static void ppack_register_atfork(void)
+{
+    pthread_atfork(ppack_lock, ppack_unlock, ppack_unlock);
+}
+
+void ppack_fork_safe(void)
+{
+    /* a child forked while another thread sends a message would
+       otherwise start with the lock held */
+    pthread_once(&ck_atfork_once, ppack_register_atfork);
+}
 #endif
 
 void ppack(FILE * fdes, enum ck_msg_type type, CheckMsg * msg)
@@ -302,6 +418,8 @@ void ppack(FILE * fdes, enum ck_msg_type type, CheckMsg * msg)
     int n;
     ssize_t r;
 
+    /* what Check allocates to send the message is not the test's */
+    alloc_track_pause();
     n = pack(type, &buf, msg);
     /* Keep it on the safe side to not send too much data. */
     if(n > (CK_MAX_MSG_SIZE / 2))
@@ -317,6 +435,7 @@ void ppack(FILE * fdes, enum ck_msg_type type, CheckMsg * msg)
         eprintf("Error in call to fwrite:", __FILE__, __LINE__ - 2);
 
     free(buf);
+    alloc_track_resume();
 }
 
 static int read_buf(FILE * fdes, int size, char *buf)
@@ -333,7 +452,7 @@ static int read_buf(FILE * fdes, int size, char *buf)
     return n;
 }
 
-static int get_result(char *buf, RcvMsg * rmsg)
+static int get_result(char *buf, RcvMsg * rmsg, Arena * a)
 {
     enum ck_msg_type type;
     CheckMsg msg;
@@ -355,7 +474,7 @@ static int get_result(char *buf, RcvMsg * rmsg)
 
         if(rmsg->failctx == CK_CTX_INVALID)
         {
-            rcvmsg_update_loc(rmsg, lmsg->file, lmsg->line);
+            rcvmsg_update_loc(rmsg, lmsg->file, lmsg->line, a);
         }
         free(lmsg->file);
     }
@@ -365,7 +484,7 @@ static int get_result(char *buf, RcvMsg * rmsg)
 
         if(rmsg->msg == NULL)
         {
-            rmsg->msg = strdup(fmsg->msg);
+            rmsg->msg = arena_strdup(a, fmsg->msg);
             rmsg->failctx = rmsg->lastctx;
         }
         else
@@ -379,6 +498,34 @@ static int get_result(char *buf, RcvMsg * rmsg)
         DurationMsg *cmsg = (DurationMsg *) & msg;
 
         rmsg->duration = cmsg->duration;
+        rmsg->setup = cmsg->setup;
+        rmsg->teardown = cmsg->teardown;
+        rmsg->end = cmsg->end;
+    }
+    else if(type == CK_MSG_BENCH)
+    {
+        BenchMsg *bmsg = (BenchMsg *) & msg;
+        int64_t *samples =
+            (int64_t *)arena_alloc(a, bmsg->nsamples * sizeof(int64_t));
+
+        memcpy(samples, bmsg->samples, bmsg->nsamples * sizeof(int64_t));
+        free(bmsg->samples);
+        if(!bmsg->cpu)
+        {
+            rmsg->bench_iterations = bmsg->iterations;
+            rmsg->bench_nsamples = bmsg->nsamples;
+            rmsg->bench_samples = samples;
+        }
+        else if(bmsg->nsamples == rmsg->bench_nsamples)
+        {
+            rmsg->bench_cpu_samples = samples;
+        }
+    }
+    else if(type == CK_MSG_ALLOC)
+    {
+        AllocMsg *amsg = (AllocMsg *) & msg;
+
+        rmsg->allocs = amsg->allocs;
     }
     else
         check_type(type, __FILE__, __LINE__);
@@ -398,64 +545,69 @@ static void reset_rcv_fixture(RcvMsg * rmsg)
     rmsg->fixture_file = NULL;
 }
 
-static RcvMsg *rcvmsg_create(void)
+static RcvMsg *rcvmsg_create(Arena * a)
 {
     RcvMsg *rmsg;
 
-    rmsg = (RcvMsg *)emalloc(sizeof(RcvMsg));
+    rmsg = (RcvMsg *)arena_alloc(a, sizeof(RcvMsg));
     rmsg->lastctx = CK_CTX_INVALID;
     rmsg->failctx = CK_CTX_INVALID;
     rmsg->msg = NULL;
     rmsg->duration = -1;
+    rmsg->setup = -1;
+    rmsg->teardown = -1;
+    rmsg->end = -1;
+    rmsg->bench_iterations = 0;
+    rmsg->bench_nsamples = 0;
+    rmsg->bench_samples = NULL;
+    rmsg->bench_cpu_samples = NULL;
+    alloc_stats_reset(&rmsg->allocs);
     reset_rcv_test(rmsg);
     reset_rcv_fixture(rmsg);
     return rmsg;
 }
 
-void rcvmsg_free(RcvMsg * rmsg)
-{
-    free(rmsg->fixture_file);
-    free(rmsg->test_file);
-    free(rmsg->msg);
-    free(rmsg);
-}
-
 static void rcvmsg_update_ctx(RcvMsg * rmsg, enum ck_result_ctx ctx)
 {
     if(rmsg->lastctx != CK_CTX_INVALID)
     {
-        free(rmsg->fixture_file);
         reset_rcv_fixture(rmsg);
     }
     rmsg->lastctx = ctx;
 }
 
-static void rcvmsg_update_loc(RcvMsg * rmsg, const char *file, int line)
+/*
+ * Tests usually report the same file over and over, so the copy in the
+ * arena is only replaced when the file changes.
+ */
+static void rcvmsg_update_loc(RcvMsg * rmsg, const char *file, int line,
+                              Arena * a)
 {
     if(rmsg->lastctx == CK_CTX_TEST)
     {
-        free(rmsg->test_file);
         rmsg->test_line = line;
-        rmsg->test_file = strdup(file);
+        if(rmsg->test_file == NULL || strcmp(rmsg->test_file, file) != 0)
+            rmsg->test_file = arena_strdup(a, file);
     }
     else
     {
-        free(rmsg->fixture_file);
         rmsg->fixture_line = line;
-        rmsg->fixture_file = strdup(file);
+        if(rmsg->fixture_file == NULL ||
+           strcmp(rmsg->fixture_file, file) != 0)
+            rmsg->fixture_file = arena_strdup(a, file);
     }
 }
 
-RcvMsg *punpack(FILE * fdes)
+RcvMsg *punpack(FILE * fdes, Arena * a)
 {
     int nread, nparse, n;
     char *buf;
     RcvMsg *rmsg;
 
-    rmsg = rcvmsg_create();
+    rmsg = rcvmsg_create(a);
 
     /* Allcate a buffer */
-    buf = (char *)emalloc(CK_MAX_MSG_SIZE);
+    buf = (char *)arena_alloc(a, CK_MAX_MSG_SIZE);
     /* Fill the buffer from the file */
     nread = read_buf(fdes, CK_MAX_MSG_SIZE, buf);
     nparse = nread;
@@ -463,7 +615,7 @@ RcvMsg *punpack(FILE * fdes)
     while(nparse > 0)
     {
         /* Parse one message */
-        n = get_result(buf, rmsg);
+        n = get_result(buf, rmsg, a);
         nparse -= n;
         /* Move remaining data in buffer to the beginning */
         memmove(buf, buf + n, nparse);
@@ -475,11 +627,8 @@ RcvMsg *punpack(FILE * fdes)
             nparse += nread;
         }
     }
-    free(buf);
-
     if(rmsg->lastctx == CK_CTX_INVALID)
     {
-        free(rmsg);
         rmsg = NULL;
     }
 
@@ -28,6 +28,8 @@ enum ck_msg_type
     CK_MSG_FAIL,
     CK_MSG_LOC,
     CK_MSG_DURATION,
+    CK_MSG_BENCH,
+    CK_MSG_ALLOC,
     CK_MSG_LAST
 };
 
@@ -49,15 +51,35 @@ typedef struct FailMsg
 
 typedef struct DurationMsg
 {
-    int duration;
+    int64_t duration;           /* nanoseconds */
+    int64_t setup;              /* of the checked setup, in nanoseconds */
+    int64_t teardown;           /* of the checked teardown */
+    int64_t end;                /* check_get_clockid() time the test
+                                   process was done, in nanoseconds */
 } DurationMsg;
 
+typedef struct BenchMsg
+{
+    int64_t iterations;         /* calls of the body in each sample */
+    int nsamples;
+    int cpu;                    /* whether the samples are in CPU time,
+                                   sent after those in wall time */
+    int64_t *samples;           /* picoseconds per call */
+} BenchMsg;
+
+typedef struct AllocMsg
+{
+    TestAllocs allocs;
+} AllocMsg;
+
 typedef union
 {
     CtxMsg ctx_msg;
     FailMsg fail_msg;
     LocMsg loc_msg;
     DurationMsg duration_msg;
+    BenchMsg bench_msg;
+    AllocMsg alloc_msg;
 } CheckMsg;
 
 typedef struct RcvMsg
@@ -69,16 +91,27 @@ typedef struct RcvMsg
     char *test_file;
     int test_line;
     char *msg;
-    int duration;
+    int64_t duration;
+    int64_t setup;
+    int64_t teardown;
+    int64_t end;
+    int64_t bench_iterations;
+    int bench_nsamples;         /* 0 unless a benchmark ran */
+    int64_t *bench_samples;
+    int64_t *bench_cpu_samples; /* NULL if not known */
+    TestAllocs allocs;          /* all -1 unless they were tracked */
 } RcvMsg;
 
-void rcvmsg_free(RcvMsg * rmsg);
-
 
 int pack(enum ck_msg_type type, char **buf, CheckMsg * msg);
 int upack(char *buf, CheckMsg * msg, enum ck_msg_type *type);
 
 void ppack(FILE * fdes, enum ck_msg_type type, CheckMsg * msg);
-RcvMsg *punpack(FILE * fdes);
+/* Make fork() wait for a message being sent by another thread; call
+   before starting a thread that sends messages. Only with pthreads */
+void ppack_fork_safe(void);
+/* Read the messages in fdes. The result and its strings are allocated
+   in a, and NULL is returned if there were none */
+RcvMsg *punpack(FILE * fdes, struct Arena *a);
 
 #endif /*CHECK_PACK_H */
@@ -0,0 +1,248 @@
+/*
+ * Check: a unit test framework for C
+ * Copyright (C) 2001, 2002 Arien Malec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "../lib/libcompat.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(HAVE_LINUX_PERF_EVENT_H)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "check.h"
+#include "check_error.h"
+#include "check_list.h"
+#include "check_impl.h"
+#include "check_perf.h"
+
+typedef struct PerfEvent
+{
+    const char *name;
+    unsigned int type;          /* a perf_type_id */
+    unsigned long config;
+    const char *fallback;       /* software event to count instead */
+} PerfEvent;
+
+#if defined(HAVE_LINUX_PERF_EVENT_H)
+#define PERF_EVENT(name, type, config, fallback) \
+  { name, PERF_TYPE_ ## type, PERF_COUNT_ ## config, fallback }
+#else
+/* the names are still known, so a misspelt one is found everywhere */
+#define PERF_EVENT(name, type, config, fallback) { name, 0, 0, fallback }
+#endif /* HAVE_LINUX_PERF_EVENT_H */
+
+static const PerfEvent perf_events[] = {
+    PERF_EVENT("cycles", HARDWARE, HW_CPU_CYCLES, "task-clock"),
+    PERF_EVENT("instructions", HARDWARE, HW_INSTRUCTIONS, "task-clock"),
+    PERF_EVENT("cache-references", HARDWARE, HW_CACHE_REFERENCES,
+               "page-faults"),
+    PERF_EVENT("cache-misses", HARDWARE, HW_CACHE_MISSES, "page-faults"),
+    PERF_EVENT("branches", HARDWARE, HW_BRANCH_INSTRUCTIONS, "task-clock"),
+    PERF_EVENT("branch-misses", HARDWARE, HW_BRANCH_MISSES, "task-clock"),
+    PERF_EVENT("task-clock", SOFTWARE, SW_TASK_CLOCK, NULL),
+    PERF_EVENT("page-faults", SOFTWARE, SW_PAGE_FAULTS, NULL),
+    PERF_EVENT("context-switches", SOFTWARE, SW_CONTEXT_SWITCHES, NULL),
+    PERF_EVENT("cpu-migrations", SOFTWARE, SW_CPU_MIGRATIONS, NULL),
+    PERF_EVENT("minor-faults", SOFTWARE, SW_PAGE_FAULTS_MIN, NULL),
+    PERF_EVENT("major-faults", SOFTWARE, SW_PAGE_FAULTS_MAJ, NULL)
+};
+
+#define PERF_NEVENTS (sizeof(perf_events) / sizeof(perf_events[0]))
+
+/* What a counter reads: its count, and how long it was enabled and
+   actually counting, which differ when counters are multiplexed */
+typedef struct PerfReading
+{
+    uint64_t value;
+    uint64_t enabled;
+    uint64_t running;
+} PerfReading;
+
+struct PerfCounters
+{
+    int n;
+    int fds[PERF_MAX_COUNTERS];
+    const PerfEvent *events[PERF_MAX_COUNTERS];
+    PerfReading start[PERF_MAX_COUNTERS];
+};
+
+static const PerfEvent *perf_find_event(const char *name, size_t len)
+{
+    unsigned int i;
+
+    for(i = 0; i < PERF_NEVENTS; i++)
+    {
+        if(strlen(perf_events[i].name) == len &&
+           strncmp(perf_events[i].name, name, len) == 0)
+            return &perf_events[i];
+    }
+    return NULL;
+}
+
+#if defined(HAVE_LINUX_PERF_EVENT_H)
+/* Open a disabled counter of ev for this process and the processes it
+   forks, or return -1 */
+static int perf_open_event(const PerfEvent * ev)
+{
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = ev->type;
+    attr.config = ev->config;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    /* the default perf_event_paranoid only allows user space events */
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static int perf_read(int fd, PerfReading * r)
+{
+    return read(fd, r, sizeof(*r)) == (ssize_t) sizeof(*r);
+}
+#endif /* HAVE_LINUX_PERF_EVENT_H */
+
+/* Add a counter of ev, or of its fallback, unless one is counted
+   already */
+static void perf_add_event(PerfCounters * pc, const PerfEvent * ev)
+{
+    int i;
+
+    while(ev != NULL)
+    {
+        for(i = 0; i < pc->n; i++)
+        {
+            if(pc->events[i] == ev)
+                return;
+        }
+#if defined(HAVE_LINUX_PERF_EVENT_H)
+        pc->fds[pc->n] = perf_open_event(ev);
+        if(pc->fds[pc->n] >= 0)
+        {
+            pc->events[pc->n++] = ev;
+            return;
+        }
+#endif /* HAVE_LINUX_PERF_EVENT_H */
+        ev = ev->fallback == NULL ? NULL :
+            perf_find_event(ev->fallback, strlen(ev->fallback));
+    }
+}
+
+PerfCounters *perf_counters_open(const char *spec)
+{
+    PerfCounters *pc = (PerfCounters *)emalloc(sizeof(PerfCounters));
+    const char *name = spec;
+
+    pc->n = 0;
+    while(*name != '\0')
+    {
+        size_t len = strcspn(name, ",");
+
+        if(len > 0)
+        {
+            const PerfEvent *ev = perf_find_event(name, len);
+
+            if(ev == NULL)
+                eprintf("Unknown performance counter: %.*s", __FILE__,
+                        __LINE__, (int)len, name);
+            if(pc->n < PERF_MAX_COUNTERS)
+                perf_add_event(pc, ev);
+        }
+        name += len;
+        if(*name == ',')
+            name++;
+    }
+
+    if(pc->n == 0)
+    {
+        free(pc);
+        return NULL;
+    }
+    return pc;
+}
+
+void perf_counters_start(PerfCounters * pc)
+{
+#if defined(HAVE_LINUX_PERF_EVENT_H)
+    int i;
+
+    for(i = 0; i < pc->n; i++)
+    {
+        if(!perf_read(pc->fds[i], &pc->start[i]))
+            pc->start[i].running = (uint64_t)-1;
+        ioctl(pc->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#else
+    (void)pc;
+#endif /* HAVE_LINUX_PERF_EVENT_H */
+}
+
+PerfSample *perf_counters_stop(PerfCounters * pc)
+{
+    PerfSample *ps = (PerfSample *)emalloc(sizeof(PerfSample));
+    int i;
+
+    ps->n = pc->n;
+    for(i = 0; i < pc->n; i++)
+    {
+        ps->names[i] = pc->events[i]->name;
+        ps->values[i] = -1;
+#if defined(HAVE_LINUX_PERF_EVENT_H)
+        {
+            PerfReading end;
+            uint64_t value, enabled, running;
+
+            ioctl(pc->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+            if(!perf_read(pc->fds[i], &end) ||
+               pc->start[i].running == (uint64_t)-1)
+                continue;
+            value = end.value - pc->start[i].value;
+            enabled = end.enabled - pc->start[i].enabled;
+            running = end.running - pc->start[i].running;
+            if(running == 0)
+                continue;
+            /* scale up the count of a multiplexed counter */
+            if(running < enabled)
+                value = (uint64_t)((double)value * enabled / running);
+            ps->values[i] = (int64_t)value;
+        }
+#endif /* HAVE_LINUX_PERF_EVENT_H */
+    }
+    return ps;
+}
+
+void perf_counters_close(PerfCounters * pc)
+{
+#if defined(HAVE_LINUX_PERF_EVENT_H)
+    int i;
+
+    for(i = 0; i < pc->n; i++)
+        close(pc->fds[i]);
+#endif /* HAVE_LINUX_PERF_EVENT_H */
+    free(pc);
+}
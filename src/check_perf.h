@@ -0,0 +1,56 @@
+/*
+ * Check: a unit test framework for C
+ * Copyright (C) 2001, 2002 Arien Malec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef CHECK_PERF_H
+#define CHECK_PERF_H
+
+/*
+ * Performance counters, counted around each test with perf_event_open()
+ * on Linux. Hardware events that cannot be opened, as in most virtual
+ * machines and containers, are replaced by a software event.
+ */
+
+#define PERF_MAX_COUNTERS 8
+
+/* The counts of one test, in the order the counters were named */
+typedef struct PerfSample
+{
+    int n;
+    const char *names[PERF_MAX_COUNTERS];       /* static strings */
+    int64_t values[PERF_MAX_COUNTERS];  /* -1 if the counter never ran */
+} PerfSample;
+
+typedef struct PerfCounters PerfCounters;
+
+/* Open the counters in spec, a comma separated list of event names.
+   Return NULL if none of them could be opened, as on systems without
+   perf_event_open() */
+PerfCounters *perf_counters_open(const char *spec);
+
+/* Start counting; the counts of processes forked from now on are
+   added in when they exit */
+void perf_counters_start(PerfCounters * pc);
+
+/* Stop counting, and return what was counted since the last start */
+PerfSample *perf_counters_stop(PerfCounters * pc);
+
+void perf_counters_close(PerfCounters * pc);
+
+#endif /* CHECK_PERF_H */
@@ -24,14 +24,27 @@
 #include <string.h>
 #include <stdlib.h>
 
+/*
+ * The vectorized XML escaper reads whole aligned blocks, which may go
+ * past the end of the string. AddressSanitizer would rightly object.
+ */
+#if defined(__SSE2__) && defined(__GNUC__) && !defined(__SANITIZE_ADDRESS__)
+#define CK_XML_ESC_SSE2 1
+#include <emmintrin.h>
+#endif
+
 #include "check.h"
 #include "check_list.h"
 #include "check_impl.h"
+#include "check_alloc.h"
+#include "check_perf.h"
+#include "check_stats.h"
 #include "check_str.h"
 #include "check_print.h"
 
 static void srunner_fprint_summary(FILE * file, SRunner * sr,
                                    enum print_output print_mode);
+static void srunner_fprint_phases(FILE * file, SRunner * sr);
 static void srunner_fprint_results(FILE * file, SRunner * sr,
                                    enum print_output print_mode);
 
@@ -67,10 +80,42 @@ static void srunner_fprint_summary(FILE * file, SRunner * sr,
         str = sr_stat_str(sr);
         fprintf(file, "%s\n", str);
         free(str);
+        /* not for a runner that has not run, as when replaying logs */
+        if(srunner_phase_summary(sr) && sr->run_ns > 0)
+            srunner_fprint_phases(file, sr);
     }
     return;
 }
 
+/* The time of each phase and of the rest, and their shares of the run */
+static void srunner_fprint_phases(FILE * file, SRunner * sr)
+{
+    char buf[32];
+    int64_t other = sr->run_ns;
+    int i;
+
+    fprintf(file, "Phases:\n");
+    for(i = 0; i <= NPHASES; i++)
+    {
+        int64_t ns;
+
+        if(i < NPHASES)
+        {
+            ns = sr->phases[i];
+            other -= ns;
+        }
+        else
+        {
+            /* the phases are timed apart, so this may come out below 0 */
+            ns = other > 0 ? other : 0;
+        }
+        stats_fmt_time(buf, sizeof(buf), (double)ns);
+        fprintf(file, "  %-9s %12s %5.1f%%\n",
+                i < NPHASES ? phase_names[i] : "other", buf,
+                100.0 * (double)ns / (double)sr->run_ns);
+    }
+}
+
 static void srunner_fprint_results(FILE * file, SRunner * sr,
                                    enum print_output print_mode)
 {
@@ -93,13 +138,89 @@ static void srunner_fprint_results(FILE * file, SRunner * sr,
     return;
 }
 
+/*
+ * Characters that can not be written to XML as they are: markup,
+ * and the control characters below 0x20. The string terminator is
+ * one of the latter, so scanning for these also finds the end.
+ */
+#if defined(CK_XML_ESC_SSE2)
+static unsigned int xml_special_mask(__m128i v)
+{
+    __m128i m;
+
+    /* bytes <= 0x1f saturate to zero when 0x1f is subtracted */
+    m = _mm_cmpeq_epi8(_mm_subs_epu8(v, _mm_set1_epi8(0x1f)),
+                       _mm_setzero_si128());
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\'')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('<')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('>')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('&')));
+    return (unsigned int)_mm_movemask_epi8(m);
+}
+#else
+static int xml_is_special(unsigned char c)
+{
+    return c < 0x20 || c == '"' || c == '\'' || c == '<' || c == '>' ||
+        c == '&';
+}
+#endif /* CK_XML_ESC_SSE2 */
+
+/*
+ * Return the number of characters at the start of str that need no
+ * escaping.
+ */
+static size_t xml_plain_len(const char *str)
+{
+#if defined(CK_XML_ESC_SSE2)
+    /*
+     * Aligned 16 byte loads never cross a page boundary, so reading
+     * past the terminator is harmless. Bytes in front of str in the
+     * first block are shifted out of the mask.
+     */
+    size_t offset = (size_t)((uintptr_t)str & 15);
+    const __m128i *block = (const __m128i *)(const void *)(str - offset);
+    unsigned int mask;
+
+    mask = xml_special_mask(_mm_load_si128(block)) >> offset;
+    if(mask != 0)
+        return (size_t)__builtin_ctz(mask);
+    for(block++;; block++)
+    {
+        mask = xml_special_mask(_mm_load_si128(block));
+        if(mask != 0)
+        {
+            return (size_t)((const char *)block - str) +
+                (size_t)__builtin_ctz(mask);
+        }
+    }
+#else
+    const char *p;
+
+    for(p = str; !xml_is_special((unsigned char)*p); p++)
+        ;
+    return (size_t)(p - str);
+#endif /* CK_XML_ESC_SSE2 */
+}
+
 void fprint_xml_esc(FILE * file, const char *str)
 {
-    for(; *str != '\0'; str++)
+    size_t len;
+
+    for(;; str++)
     {
+        /* write out everything up to the next special character at once */
+        len = xml_plain_len(str);
+        if(len > 0)
+        {
+            fwrite(str, 1, len, file);
+            str += len;
+        }
 
         switch (*str)
         {
+            case '\0':
+                return;
 
                 /* handle special characters that must be escaped */
             case '"':
@@ -118,14 +239,59 @@ void fprint_xml_esc(FILE * file, const char *str)
                 fputs("&amp;", file);
                 break;
 
-                /* regular characters, print as is */
-            default:
+                /* whitespace is allowed, print as is */
+            case '\t':
+            case '\n':
+            case '\r':
                 fputc(*str, file);
                 break;
+
+                /*
+                 * XML 1.0 does not allow other control characters, not
+                 * even as character references. Print their C escape.
+                 */
+            default:
+                fprintf(file, "\\x%02x", (unsigned int)(unsigned char)*str);
+                break;
         }
     }
 }
 
+void fprint_seconds(FILE * file, int64_t ns, int digits)
+{
+    int64_t unit = 1;
+    int i;
+
+    if(ns < 0)
+    {
+        fprintf(file, "-1.%0*d", digits, 0);
+        return;
+    }
+    for(i = digits; i < 9; i++)
+        unit *= 10;
+    fprintf(file, "%jd.%0*jd", (intmax_t)(ns / NANOS_PER_SECONDS), digits,
+            (intmax_t)(ns % NANOS_PER_SECONDS / unit));
+}
+
+const char *const rusage_names[RUSAGE_NFIELDS] = {
+    "maxrss_kb", "minflt", "majflt", "nvcsw", "nivcsw", "inblock", "oublock"
+};
+
+const char *const phase_names[NPHASES] = {
+    "setup", "test", "teardown", "fork", "reap", "report"
+};
+
+void rusage_values(const TestRusage * ru, long *values)
+{
+    values[0] = ru->maxrss;
+    values[1] = ru->minflt;
+    values[2] = ru->majflt;
+    values[3] = ru->nvcsw;
+    values[4] = ru->nivcsw;
+    values[5] = ru->inblock;
+    values[6] = ru->oublock;
+}
+
 void tr_fprint(FILE * file, TestResult * tr, enum print_output print_mode)
 {
     if(print_mode == CK_ENV)
@@ -133,8 +299,10 @@ void tr_fprint(FILE * file, TestResult * tr, enum print_output print_mode)
         print_mode = get_env_printmode();
     }
 
+    /* benchmarks pass with their statistics as the message */
     if((print_mode >= CK_VERBOSE && tr->rtype == CK_PASS) ||
-       (tr->rtype != CK_PASS && print_mode >= CK_NORMAL))
+       ((tr->rtype != CK_PASS || tr->bench != NULL) &&
+        print_mode >= CK_NORMAL))
     {
         char *trstr = tr_str(tr);
 
@@ -148,8 +316,10 @@ void tr_xmlprint(FILE * file, TestResult * tr,
 {
     char result[10];
     char *path_name = NULL;
-    char *file_name = NULL;
-    char *slash = NULL;
+    const char *file_name = NULL;
+    const char *slash = NULL;
+    long rusage[RUSAGE_NFIELDS];
+    int i;
 
     switch (tr->rtype)
     {
@@ -197,9 +367,55 @@ void tr_xmlprint(FILE * file, TestResult * tr,
             (file_name == NULL ? "" : file_name), tr->line);
     fprintf(file, "      <id>%s</id>\n", tr->tname);
     fprintf(file, "      <iteration>%d</iteration>\n", tr->iter);
-    fprintf(file, "      <duration>%d.%06d</duration>\n",
-            tr->duration < 0 ? -1 : tr->duration / US_PER_SEC,
-            tr->duration < 0 ? 0 : tr->duration % US_PER_SEC);
+    fprintf(file, "      <duration>");
+    fprint_seconds(file, tr->duration, 9);
+    fprintf(file, "</duration>\n");
+    fprintf(file, "      <user_time>");
+    fprint_seconds(file, tr->utime, 9);
+    fprintf(file, "</user_time>\n");
+    fprintf(file, "      <system_time>");
+    fprint_seconds(file, tr->stime, 9);
+    fprintf(file, "</system_time>\n");
+    rusage_values(&tr->rusage, rusage);
+    fprintf(file, "      <rusage");
+    for(i = 0; i < RUSAGE_NFIELDS; i++)
+        fprintf(file, " %s=\"%ld\"", rusage_names[i], rusage[i]);
+    fprintf(file, "/>\n");
+    if(tr->perf != NULL)
+    {
+        fprintf(file, "      <perf");
+        for(i = 0; i < tr->perf->n; i++)
+            fprintf(file, " %s=\"%jd\"", tr->perf->names[i],
+                    (intmax_t)tr->perf->values[i]);
+        fprintf(file, "/>\n");
+    }
+    fprintf(file, "      <phases");
+    for(i = 0; i < NPHASES; i++)
+        fprintf(file, " %s_ns=\"%jd\"", phase_names[i],
+                (intmax_t)tr->phases[i]);
+    fprintf(file, "/>\n");
+    if(tr->allocs.allocs >= 0)
+    {
+        int64_t allocs[ALLOC_NSTATS];
+
+        alloc_stat_values(&tr->allocs, allocs);
+        fprintf(file, "      <allocs");
+        for(i = 0; i < ALLOC_NSTATS; i++)
+            fprintf(file, " %s=\"%jd\"", alloc_stat_names[i],
+                    (intmax_t)allocs[i]);
+        fprintf(file, "/>\n");
+    }
+    if(tr->bench != NULL)
+    {
+        double stats[BENCH_NSTATS];
+
+        bench_stat_values(tr->bench, stats);
+        fprintf(file, "      <bench iterations=\"%jd\" samples=\"%d\"",
+                (intmax_t)tr->bench->iterations, tr->bench->nsamples);
+        for(i = 0; i < BENCH_NSTATS; i++)
+            fprintf(file, " %s_ns=\"%.3f\"", bench_stat_names[i], stats[i]);
+        fprintf(file, "/>\n");
+    }
     fprintf(file, "      <description>");
     fprint_xml_esc(file, tr->tcname);
     fprintf(file, "</description>\n");
@@ -211,6 +427,440 @@ void tr_xmlprint(FILE * file, TestResult * tr,
     free(path_name);
 }
 
+void tr_junitprint(FILE * file, TestResult * tr,
+                   enum print_output print_mode CK_ATTRIBUTE_UNUSED)
+{
+    const char *element;
+
+    switch (tr->rtype)
+    {
+        case CK_PASS:
+            element = NULL;
+            break;
+        case CK_FAILURE:
+            element = "failure";
+            break;
+        case CK_ERROR:
+            element = "error";
+            break;
+        case CK_TEST_RESULT_INVALID:
+        default:
+            abort();
+            break;
+    }
+
+    fprintf(file, "    <testcase classname=\"");
+    fprint_xml_esc(file, tr->tcname);
+    fprintf(file, "\" name=\"");
+    fprint_xml_esc(file, tr->tname);
+    fprintf(file, "\" time=\"");
+    fprint_seconds(file, tr->duration < 0 ? 0 : tr->duration, 6);
+    fprintf(file, "\"");
+    if(element == NULL)
+    {
+        fprintf(file, "/>\n");
+        return;
+    }
+
+    fprintf(file, ">\n");
+    fprintf(file, "      <%s message=\"", element);
+    fprint_xml_esc(file, tr->msg);
+    fprintf(file, "\">");
+    fprint_xml_esc(file, tr->file == NULL ? "" : tr->file);
+    fprintf(file, ":%d</%s>\n", tr->line, element);
+    fprintf(file, "    </testcase>\n");
+}
+
+/*
+ * JSON records are put together in a fixed buffer and written out
+ * with a single fwrite(), or a few for records longer than the buffer.
+ */
+#define CK_JSON_BUFSIZ 1024
+
+typedef struct JsonWriter
+{
+    FILE *file;
+    size_t len;
+    char buf[CK_JSON_BUFSIZ];
+} JsonWriter;
+
+static void json_write(JsonWriter * jw, const char *str, size_t len)
+{
+    if(jw->len + len > sizeof(jw->buf))
+    {
+        fwrite(jw->buf, 1, jw->len, jw->file);
+        jw->len = 0;
+        if(len > sizeof(jw->buf))
+        {
+            fwrite(str, 1, len, jw->file);
+            return;
+        }
+    }
+    memcpy(jw->buf + jw->len, str, len);
+    jw->len += len;
+}
+
+static void json_write_lit(JsonWriter * jw, const char *str)
+{
+    json_write(jw, str, strlen(str));
+}
+
+static void json_write_int(JsonWriter * jw, int val)
+{
+    char num[sizeof("-2147483648")];
+    int len = snprintf(num, sizeof(num), "%d", val);
+
+    json_write(jw, num, (size_t)len);
+}
+
+/* Write a time or count, or null if it is unknown (negative) */
+static void json_write_known(JsonWriter * jw, int64_t val)
+{
+    char num[sizeof("-9223372036854775808")];
+    int len;
+
+    if(val < 0)
+    {
+        json_write_lit(jw, "null");
+        return;
+    }
+    len = snprintf(num, sizeof(num), "%jd", (intmax_t)val);
+    json_write(jw, num, (size_t)len);
+}
+
+static void json_write_double(JsonWriter * jw, double val)
+{
+    char num[32];
+    int len = snprintf(num, sizeof(num), "%.3f", val);
+
+    json_write(jw, num, (size_t)len);
+}
+
+/* Write str as a JSON string, or null if it is NULL */
+static void json_write_str(JsonWriter * jw, const char *str)
+{
+    const char *run;
+    char esc[sizeof("\\u001f")];
+
+    if(str == NULL)
+    {
+        json_write_lit(jw, "null");
+        return;
+    }
+
+    json_write(jw, "\"", 1);
+    for(run = str; *str != '\0'; str++)
+    {
+        unsigned char c = (unsigned char)*str;
+
+        if(c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        json_write(jw, run, (size_t)(str - run));
+        run = str + 1;
+        switch (c)
+        {
+            case '"':
+                json_write(jw, "\\\"", 2);
+                break;
+            case '\\':
+                json_write(jw, "\\\\", 2);
+                break;
+            case '\n':
+                json_write(jw, "\\n", 2);
+                break;
+            case '\r':
+                json_write(jw, "\\r", 2);
+                break;
+            case '\t':
+                json_write(jw, "\\t", 2);
+                break;
+            default:
+                snprintf(esc, sizeof(esc), "\\u%04x", (unsigned int)c);
+                json_write(jw, esc, 6);
+                break;
+        }
+    }
+    json_write(jw, run, (size_t)(str - run));
+    json_write(jw, "\"", 1);
+}
+
+void tr_jsonprint(FILE * file, TestResult * tr, const char *sname)
+{
+    JsonWriter jw;
+    const char *result;
+    const char *ctx;
+    int i;
+
+    switch (tr->rtype)
+    {
+        case CK_PASS:
+            result = "success";
+            break;
+        case CK_FAILURE:
+            result = "failure";
+            break;
+        case CK_ERROR:
+            result = "error";
+            break;
+        case CK_TEST_RESULT_INVALID:
+        default:
+            abort();
+            break;
+    }
+
+    switch (tr->ctx)
+    {
+        case CK_CTX_SETUP:
+            ctx = "setup";
+            break;
+        case CK_CTX_TEST:
+            ctx = "test";
+            break;
+        case CK_CTX_TEARDOWN:
+            ctx = "teardown";
+            break;
+        case CK_CTX_INVALID:
+        default:
+            ctx = NULL;
+            break;
+    }
+
+    jw.file = file;
+    jw.len = 0;
+    json_write_lit(&jw, "{\"suite\":");
+    json_write_str(&jw, sname);
+    json_write_lit(&jw, ",\"tcase\":");
+    json_write_str(&jw, tr->tcname);
+    json_write_lit(&jw, ",\"test\":");
+    json_write_str(&jw, tr->tname);
+    json_write_lit(&jw, ",\"iteration\":");
+    json_write_int(&jw, tr->iter);
+    json_write_lit(&jw, ",\"result\":");
+    json_write_str(&jw, result);
+    json_write_lit(&jw, ",\"context\":");
+    json_write_str(&jw, ctx);
+    json_write_lit(&jw, ",\"file\":");
+    json_write_str(&jw, tr->file);
+    json_write_lit(&jw, ",\"line\":");
+    json_write_int(&jw, tr->line);
+    json_write_lit(&jw, ",\"duration_ns\":");
+    json_write_known(&jw, tr->duration);
+    json_write_lit(&jw, ",\"user_ns\":");
+    json_write_known(&jw, tr->utime);
+    json_write_lit(&jw, ",\"system_ns\":");
+    json_write_known(&jw, tr->stime);
+    json_write_lit(&jw, ",\"rusage\":");
+    if(tr->rusage.maxrss < 0)
+        json_write_lit(&jw, "null");
+    else
+    {
+        long rusage[RUSAGE_NFIELDS];
+
+        rusage_values(&tr->rusage, rusage);
+        for(i = 0; i < RUSAGE_NFIELDS; i++)
+        {
+            json_write_lit(&jw, i == 0 ? "{\"" : ",\"");
+            json_write_lit(&jw, rusage_names[i]);
+            json_write_lit(&jw, "\":");
+            json_write_known(&jw, rusage[i]);
+        }
+        json_write_lit(&jw, "}");
+    }
+    for(i = 0; i < NPHASES; i++)
+    {
+        json_write_lit(&jw, i == 0 ? ",\"phases\":{\"" : ",\"");
+        json_write_lit(&jw, phase_names[i]);
+        json_write_lit(&jw, "_ns\":");
+        json_write_known(&jw, tr->phases[i]);
+    }
+    json_write_lit(&jw, "}");
+    if(tr->perf != NULL)
+    {
+        for(i = 0; i < tr->perf->n; i++)
+        {
+            json_write_lit(&jw, i == 0 ? ",\"perf\":{\"" : ",\"");
+            json_write_lit(&jw, tr->perf->names[i]);
+            json_write_lit(&jw, "\":");
+            json_write_known(&jw, tr->perf->values[i]);
+        }
+        json_write_lit(&jw, "}");
+    }
+    if(tr->allocs.allocs >= 0)
+    {
+        int64_t allocs[ALLOC_NSTATS];
+
+        alloc_stat_values(&tr->allocs, allocs);
+        for(i = 0; i < ALLOC_NSTATS; i++)
+        {
+            json_write_lit(&jw, i == 0 ? ",\"allocs\":{\"" : ",\"");
+            json_write_lit(&jw, alloc_stat_names[i]);
+            json_write_lit(&jw, "\":");
+            json_write_known(&jw, allocs[i]);
+        }
+        json_write_lit(&jw, "}");
+    }
+    if(tr->bench != NULL)
+    {
+        double stats[BENCH_NSTATS];
+
+        bench_stat_values(tr->bench, stats);
+        json_write_lit(&jw, ",\"bench\":{\"iterations\":");
+        json_write_known(&jw, tr->bench->iterations);
+        json_write_lit(&jw, ",\"samples\":");
+        json_write_int(&jw, tr->bench->nsamples);
+        for(i = 0; i < BENCH_NSTATS; i++)
+        {
+            json_write_lit(&jw, ",\"");
+            json_write_lit(&jw, bench_stat_names[i]);
+            json_write_lit(&jw, "_ns\":");
+            json_write_double(&jw, stats[i]);
+        }
+        json_write_lit(&jw, "}");
+    }
+    json_write_lit(&jw, ",\"message\":");
+    json_write_str(&jw, tr->msg);
+    json_write_lit(&jw, "}\n");
+    fwrite(jw.buf, 1, jw.len, file);
+}
+
+/* Write one run of a benchmark as Google Benchmark does, leaving out
+   the CPU time if cpu_ns is negative as it is not known, with a rate
+   named counter if it is not NULL */
+static void gbench_write_run(JsonWriter * jw, const char *name,
+                             const char *aggregate, int nreps, int rep,
+                             int64_t iterations, double ns, double cpu_ns,
+                             const char *counter, double rate)
+{
+    json_write_lit(jw, "    {\n      \"name\": ");
+    if(aggregate == NULL)
+        json_write_str(jw, name);
+    else
+    {
+        char *aggname = ck_strdup_printf("%s_%s", name, aggregate);
+
+        json_write_str(jw, aggname);
+        free(aggname);
+    }
+    json_write_lit(jw, ",\n      \"run_name\": ");
+    json_write_str(jw, name);
+    json_write_lit(jw, ",\n      \"run_type\": ");
+    json_write_str(jw, aggregate == NULL ? "iteration" : "aggregate");
+    json_write_lit(jw, ",\n      \"repetitions\": ");
+    json_write_int(jw, nreps);
+    if(aggregate == NULL)
+    {
+        json_write_lit(jw, ",\n      \"repetition_index\": ");
+        json_write_int(jw, rep);
+    }
+    else
+    {
+        json_write_lit(jw, ",\n      \"aggregate_name\": ");
+        json_write_str(jw, aggregate);
+        json_write_lit(jw, ",\n      \"aggregate_unit\": \"time\"");
+    }
+    json_write_lit(jw, ",\n      \"threads\": 1,\n      \"iterations\": ");
+    json_write_known(jw, iterations);
+    json_write_lit(jw, ",\n      \"real_time\": ");
+    json_write_double(jw, ns);
+    if(cpu_ns >= 0)
+    {
+        json_write_lit(jw, ",\n      \"cpu_time\": ");
+        json_write_double(jw, cpu_ns);
+    }
+    json_write_lit(jw, ",\n      \"time_unit\": \"ns\"");
+    if(counter != NULL)
+    {
+        json_write_lit(jw, ",\n      ");
+        json_write_str(jw, counter);
+        json_write_lit(jw, ": ");
+        json_write_double(jw, rate);
+    }
+    json_write_lit(jw, "\n    }");
+}
+
+void gbench_fprint_start(FILE * file)
+{
+    struct timeval now;
+    struct tm tm;
+    char date[sizeof "yyyy-mm-ddThh:mm:ss+hhmm"] = "";
+
+    gettimeofday(&now, NULL);
+    if(localtime_r((const time_t *)&now.tv_sec, &tm) != NULL)
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", &tm);
+    fprintf(file, "{\n  \"context\": {\n");
+    fprintf(file, "    \"date\": \"%s\",\n", date);
+#if defined(_SC_NPROCESSORS_ONLN)
+    fprintf(file, "    \"num_cpus\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN));
+#endif
+    fprintf(file, "    \"library_version\": \"%d.%d.%d\",\n",
+            check_major_version, check_minor_version, check_micro_version);
+    /* whether the loop that times the samples was optimised */
+#if defined(__OPTIMIZE__) || defined(NDEBUG)
+    fprintf(file, "    \"library_build_type\": \"release\"\n");
+#else
+    fprintf(file, "    \"library_build_type\": \"debug\"\n");
+#endif
+    fprintf(file, "  },\n  \"benchmarks\": [");
+}
+
+void gbench_fprint_end(FILE * file)
+{
+    fprintf(file, "\n  ]\n}\n");
+}
+
+void gbench_fprint_run(FILE * file, const char *name, int64_t iterations,
+                       double ns, double cpu_ns, const char *counter,
+                       double rate, int first)
+{
+    JsonWriter jw;
+
+    jw.file = file;
+    jw.len = 0;
+    json_write_lit(&jw, first ? "\n" : ",\n");
+    gbench_write_run(&jw, name, NULL, 1, 0, iterations, ns, cpu_ns,
+                     counter, rate);
+    fwrite(jw.buf, 1, jw.len, file);
+}
+
+void tr_gbenchprint(FILE * file, TestResult * tr, const char *sname,
+                    int first)
+{
+    JsonWriter jw;
+    double stats[BENCH_NSTATS];
+    double cpu_stats[BENCH_NSTATS];
+    char *name;
+    int i;
+
+    if(tr->bench == NULL)
+        return;
+    name = bench_name(sname, tr->tcname, tr->tname, tr->iter);
+
+    jw.file = file;
+    jw.len = 0;
+    for(i = 0; i < tr->bench->nsamples; i++)
+    {
+        json_write_lit(&jw, first && i == 0 ? "\n" : ",\n");
+        gbench_write_run(&jw, name, NULL, tr->bench->nsamples, i,
+                         tr->bench->iterations, tr->bench->samples[i],
+                         tr->bench->cpu_samples != NULL ?
+                         tr->bench->cpu_samples[i] : -1, NULL, 0);
+    }
+    bench_stat_values(tr->bench, stats);
+    if(tr->bench->cpu_samples != NULL)
+        bench_cpu_stat_values(tr->bench, cpu_stats);
+    for(i = 0; i < BENCH_NSTATS; i++)
+    {
+        json_write_lit(&jw, ",\n");
+        gbench_write_run(&jw, name, bench_stat_names[i],
+                         tr->bench->nsamples, 0, tr->bench->nsamples,
+                         stats[i], tr->bench->cpu_samples != NULL ?
+                         cpu_stats[i] : -1, NULL, 0);
+    }
+    fwrite(jw.buf, 1, jw.len, file);
+    free(name);
+}
+
 enum print_output get_env_printmode(void)
 {
     char *env = getenv("CK_VERBOSITY");
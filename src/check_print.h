@@ -21,10 +21,42 @@
 #ifndef CHECK_PRINT_H
 #define CHECK_PRINT_H
 
-/* escape XML special characters (" ' < > &) in str and print to file */
+/* escape XML special characters (" ' < > &) and control characters
+   in str and print to file */
 void fprint_xml_esc(FILE * file, const char *str);
+/* print a time in nanoseconds as seconds with the given number of
+   decimals (at most 9), or as -1 if it is negative */
+void fprint_seconds(FILE * file, int64_t ns, int digits);
+
+#define RUSAGE_NFIELDS 7
+/* the names the logs give the fields of a TestRusage, in order */
+extern const char *const rusage_names[RUSAGE_NFIELDS];
+/* store the fields of ru in values, in the order of rusage_names */
+void rusage_values(const TestRusage * ru, long *values);
+/* the names the logs give the phases of enum ck_phase, in order */
+extern const char *const phase_names[NPHASES];
 void tr_fprint(FILE * file, TestResult * tr, enum print_output print_mode);
 void tr_xmlprint(FILE * file, TestResult * tr, enum print_output print_mode);
+void tr_junitprint(FILE * file, TestResult * tr,
+                   enum print_output print_mode);
+/* print tr as a single line JSON object, sname being its suite's name */
+void tr_jsonprint(FILE * file, TestResult * tr, const char *sname);
+/* print the samples and statistics of a benchmark as entries of the
+   "benchmarks" array of Google Benchmark's JSON output, preceded by a
+   comma unless it is the first */
+void tr_gbenchprint(FILE * file, TestResult * tr, const char *sname,
+                    int first);
+/* print what comes before and after the entries of the "benchmarks"
+   array of Google Benchmark's JSON output */
+void gbench_fprint_start(FILE * file);
+void gbench_fprint_end(FILE * file);
+/* print one run of iterations calls of the benchmark name, each taking
+   ns of wall clock and cpu_ns of CPU time (left out if negative), as an
+   entry of that array, preceded by a comma unless it is the first. If
+   counter is not NULL, it names a rate added to the entry */
+void gbench_fprint_run(FILE * file, const char *name, int64_t iterations,
+                       double ns, double cpu_ns, const char *counter,
+                       double rate, int first);
 void srunner_fprint(FILE * file, SRunner * sr, enum print_output print_mode);
 enum print_output get_env_printmode(void);
 
@@ -26,15 +26,27 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdarg.h>
+#include <math.h>
 #include <signal.h>
 #include <setjmp.h>
+#if defined(HAVE_SYS_RESOURCE_H)
+#include <sys/resource.h>
+#endif
 
 #include "check.h"
 #include "check_error.h"
 #include "check_list.h"
 #include "check_impl.h"
+#include "check_perf.h"
+#include "check_alloc.h"
+#include "check_baseline.h"
+#include "check_history.h"
+#include "check_stats.h"
 #include "check_msg.h"
+#include "check_pack.h"
+#include "check_arena.h"
 #include "check_log.h"
+#include "check_str.h"
 
 enum rinfo
 {
@@ -53,6 +65,32 @@ enum tf_type
 };
 
 
+#if defined(HAVE_PTHREAD) && defined(HAVE_FORK) && HAVE_FORK==1
+/* unchecked setup can run ahead of its test case in a thread */
+#define CK_SETUP_AHEAD 1
+
+/*
+ * The unchecked setup of a test case, run in a thread of its own while
+ * the test case before it runs.
+ */
+typedef struct SetupAhead
+{
+    pthread_t thread;
+    TCase *tc;
+    jmp_buf jmp;                /* where its failures return to */
+    TestResult *tr;             /* the failure of the setup, or NULL */
+} SetupAhead;
+#endif
+
+#if defined(HAVE_SYS_RESOURCE_H) && defined(HAVE_GETRUSAGE)
+/* In nofork mode, only count the thread running the tests if possible */
+#if defined(RUSAGE_THREAD)
+#define CK_RUSAGE_WHO RUSAGE_THREAD
+#else
+#define CK_RUSAGE_WHO RUSAGE_SELF
+#endif
+#endif
+
 /* all functions are defined in the same order they are declared.
    functions that depend on forking are gathered all together.
    non-static functions are at the end of the file. */
@@ -61,40 +99,73 @@ static void srunner_run_end(SRunner * sr, enum print_output print_mode);
 static void srunner_iterate_suites(SRunner * sr,
                                    const char *sname, const char *tcname,
                                    enum print_output print_mode);
-static void srunner_iterate_tcase_tfuns(SRunner * sr, TCase * tc);
-static void srunner_add_failure(SRunner * sr, TestResult * tf);
-static TestResult * srunner_run_setup(List * func_list,
+static void srunner_iterate_tcase_tfuns(SRunner * sr, Suite * s,
+                                        TCase * tc);
+static void srunner_add_phases(SRunner * sr, TestResult * tr);
+static int srunner_keeps_result(SRunner * sr, TestResult * tr);
+static TestResult *srunner_add_failure(SRunner * sr, TestResult * tf);
+static TestResult * srunner_run_setup(SRunner * sr, List * func_list,
     enum fork_status fork_usage, const char * test_name,
     const char * setup_name);
+static int srunner_run_shared_setup(SRunner * sr, List * fixture_list,
+                                    const char *name, const char *setup_name);
+static void srunner_run_shared_teardown(SRunner * sr, List * fixture_list,
+                                        const char *name,
+                                        const char *teardown_name);
 static int srunner_run_unchecked_setup(SRunner * sr, TCase * tc);
 static TestResult *tcase_run_checked_setup(SRunner * sr, TCase * tc);
 static void srunner_run_teardown(List * fixture_list, enum fork_status fork_usage);
 static void srunner_run_unchecked_teardown(SRunner * sr, TCase * tc);
 static void tcase_run_checked_teardown(TCase * tc);
-static void srunner_run_tcase(SRunner * sr, TCase * tc);
+static void srunner_run_tcase(SRunner * sr, Suite * s, TCase * tc,
+                              TCase * next);
+#if defined(CK_SETUP_AHEAD)
+static int setup_can_run_ahead(SRunner * sr, TCase * tc);
+static void *setup_ahead_run(void *arg);
+static void setup_ahead_start(SRunner * sr, TCase * tc);
+static int setup_ahead_finish(SRunner * sr);
+#endif
 static TestResult *tcase_run_tfun_nofork(SRunner * sr, TCase * tc, TF * tf,
                                          int i);
-static TestResult *receive_result_info_nofork(const char *tcname,
+static TestResult *receive_result_info_nofork(SRunner * sr,
+                                              const char *tcname,
                                               const char *tname, int iter,
-                                              int duration);
+                                              int64_t duration);
 static void set_nofork_info(TestResult * tr);
+static void set_bench_msg(TestResult * tr);
+static void check_alloc_limits(SRunner * sr, TestResult * tr);
+static int64_t tr_timed_ns(TestResult * tr);
 static char *pass_msg(void);
+#if defined(HAVE_SYS_RESOURCE_H) && (defined(HAVE_GETRUSAGE) || defined(HAVE_WAIT4))
+static void tr_set_rusage(TestResult * tr, const struct rusage *start,
+                          const struct rusage *end);
+#endif
 
 #if defined(HAVE_FORK) && HAVE_FORK==1
-static TestResult *tcase_run_tfun_fork(SRunner * sr, TCase * tc, TF * tf,
-                                       int i);
-static TestResult *receive_result_info_fork(const char *tcname,
+static TestResult *tcase_run_tfun_fork(SRunner * sr, Suite * s, TCase * tc,
+                                       TF * tf, int i);
+static TestResult *receive_result_info_fork(SRunner * sr,
+                                            const char *tcname,
                                             const char *tname, int iter,
                                             int status, int expected_signal,
                                             signed char allowed_exit_value);
 static void set_fork_info(TestResult * tr, int status, int expected_signal,
                           signed char allowed_exit_value);
+static void set_rlimits(TCase * tc);
+static void set_limit_info(TCase * tc, TestResult * tr, int status,
+                           int expected_signal, size_t failed_size);
 static char *signal_msg(int sig);
 static char *signal_error_msg(int signal_received, int signal_expected);
 static char *exit_msg(int exitstatus);
 static int waserror(int status, int expected_signal);
 
 static int alarm_received;
+/* what to say when the timeout expired, which depends on the clock */
+static const char *timeout_expired = "Test timeout expired";
+/* room for a time formatted by stats_fmt_time */
+#define TIMEOUT_TIME_LEN 32
+static char adaptive_expired[sizeof("Test timeout of ") + TIMEOUT_TIME_LEN +
+                             sizeof(" from its history expired") - 2];
 static pid_t group_pid;
 
 static void CK_ATTRIBUTE_UNUSED sig_handler(int sig_nr)
@@ -114,17 +185,56 @@ static void CK_ATTRIBUTE_UNUSED sig_handler(int sig_nr)
 
 #define MSG_LEN 100
 
+#ifndef DEFAULT_TIMEOUT_CEILING
+#define DEFAULT_TIMEOUT_CEILING 10
+#endif
+
 static void srunner_run_init(SRunner * sr, enum print_output print_mode)
 {
+    const char *perf_events;
+    const char *baseline;
+    const char *history;
+    int i;
+
+    sr->run_start = _ck_clock_ns();
+    for(i = 0; i < NPHASES; i++)
+        sr->phases[i] = 0;
     set_fork_status(srunner_fork_status(sr));
     setup_messaging();
     srunner_init_logging(sr, print_mode);
+    /* opened after the logging thread starts, so it is not counted */
+    perf_events = srunner_perf_counters(sr);
+    if(perf_events != NULL)
+        sr->perf = perf_counters_open(perf_events);
+    baseline = srunner_baseline_fname(sr);
+    if(baseline != NULL)
+        sr->baseline = baseline_load(baseline);
+    history = srunner_timeout_history(sr);
+    if(history != NULL)
+        sr->history = history_load(history);
     log_srunner_start(sr);
 }
 
 static void srunner_run_end(SRunner * sr,
                             enum print_output CK_ATTRIBUTE_UNUSED print_mode)
 {
+    if(sr->perf != NULL)
+    {
+        perf_counters_close(sr->perf);
+        sr->perf = NULL;
+    }
+    if(sr->baseline != NULL)
+    {
+        baseline_free(sr->baseline);
+        sr->baseline = NULL;
+    }
+    if(sr->history != NULL)
+    {
+        history_save(sr->history, srunner_timeout_history(sr));
+        history_free(sr->history);
+        sr->history = NULL;
+    }
+    sr->run_ns = _ck_clock_ns() - sr->run_start;
     log_srunner_end(sr);
     srunner_end_logging(sr);
     teardown_messaging();
@@ -153,30 +263,45 @@ static void srunner_iterate_suites(SRunner * sr,
 
         log_suite_start(sr, s);
 
-        tcl = s->tclst;
-
-        for(check_list_front(tcl); !check_list_at_end(tcl);
-            check_list_advance(tcl))
+        if(srunner_run_shared_setup(sr, s->sflst, s->name, "suite_setup"))
         {
-            tc = (TCase *)check_list_val(tcl);
+            tcl = s->tclst;
+            tc = NULL;
 
-            if((tcname != NULL) && (strcmp(tcname, tc->name) != 0))
+            /* each test case is run once the next is known, so that its
+               setup can be started ahead */
+            for(check_list_front(tcl); !check_list_at_end(tcl);
+                check_list_advance(tcl))
             {
-                continue;
+                TCase *next = (TCase *)check_list_val(tcl);
+
+                if((tcname != NULL) && (strcmp(tcname, next->name) != 0))
+                {
+                    continue;
+                }
+
+                if(tc != NULL)
+                    srunner_run_tcase(sr, s, tc, next);
+                tc = next;
             }
+            if(tc != NULL)
+                srunner_run_tcase(sr, s, tc, NULL);
 
-            srunner_run_tcase(sr, tc);
+            srunner_run_shared_teardown(sr, s->tflst, s->name,
+                                        "suite_teardown");
         }
 
         log_suite_end(sr, s);
     }
 }
 
-static void srunner_iterate_tcase_tfuns(SRunner * sr, TCase * tc)
+static void srunner_iterate_tcase_tfuns(SRunner * sr, Suite * s,
+                                        TCase * tc)
 {
     List *tfl;
     TF *tfun;
     TestResult *tr = NULL;
+    int64_t checked, logged;
 
     tfl = tc->tflst;
 
@@ -194,7 +319,7 @@ static void srunner_iterate_tcase_tfuns(SRunner * sr, TCase * tc)
             {
                 case CK_FORK:
 #if defined(HAVE_FORK) && HAVE_FORK==1
-                    tr = tcase_run_tfun_fork(sr, tc, tfun, i);
+                    tr = tcase_run_tfun_fork(sr, s, tc, tfun, i);
 #else /* HAVE_FORK */
                     eprintf("This version does not support fork", __FILE__,
                             __LINE__);
@@ -210,25 +335,77 @@ static void srunner_iterate_tcase_tfuns(SRunner * sr, TCase * tc)
 
             if(NULL != tr)
             {
-                srunner_add_failure(sr, tr);
-                log_test_end(sr, tr);
+                checked = _ck_clock_ns();
+                check_alloc_limits(sr, tr);
+                if(sr->baseline != NULL)
+                    baseline_compare(sr->baseline, tr, s->name,
+                                     srunner_baseline_threshold(sr));
+                if(sr->history != NULL && tr->rtype == CK_PASS &&
+                   tr->duration >= 0)
+                {
+                    char *name = bench_name(s->name, tc->name, tfun->name, i);
+
+                    history_add(sr->history, name, tr_timed_ns(tr));
+                    free(name);
+                }
+                logged = _ck_clock_ns();
+                if(tr->phases[CK_PHASE_REPORT] >= 0)
+                    tr->phases[CK_PHASE_REPORT] += logged - checked;
+                srunner_add_phases(sr, tr);
+                tr = srunner_add_failure(sr, tr);
+                if(srunner_keeps_result(sr, tr))
+                    log_test_end(sr, tr);
+                else
+                    log_test_end_free(sr, tr);
+                /* logging is not part of the result it logs */
+                sr->phases[CK_PHASE_REPORT] += _ck_clock_ns() - logged;
             }
         }
     }
 }
 
-static void srunner_add_failure(SRunner * sr, TestResult * tr)
+/* Add the known phase times of tr to the totals of the run */
+static void srunner_add_phases(SRunner * sr, TestResult * tr)
+{
+    int i;
+
+    for(i = 0; i < NPHASES; i++)
+    {
+        if(tr->phases[i] > 0)
+            sr->phases[i] += tr->phases[i];
+    }
+}
+
+/*
+ * Whether tr is kept in the result list, or only counted and logged.
+ */
+static int srunner_keeps_result(SRunner * sr, TestResult * tr)
+{
+    return tr->rtype != CK_PASS || !srunner_streaming(sr);
+}
+
+/*
+ * Count tr, and keep it unless it is dropped in streaming mode. Return
+ * the result to log, which is freed with the runner if it was kept.
+ */
+static TestResult *srunner_add_failure(SRunner * sr, TestResult * tr)
 {
-    check_list_add_end(sr->resultlst, tr);
     sr->stats->n_checked++;     /* count checks during setup, test, and teardown */
     if(tr->rtype == CK_FAILURE)
         sr->stats->n_failed++;
     else if(tr->rtype == CK_ERROR)
         sr->stats->n_errors++;
 
+    if(srunner_keeps_result(sr, tr))
+    {
+        tr = srunner_store_result(sr, tr);
+        check_list_add_end(sr->resultlst, tr);
+    }
+    return tr;
 }
 
-static TestResult * srunner_run_setup(List * fixture_list, enum fork_status fork_usage,
+static TestResult * srunner_run_setup(SRunner * sr, List * fixture_list,
+    enum fork_status fork_usage,
     const char * test_name, const char * setup_name)
 {
     TestResult *tr = NULL;
@@ -254,15 +431,13 @@ static TestResult * srunner_run_setup(List * fixture_list, enum fork_status fork
             }
 
             /* Stop the setup and return the failure in nofork mode. */
-            tr = receive_result_info_nofork(test_name, setup_name, 0, -1);
+            tr = receive_result_info_nofork(sr, test_name, setup_name, 0, -1);
             if(tr->rtype != CK_PASS)
             {
                 break;
             }
 
-            free(tr->file);
-            free(tr->msg);
-            free(tr);
+            tr_free(tr);
             tr = NULL;
         }
         else
@@ -274,13 +449,18 @@ static TestResult * srunner_run_setup(List * fixture_list, enum fork_status fork
     return tr;
 }
 
-static int srunner_run_unchecked_setup(SRunner * sr, TCase * tc)
+/*
+ * Run fixtures in the runner itself, whatever the fork status, and
+ * report the first failure. Return 0 if one failed.
+ */
+static int srunner_run_shared_setup(SRunner * sr, List * fixture_list,
+                                    const char *name, const char *setup_name)
 {
     TestResult *tr = NULL;
     int rval = 1;
 
     set_fork_status(CK_NOFORK);
-    tr = srunner_run_setup(tc->unch_sflst, CK_NOFORK, tc->name, "unchecked_setup");
+    tr = srunner_run_setup(sr, fixture_list, CK_NOFORK, name, setup_name);
     set_fork_status(srunner_fork_status(sr));
 
     if(tr != NULL && tr->rtype != CK_PASS)
@@ -292,9 +472,41 @@ static int srunner_run_unchecked_setup(SRunner * sr, TCase * tc)
     return rval;
 }
 
+/*
+ * Run the teardowns of suite and runner fixtures in the runner, and
+ * report their failure, which would otherwise be left in the pipe for
+ * the next test to receive.
+ */
+static void srunner_run_shared_teardown(SRunner * sr, List * fixture_list,
+                                        const char *name,
+                                        const char *teardown_name)
+{
+    TestResult *tr;
+
+    check_list_front(fixture_list);
+    if(check_list_at_end(fixture_list))
+        return;
+
+    set_fork_status(CK_NOFORK);
+    srunner_run_teardown(fixture_list, CK_NOFORK);
+    tr = receive_result_info_nofork(sr, name, teardown_name, 0, -1);
+    set_fork_status(srunner_fork_status(sr));
+
+    if(tr->rtype != CK_PASS)
+        srunner_add_failure(sr, tr);
+    else
+        tr_free(tr);
+}
+
+static int srunner_run_unchecked_setup(SRunner * sr, TCase * tc)
+{
+    return srunner_run_shared_setup(sr, tc->unch_sflst, tc->name,
+                                    "unchecked_setup");
+}
+
 static TestResult *tcase_run_checked_setup(SRunner * sr, TCase * tc)
 {
-    TestResult *tr = srunner_run_setup(tc->ch_sflst, srunner_fork_status(sr),
+    TestResult *tr = srunner_run_setup(sr, tc->ch_sflst, srunner_fork_status(sr),
         tc->name, "checked_setup");
 
     return tr;
@@ -339,45 +551,193 @@ static void tcase_run_checked_teardown(TCase * tc)
     srunner_run_teardown(tc->ch_tflst, CK_NOFORK);
 }
 
-static void srunner_run_tcase(SRunner * sr, TCase * tc)
+static void srunner_run_tcase(SRunner * sr, Suite * s, TCase * tc,
+                              TCase * CK_ATTRIBUTE_UNUSED next)
 {
-    if(srunner_run_unchecked_setup(sr, tc))
+    int ready;
+
+#if defined(CK_SETUP_AHEAD)
+    /* a setup run ahead is always for the test case after the last */
+    if(sr->ahead != NULL)
+        ready = setup_ahead_finish(sr);
+    else
+#endif
+        ready = srunner_run_unchecked_setup(sr, tc);
+
+    if(ready)
     {
-        srunner_iterate_tcase_tfuns(sr, tc);
+#if defined(CK_SETUP_AHEAD)
+        if(next != NULL && setup_can_run_ahead(sr, next))
+            setup_ahead_start(sr, next);
+#endif
+        srunner_iterate_tcase_tfuns(sr, s, tc);
         srunner_run_unchecked_teardown(sr, tc);
     }
 }
 
+#if defined(CK_SETUP_AHEAD)
+static int setup_can_run_ahead(SRunner * sr, TCase * tc)
+{
+    /* in nofork mode the tests would run in the process being set up */
+    if(!tc->independent || srunner_fork_status(sr) != CK_FORK
+       || !srunner_pipelined_setup(sr))
+        return 0;
+
+    check_list_front(tc->unch_sflst);
+    return !check_list_at_end(tc->unch_sflst);
+}
+
+static void *setup_ahead_run(void *arg)
+{
+    SetupAhead *ahead = (SetupAhead *)arg;
+    List *l = ahead->tc->unch_sflst;
+    Arena *arena = arena_create();
+    sigset_t set;
+
+    /* the timeouts of the tests are for the main thread to handle */
+    sigemptyset(&set);
+    sigaddset(&set, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    setup_thread_messaging(&ahead->jmp);
+    for(check_list_front(l); !check_list_at_end(l); check_list_advance(l))
+    {
+        Fixture *f = (Fixture *)check_list_val(l);
+        TestResult *tr;
+
+        send_ctx_info(CK_CTX_SETUP);
+        if(0 == setjmp(ahead->jmp))
+        {
+            f->fun();
+        }
+
+        /* Stop the setup at the first failure, as in nofork mode. */
+        tr = receive_test_result(arena, 0);
+        if(tr == NULL)
+        {
+            eprintf("Failed to receive test result", __FILE__, __LINE__);
+        }
+        tr->tcname = ahead->tc->name;
+        tr->tname = "unchecked_setup";
+        tr->iter = 0;
+        tr->duration = -1;
+        set_nofork_info(tr);
+        if(tr->rtype != CK_PASS)
+        {
+            ahead->tr = tr;
+            break;
+        }
+        tr_free(tr);
+    }
+    teardown_thread_messaging();
+    arena_free(arena);
+
+    return NULL;
+}
+
+static void setup_ahead_start(SRunner * sr, TCase * tc)
+{
+    SetupAhead *ahead = (SetupAhead *)emalloc(sizeof(SetupAhead));
+
+    ahead->tc = tc;
+    ahead->tr = NULL;
+    ppack_fork_safe();
+    if(pthread_create(&ahead->thread, NULL, setup_ahead_run, ahead) != 0)
+    {
+        /* the setup is run when its test case starts instead */
+        free(ahead);
+        return;
+    }
+    sr->ahead = ahead;
+}
+
+/*
+ * Wait for the setup run ahead and report its failure, as
+ * srunner_run_unchecked_setup() would. Return 0 if it failed.
+ */
+static int setup_ahead_finish(SRunner * sr)
+{
+    SetupAhead *ahead = sr->ahead;
+    int rval = 1;
+
+    pthread_join(ahead->thread, NULL);
+    sr->ahead = NULL;
+    if(ahead->tr != NULL)
+    {
+        srunner_add_failure(sr, ahead->tr);
+        rval = 0;
+    }
+    free(ahead);
+
+    return rval;
+}
+#endif /* CK_SETUP_AHEAD */
+
 static TestResult *tcase_run_tfun_nofork(SRunner * sr, TCase * tc, TF * tfun,
                                          int i)
 {
     TestResult *tr;
     struct timespec ts_start = {0, 0}, ts_end = {0, 0};
+    struct timespec ts_setup, ts_done, ts_reported;
+    /* volatile, as the test may return here by longjmp */
+    PerfSample *volatile perf = NULL;
+#if defined(CK_RUSAGE_WHO)
+    struct rusage ru_start, ru_end;
+    int have_rusage;
+#endif
 
+    clock_gettime(check_get_clockid(), &ts_setup);
     tr = tcase_run_checked_setup(sr, tc);
-    if(tr == NULL)
+    if(tr != NULL)
     {
+        clock_gettime(check_get_clockid(), &ts_done);
+        tr->phases[CK_PHASE_SETUP] = DIFF_IN_NSEC(ts_setup, ts_done);
+    }
+    else
+    {
+#if defined(CK_RUSAGE_WHO)
+        have_rusage = getrusage(CK_RUSAGE_WHO, &ru_start) == 0;
+#endif
+        if(sr->perf != NULL)
+            perf_counters_start(sr->perf);
         clock_gettime(check_get_clockid(), &ts_start);
         if(0 == setjmp(error_jmp_buffer))
         {
             tfun->fn(i);
         }
         clock_gettime(check_get_clockid(), &ts_end);
+        if(sr->perf != NULL)
+            perf = perf_counters_stop(sr->perf);
+#if defined(CK_RUSAGE_WHO)
+        if(have_rusage && getrusage(CK_RUSAGE_WHO, &ru_end) != 0)
+            have_rusage = 0;
+#endif
         tcase_run_checked_teardown(tc);
-        return receive_result_info_nofork(tc->name, tfun->name, i,
-                                          DIFF_IN_USEC(ts_start, ts_end));
+        clock_gettime(check_get_clockid(), &ts_done);
+        tr = receive_result_info_nofork(sr, tc->name, tfun->name, i,
+                                        DIFF_IN_NSEC(ts_start, ts_end));
+#if defined(CK_RUSAGE_WHO)
+        if(have_rusage)
+            tr_set_rusage(tr, &ru_start, &ru_end);
+#endif
+        tr->perf = perf;
+        clock_gettime(check_get_clockid(), &ts_reported);
+        tr->phases[CK_PHASE_REPORT] = DIFF_IN_NSEC(ts_done, ts_reported);
+        tr->phases[CK_PHASE_SETUP] = DIFF_IN_NSEC(ts_setup, ts_start);
+        tr->phases[CK_PHASE_TEARDOWN] = DIFF_IN_NSEC(ts_end, ts_done);
     }
 
     return tr;
 }
 
-static TestResult *receive_result_info_nofork(const char *tcname,
+static TestResult *receive_result_info_nofork(SRunner * sr,
+                                              const char *tcname,
                                               const char *tname,
-                                              int iter, int duration)
+                                              int iter, int64_t duration)
 {
     TestResult *tr;
 
-    tr = receive_test_result(0);
+    tr = receive_test_result(sr->test_arena, 0);
     if(tr == NULL)
     {
         eprintf("Failed to receive test result", __FILE__, __LINE__);
@@ -388,7 +748,9 @@ static TestResult *receive_result_info_nofork(const char *tcname,
         tr->tname = tname;
         tr->iter = iter;
         tr->duration = duration;
+        tr->phases[CK_PHASE_TEST] = duration;
         set_nofork_info(tr);
+        set_bench_msg(tr);
     }
 
     return tr;
@@ -407,39 +769,220 @@ static void set_nofork_info(TestResult * tr)
     }
 }
 
+/*
+ * A passed benchmark reports its statistics instead of "Passed".
+ */
+static void set_bench_msg(TestResult * tr)
+{
+    if(tr->rtype == CK_PASS && tr->bench != NULL)
+        tr->msg = bench_summary(tr->bench);
+}
+
+/*
+ * Fail a passed test whose allocations went over a limit of sr.
+ */
+static void check_alloc_limits(SRunner * sr, TestResult * tr)
+{
+    int64_t values[ALLOC_NSTATS];
+    int i;
+
+    if(tr->rtype != CK_PASS || tr->allocs.allocs < 0)
+        return;
+    alloc_stat_values(&tr->allocs, values);
+    for(i = 0; i < ALLOC_NSTATS; i++)
+    {
+        int64_t limit = srunner_alloc_limit(sr, (enum ck_alloc_stat)i);
+
+        if(limit >= 0 && values[i] > limit)
+        {
+            if(tr->msg != pass_msg())
+                free(tr->msg);
+            tr->msg = ck_strdup_printf("Over the allocation limit of %s %jd: "
+                                       "%jd allocs of %jd bytes, peak %jd "
+                                       "bytes, %jd leaks of %jd bytes",
+                                       alloc_stat_names[i], (intmax_t)limit,
+                                       (intmax_t)values[CK_ALLOC_COUNT],
+                                       (intmax_t)values[CK_ALLOC_BYTES],
+                                       (intmax_t)values[CK_ALLOC_PEAK_BYTES],
+                                       (intmax_t)values[CK_ALLOC_LEAKS],
+                                       (intmax_t)values[CK_ALLOC_LEAKED_BYTES]);
+            tr->rtype = CK_FAILURE;
+            return;
+        }
+    }
+}
+
 static char *pass_msg(void)
 {
-    return strdup("Passed");
+    return tr_pass_msg();
+}
+
+#if defined(HAVE_SYS_RESOURCE_H) && (defined(HAVE_GETRUSAGE) || defined(HAVE_WAIT4))
+/* Record the resources used from start to end, or in all of end if start
+   is NULL */
+static void tr_set_rusage(TestResult * tr, const struct rusage *start,
+                          const struct rusage *end)
+{
+    TestRusage *tru = &tr->rusage;
+
+    tr->utime = TIMEVAL_IN_NSEC(end->ru_utime);
+    tr->stime = TIMEVAL_IN_NSEC(end->ru_stime);
+    tru->maxrss = end->ru_maxrss;
+#if defined(__APPLE__)
+    /* counted in bytes there, not kilobytes */
+    tru->maxrss /= 1024;
+#endif
+    tru->minflt = end->ru_minflt;
+    tru->majflt = end->ru_majflt;
+    tru->nvcsw = end->ru_nvcsw;
+    tru->nivcsw = end->ru_nivcsw;
+    tru->inblock = end->ru_inblock;
+    tru->oublock = end->ru_oublock;
+    /* the peak is not a count, so it is kept as it was at the end */
+    if(start != NULL)
+    {
+        tr->utime -= TIMEVAL_IN_NSEC(start->ru_utime);
+        tr->stime -= TIMEVAL_IN_NSEC(start->ru_stime);
+        tru->minflt -= start->ru_minflt;
+        tru->majflt -= start->ru_majflt;
+        tru->nvcsw -= start->ru_nvcsw;
+        tru->nivcsw -= start->ru_nivcsw;
+        tru->inblock -= start->ru_inblock;
+        tru->oublock -= start->ru_oublock;
+    }
+}
+#endif
+
+/*
+ * The time the timeout of a test covers: its checked fixtures and its
+ * body, and the end of its process until the runner reaps it, as far
+ * as they are known.
+ */
+static int64_t tr_timed_ns(TestResult * tr)
+{
+    int64_t ns = tr->duration;
+
+    if(tr->phases[CK_PHASE_SETUP] > 0)
+        ns += tr->phases[CK_PHASE_SETUP];
+    if(tr->phases[CK_PHASE_TEARDOWN] > 0)
+        ns += tr->phases[CK_PHASE_TEARDOWN];
+    if(tr->phases[CK_PHASE_REAP] > 0)
+        ns += tr->phases[CK_PHASE_REAP];
+    return ns;
 }
 
 #if defined(HAVE_FORK) && HAVE_FORK==1
-static TestResult *tcase_run_tfun_fork(SRunner * sr, TCase * tc, TF * tfun,
-                                       int i)
+/*
+ * The timeout of the i-th run of tfun: its own or that of its test
+ * case, shortened to what its duration history allows, in which case
+ * *adaptive is set.
+ */
+static struct timespec test_timeout(SRunner * sr, Suite * s, TCase * tc,
+                                    TF * tfun, int i, int *adaptive)
+{
+    struct timespec timeout = tc->timeout;
+    double limit_ns;
+    double ns;
+    char *name;
+
+    *adaptive = 0;
+    if(tfun->timeout >= 0)
+    {
+        timeout.tv_sec = (time_t) floor(tfun->timeout);
+        timeout.tv_nsec = (long)((tfun->timeout - floor(tfun->timeout)) *
+                                 (double)NANOS_PER_SECONDS);
+    }
+    limit_ns = (double)timeout.tv_sec * NANOS_PER_SECONDS + timeout.tv_nsec;
+    /* a timeout of 0 is none, and stays so */
+    if(sr->history == NULL || limit_ns == 0)
+        return timeout;
+
+    name = bench_name(s->name, tc->name, tfun->name, i);
+    ns = history_p99(sr->history, name) * sr->history_factor;
+    free(name);
+    if(ns < 0)
+        return timeout;
+    if(ns < sr->history_floor * NANOS_PER_SECONDS)
+        ns = sr->history_floor * NANOS_PER_SECONDS;
+    if(ns < limit_ns)
+    {
+        timeout.tv_sec = (time_t) (ns / NANOS_PER_SECONDS);
+        timeout.tv_nsec = (long)(ns - (double)timeout.tv_sec *
+                                 NANOS_PER_SECONDS);
+        *adaptive = 1;
+    }
+    return timeout;
+}
+
+static TestResult *tcase_run_tfun_fork(SRunner * sr, Suite * s, TCase * tc,
+                                       TF * tfun, int i)
 {
     pid_t pid_w;
     pid_t pid;
     int status = 0;
     struct timespec ts_start = { 0, 0 }, ts_end ={ 0, 0 };
+    struct timespec ts_fork, ts_forked, ts_setup, ts_done, ts_reaped;
+    struct timespec ts_reported;
 
     timer_t timerid;
     struct itimerspec timer_spec;
+    clockid_t timer_clock = check_get_clockid();
+    int64_t ceiling_ns = 0;     /* of a CPU time timeout, 0 for none */
+    timer_t ceiling_timerid;
+    struct itimerspec ceiling_spec;
+    int adaptive;
+    struct timespec timeout = test_timeout(sr, s, tc, tfun, i, &adaptive);
     TestResult *tr;
+    PerfSample *perf = NULL;
+    int track_allocs = srunner_alloc_tracking(sr) && alloc_track_available();
+#if defined(HAVE_WAIT4)
+    struct rusage ru;
+#endif
 
 
+    srunner_prepare_fork(sr);
+    if(tc->memory_limit > 0)
+        alloc_failure_watch();
+    /* the child inherits the counters, and its counts are added to them
+       when it exits */
+    if(sr->perf != NULL)
+        perf_counters_start(sr->perf);
+    clock_gettime(check_get_clockid(), &ts_fork);
     pid = fork();
+    if(pid != 0)
+    {
+        clock_gettime(check_get_clockid(), &ts_forked);
+        srunner_forked_parent(sr);
+    }
     if(pid == -1)
-        eprintf("Error in call to fork:", __FILE__, __LINE__ - 2);
+        eprintf("Error in call to fork:", __FILE__, __LINE__ - 7);
     if(pid == 0)
     {
         setpgid(0, 0);
         group_pid = getpgrp();
+        srunner_forked_child(sr);
+        set_rlimits(tc);
+        if(track_allocs)
+            alloc_track_start();
+        clock_gettime(check_get_clockid(), &ts_setup);
         tr = tcase_run_checked_setup(sr, tc);
         free(tr);
         clock_gettime(check_get_clockid(), &ts_start);
         tfun->fn(i);
         clock_gettime(check_get_clockid(), &ts_end);
         tcase_run_checked_teardown(tc);
-        send_duration_info(DIFF_IN_USEC(ts_start, ts_end));
+        if(track_allocs)
+        {
+            TestAllocs allocs;
+
+            alloc_track_stop(&allocs);
+            send_alloc_info(&allocs);
+        }
+        clock_gettime(check_get_clockid(), &ts_done);
+        send_duration_info(DIFF_IN_NSEC(ts_start, ts_end),
+                           DIFF_IN_NSEC(ts_setup, ts_start),
+                           DIFF_IN_NSEC(ts_end, ts_done),
+                           TIMESPEC_IN_NSEC(ts_done));
         exit(EXIT_SUCCESS);
     }
     else
@@ -448,20 +991,66 @@ static TestResult *tcase_run_tfun_fork(SRunner * sr, TCase * tc, TF * tfun,
     }
 
     alarm_received = 0;
+    timeout_expired = "Test timeout expired";
+    if(adaptive)
+    {
+        char buf[TIMEOUT_TIME_LEN];
+
+        stats_fmt_time(buf, sizeof(buf),
+                       (double)timeout.tv_sec * NANOS_PER_SECONDS +
+                       timeout.tv_nsec);
+        snprintf(adaptive_expired, sizeof(adaptive_expired),
+                 "Test timeout of %s from its history expired", buf);
+        timeout_expired = adaptive_expired;
+    }
+#if defined(HAVE_CLOCK_GETCPUCLOCKID)
+    if(srunner_timeout_clock(sr) == CK_TIMEOUT_CPU &&
+       clock_getcpuclockid(pid, &timer_clock) == 0)
+    {
+        double ceiling = srunner_timeout_ceiling(sr);
 
-    if(timer_create(check_get_clockid(),
+        timeout_expired = "Test CPU time timeout expired";
+        if(ceiling > 0)
+        {
+            double ns = ((double)timeout.tv_sec * NANOS_PER_SECONDS +
+                         timeout.tv_nsec) * ceiling;
+
+            ceiling_ns = (int64_t)ns;
+        }
+    }
+#endif /* HAVE_CLOCK_GETCPUCLOCKID */
+    if(ceiling_ns > 0)
+        clock_gettime(check_get_clockid(), &ts_start);
+
+    if(timer_create(timer_clock,
                     NULL /* fire SIGALRM if timer expires */ ,
                     &timerid) == 0)
     {
         /* Set the timer to fire once */
-        timer_spec.it_value = tc->timeout;
+        timer_spec.it_value = timeout;
         timer_spec.it_interval.tv_sec = 0;
         timer_spec.it_interval.tv_nsec = 0;
+        /* and in CPU time, a second one for the wall clock ceiling */
+        if(ceiling_ns > 0)
+        {
+            if(timer_create(check_get_clockid(), NULL, &ceiling_timerid) != 0)
+                eprintf("Error in call to timer_create:", __FILE__, __LINE__);
+            ceiling_spec.it_value.tv_sec = ceiling_ns / NANOS_PER_SECONDS;
+            ceiling_spec.it_value.tv_nsec = ceiling_ns % NANOS_PER_SECONDS;
+            ceiling_spec.it_interval.tv_sec = 0;
+            ceiling_spec.it_interval.tv_nsec = 0;
+            if(timer_settime(ceiling_timerid, 0, &ceiling_spec, NULL) != 0)
+                eprintf("Error in call to timer_settime:", __FILE__, __LINE__);
+        }
         if(timer_settime(timerid, 0, &timer_spec, NULL) == 0)
         {
             do
             {
+#if defined(HAVE_WAIT4)
+                pid_w = wait4(pid, &status, 0, &ru);
+#else
                 pid_w = waitpid(pid, &status, 0);
+#endif
             }
             while(pid_w == -1);
         }
@@ -472,19 +1061,146 @@ static TestResult *tcase_run_tfun_fork(SRunner * sr, TCase * tc, TF * tfun,
 
         /* If the timer has not fired, disable it */
         timer_delete(timerid);
+        if(ceiling_ns > 0)
+        {
+            timer_delete(ceiling_timerid);
+            clock_gettime(check_get_clockid(), &ts_end);
+            if(alarm_received && DIFF_IN_NSEC(ts_start, ts_end) >= ceiling_ns)
+                timeout_expired = "Test wall clock ceiling expired";
+        }
+        if(sr->perf != NULL)
+            perf = perf_counters_stop(sr->perf);
     }
     else
     {
         eprintf("Error in call to timer_create:", __FILE__, __LINE__);
     }
 
+    clock_gettime(check_get_clockid(), &ts_reaped);
     killpg(pid, SIGKILL);       /* Kill remaining processes. */
 
-    return receive_result_info_fork(tc->name, tfun->name, i, status,
-                                    tfun->signal, tfun->allowed_exit_value);
+    tr = receive_result_info_fork(sr, tc->name, tfun->name, i, status,
+                                  tfun->signal, tfun->allowed_exit_value);
+#if defined(HAVE_WAIT4)
+    tr_set_rusage(tr, NULL, &ru);
+#endif
+    set_limit_info(tc, tr, status, tfun->signal,
+                   tc->memory_limit > 0 ? alloc_failure() : 0);
+    tr->perf = perf;
+    clock_gettime(check_get_clockid(), &ts_reported);
+    tr->phases[CK_PHASE_FORK] = DIFF_IN_NSEC(ts_fork, ts_forked);
+    /* the test process sends the time it was done with the others */
+    if(tr->phases[CK_PHASE_REAP] >= 0)
+        tr->phases[CK_PHASE_REAP] = TIMESPEC_IN_NSEC(ts_reaped) -
+            tr->phases[CK_PHASE_REAP];
+    tr->phases[CK_PHASE_REPORT] = DIFF_IN_NSEC(ts_reaped, ts_reported);
+    return tr;
 }
 
-static TestResult *receive_result_info_fork(const char *tcname,
+#if defined(HAVE_SYS_RESOURCE_H) && defined(HAVE_SETRLIMIT)
+/* Lower a limit of the process, keeping the hard limit if it is lower */
+static void lower_rlimit(int resource, rlim_t soft, rlim_t hard)
+{
+    struct rlimit rl;
+
+    if(getrlimit(resource, &rl) != 0)
+        return;
+    if(rl.rlim_max != RLIM_INFINITY && rl.rlim_max < hard)
+        hard = rl.rlim_max;
+    rl.rlim_cur = soft < hard ? soft : hard;
+    rl.rlim_max = hard;
+    setrlimit(resource, &rl);
+}
+#endif /* HAVE_SETRLIMIT */
+
+/* Apply the limits of the test case, in the child running a test */
+static void set_rlimits(TCase * tc)
+{
+#if defined(HAVE_SYS_RESOURCE_H) && defined(HAVE_SETRLIMIT)
+    if(tc->memory_limit > 0)
+    {
+#if defined(RLIMIT_AS)
+        lower_rlimit(RLIMIT_AS, tc->memory_limit, tc->memory_limit);
+#endif
+#if defined(RLIMIT_DATA)
+        lower_rlimit(RLIMIT_DATA, tc->memory_limit, tc->memory_limit);
+#endif
+    }
+    if(tc->cpu_limit > 0)
+    {
+        rlim_t seconds = (rlim_t) ceil(tc->cpu_limit);
+
+        /* SIGXCPU at the soft limit, SIGKILL a second later if it is
+           caught */
+        lower_rlimit(RLIMIT_CPU, seconds, seconds + 1);
+    }
+#else
+    (void)tc;
+#endif /* HAVE_SETRLIMIT */
+}
+
+/*
+ * Tell a test stopped by the limits of its test case from one that
+ * ended on its own, once set_fork_info() has set its result.
+ * failed_size is the size of an allocation that failed in it, or 0 if
+ * none is known, as when allocations are not tracked: then a test that
+ * took at least half of the memory limit resident is taken to have
+ * reached it.
+ */
+static void set_limit_info(TCase * tc, TestResult * tr, int status,
+                           int signal_expected, size_t failed_size)
+{
+    int signal_received = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+    int over_cpu = 0;
+    char *msg;
+
+    if(tc->cpu_limit > 0 && signal_received != signal_expected &&
+       !alarm_received)
+    {
+#if defined(SIGXCPU)
+        over_cpu = signal_received == SIGXCPU;
+#endif
+        /* the hard limit, if SIGXCPU was caught */
+        if(signal_received == SIGKILL && tr->utime >= 0)
+            over_cpu = tr->utime + tr->stime >=
+                (int64_t)ceil(tc->cpu_limit) * NANOS_PER_SECONDS;
+    }
+
+    if(over_cpu)
+    {
+        msg = ck_strdup_printf("CPU time limit of %gs exceeded",
+                               ceil(tc->cpu_limit));
+    }
+    else if(failed_size != 0 && tr->rtype != CK_PASS)
+    {
+        msg = ck_strdup_printf("Memory limit of %lu bytes exceeded: "
+                               "allocating %lu bytes failed (%s)",
+                               (unsigned long)tc->memory_limit,
+                               (unsigned long)failed_size,
+                               tr->msg != NULL ? tr->msg : "no message");
+    }
+    else if(tc->memory_limit > 0 && tr->rtype != CK_PASS && !alarm_received &&
+            tr->rusage.maxrss >= 0 &&
+            (uint64_t)tr->rusage.maxrss * 1024 >= tc->memory_limit / 2)
+    {
+        msg = ck_strdup_printf("Memory limit of %lu bytes exceeded: "
+                               "%ld KB resident at peak (%s)",
+                               (unsigned long)tc->memory_limit,
+                               tr->rusage.maxrss,
+                               tr->msg != NULL ? tr->msg : "no message");
+    }
+    else
+    {
+        return;
+    }
+    if(tr->msg != NULL && tr->msg != pass_msg())
+        free(tr->msg);
+    tr->msg = msg;
+    tr->rtype = CK_ERROR;
+}
+
+static TestResult *receive_result_info_fork(SRunner * sr,
+                                            const char *tcname,
                                             const char *tname,
                                             int iter,
                                             int status, int expected_signal,
@@ -492,7 +1208,7 @@ static TestResult *receive_result_info_fork(const char *tcname,
 {
     TestResult *tr;
 
-    tr = receive_test_result(waserror(status, expected_signal));
+    tr = receive_test_result(sr->test_arena, waserror(status, expected_signal));
     if(tr == NULL)
     {
         eprintf("Failed to receive test result", __FILE__, __LINE__);
@@ -503,6 +1219,7 @@ static TestResult *receive_result_info_fork(const char *tcname,
         tr->tname = tname;
         tr->iter = iter;
         set_fork_info(tr, status, expected_signal, allowed_exit_value);
+        set_bench_msg(tr);
     }
 
     return tr;
@@ -612,7 +1329,7 @@ static char *signal_msg(int signal)
 
     if(alarm_received)
     {
-        snprintf(msg, MSG_LEN, "Test timeout expired");
+        snprintf(msg, MSG_LEN, "%s", timeout_expired);
     }
     else
     {
@@ -632,9 +1349,8 @@ static char *signal_error_msg(int signal_received, int signal_expected)
     sig_e_str = strdup(strsignal(signal_expected));
     if(alarm_received)
     {
-        snprintf(msg, MSG_LEN,
-                 "Test timeout expired, expected signal %d (%s)",
-                 signal_expected, sig_e_str);
+        snprintf(msg, MSG_LEN, "%s, expected signal %d (%s)",
+                 timeout_expired, signal_expected, sig_e_str);
     }
     else
     {
@@ -706,6 +1422,63 @@ void srunner_set_fork_status(SRunner * sr, enum fork_status fstat)
     sr->fstat = fstat;
 }
 
+void srunner_set_timeout_clock(SRunner * sr, enum ck_timeout_clock clock)
+{
+    sr->timeout_clock = clock;
+}
+
+enum ck_timeout_clock srunner_timeout_clock(SRunner * sr)
+{
+    char *env;
+
+    if(sr->timeout_clock != CK_TIMEOUT_CLOCK_GETENV)
+        return sr->timeout_clock;
+
+    env = getenv("CK_TIMEOUT_CLOCK");
+    if(env != NULL && strcmp(env, "cpu") == 0)
+        return CK_TIMEOUT_CPU;
+    return CK_TIMEOUT_WALL;
+}
+
+void srunner_set_timeout_ceiling(SRunner * sr, double ceiling)
+{
+    sr->timeout_ceiling = ceiling < 0 ? 0 : ceiling;
+}
+
+double srunner_timeout_ceiling(SRunner * sr)
+{
+    char *env;
+
+    if(sr->timeout_ceiling >= 0)
+        return sr->timeout_ceiling;
+
+    env = getenv("CK_TIMEOUT_CEILING");
+    if(env != NULL)
+    {
+        char *endptr = NULL;
+        double tmp = strtod(env, &endptr);
+
+        if(tmp >= 0 && endptr != env && (*endptr) == '\0')
+            return tmp;
+    }
+    return DEFAULT_TIMEOUT_CEILING;
+}
+
+void srunner_set_timeout_history(SRunner * sr, const char *fname,
+                                 double factor, double min_timeout)
+{
+    sr->history_fname = fname;
+    sr->history_factor = factor;
+    sr->history_floor = min_timeout;
+}
+
+const char *srunner_timeout_history(SRunner * sr)
+{
+    if(sr->history_fname != NULL)
+        return sr->history_fname;
+    return getenv("CK_TIMEOUT_HISTORY");
+}
+
 void srunner_run_all(SRunner * sr, enum print_output print_mode)
 {
     srunner_run(sr, NULL,       /* All test suites.  */
@@ -741,7 +1514,12 @@ void srunner_run(SRunner * sr, const char *sname, const char *tcname,
     sigaction(SIGALRM, &new_action, &old_action);
 #endif /* HAVE_SIGACTION && HAVE_FORK */
     srunner_run_init(sr, print_mode);
-    srunner_iterate_suites(sr, sname, tcname, print_mode);
+    if(srunner_run_shared_setup(sr, sr->sflst, "runner", "runner_setup"))
+    {
+        srunner_iterate_suites(sr, sname, tcname, print_mode);
+        srunner_run_shared_teardown(sr, sr->tflst, "runner",
+                                    "runner_teardown");
+    }
     srunner_run_end(sr, print_mode);
 #if defined(HAVE_SIGACTION) && defined(HAVE_FORK)
     sigaction(SIGALRM, &old_action, NULL);
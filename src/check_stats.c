@@ -0,0 +1,389 @@
+/*
+ * Check: a unit test framework for C
+ * Copyright (C) 2001, 2002 Arien Malec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "../lib/libcompat.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "check.h"
+#include "check_error.h"
+#include "check_list.h"
+#include "check_impl.h"
+#include "check_stats.h"
+#include "check_str.h"
+
+static int stats_cmp(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+void stats_sort(double *x, int n)
+{
+    qsort(x, (size_t)n, sizeof(double), stats_cmp);
+}
+
+double stats_percentile(const double *sorted, int n, double p)
+{
+    double pos;
+    int lo;
+
+    if(n <= 0)
+        return 0;
+    pos = p / 100 * (n - 1);
+    lo = (int)pos;
+    if(lo >= n - 1)
+        return sorted[n - 1];
+    return sorted[lo] + (pos - lo) * (sorted[lo + 1] - sorted[lo]);
+}
+
+/*
+ * The one-sided p-value of the Mann-Whitney U test that the values of
+ * b tend to be larger than those of a, from the normal approximation
+ * with a correction for ties.
+ */
+double stats_mann_whitney(const double *a, int na, const double *b, int nb)
+{
+    double n = na + nb;
+    double rank_b = 0;          /* sum of the ranks of b in both */
+    double ties = 0;
+    double u, var, z;
+    int i = 0, j = 0, pos = 0;
+
+    /* merge them, giving tied values the mean of their ranks */
+    while(i < na || j < nb)
+    {
+        double v = j == nb || (i < na && a[i] <= b[j]) ? a[i] : b[j];
+        int ta = 0, tb = 0, t;
+
+        for(; i < na && a[i] == v; i++)
+            ta++;
+        for(; j < nb && b[j] == v; j++)
+            tb++;
+        t = ta + tb;
+        rank_b += tb * (pos + (t + 1) / 2.0);
+        ties += (double)t * t * t - t;
+        pos += t;
+    }
+
+    u = rank_b - nb * (nb + 1) / 2.0;
+    var = na * (double)nb / 12 * ((n + 1) - ties / (n * (n - 1)));
+    if(var <= 0)
+        return 0.5;
+    z = (u - na * (double)nb / 2 - 0.5) / sqrt(var);
+    return 0.5 * erfc(z / sqrt(2.0));
+}
+
+/* xorshift64*, seeded the same on every run so that the intervals of
+   a run can be reproduced */
+static uint64_t stats_rand(uint64_t * state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * UINT64_C(2685821657736338717);
+}
+
+static double resample_median(const double *x, int n, double *buf,
+                              uint64_t * state)
+{
+    int i;
+
+    for(i = 0; i < n; i++)
+        buf[i] = x[stats_rand(state) % (uint64_t)n];
+    stats_sort(buf, n);
+    return stats_percentile(buf, n, 50);
+}
+
+void stats_bootstrap_ratio(const double *a, int na, const double *b, int nb,
+                           double level, double *lo, double *hi)
+{
+    double *ratios =
+        (double *)emalloc(STATS_BOOTSTRAP_RESAMPLES * sizeof(double));
+    double *buf = (double *)emalloc((na > nb ? na : nb) * sizeof(double));
+    uint64_t state = UINT64_C(0x9E3779B97F4A7C15);
+    int k;
+
+    for(k = 0; k < STATS_BOOTSTRAP_RESAMPLES; k++)
+    {
+        double ma = resample_median(a, na, buf, &state);
+        double mb = resample_median(b, nb, buf, &state);
+
+        ratios[k] = ma > 0 ? mb / ma - 1 : 0;
+    }
+    stats_sort(ratios, STATS_BOOTSTRAP_RESAMPLES);
+    *lo = stats_percentile(ratios, STATS_BOOTSTRAP_RESAMPLES,
+                           (100 - level) / 2);
+    *hi = stats_percentile(ratios, STATS_BOOTSTRAP_RESAMPLES,
+                           (100 + level) / 2);
+    free(buf);
+    free(ratios);
+}
+
+/* Store the statistics of n sorted samples in values, in the order of
+   bench_stat_names */
+static void sorted_stat_values(const double *sorted, int n, double *values)
+{
+    double *dev;
+    double sum = 0;
+    int i;
+
+    for(i = 0; i < n; i++)
+        sum += sorted[i];
+    values[CK_BENCH_MIN] = sorted[0];
+    values[CK_BENCH_MEDIAN] = stats_percentile(sorted, n, 50);
+    values[CK_BENCH_MEAN] = sum / n;
+    values[CK_BENCH_P90] = stats_percentile(sorted, n, 90);
+    values[CK_BENCH_P99] = stats_percentile(sorted, n, 99);
+
+    dev = (double *)emalloc(n * sizeof(double));
+    for(i = 0; i < n; i++)
+        dev[i] = fabs(sorted[i] - values[CK_BENCH_MEDIAN]);
+    stats_sort(dev, n);
+    values[CK_BENCH_MAD] = stats_percentile(dev, n, 50);
+    free(dev);
+}
+
+BenchResult *bench_result_from_ns(int64_t iterations, double *ns, int n)
+{
+    BenchResult *br = (BenchResult *)emalloc(sizeof(BenchResult));
+    double values[BENCH_NSTATS];
+
+    br->iterations = iterations;
+    br->nsamples = n;
+    br->samples = ns;
+    br->cpu_samples = NULL;
+    stats_sort(br->samples, n);
+
+    sorted_stat_values(br->samples, n, values);
+    br->min = values[CK_BENCH_MIN];
+    br->median = values[CK_BENCH_MEDIAN];
+    br->mean = values[CK_BENCH_MEAN];
+    br->p90 = values[CK_BENCH_P90];
+    br->p99 = values[CK_BENCH_P99];
+    br->mad = values[CK_BENCH_MAD];
+    return br;
+}
+
+/* A sample in wall and CPU time, to sort them together */
+typedef struct BenchSample
+{
+    double ns;
+    double cpu_ns;
+} BenchSample;
+
+static int bench_sample_cmp(const void *a, const void *b)
+{
+    return stats_cmp(&((const BenchSample *)a)->ns,
+                     &((const BenchSample *)b)->ns);
+}
+
+BenchResult *bench_result_create(int64_t iterations, const int64_t * ps,
+                                 const int64_t * cpu_ps, int n)
+{
+    double *ns = (double *)emalloc(n * sizeof(double));
+    BenchSample *pairs;
+    BenchResult *br;
+    int i;
+
+    if(cpu_ps == NULL)
+    {
+        for(i = 0; i < n; i++)
+            ns[i] = (double)ps[i] / 1000;
+        return bench_result_from_ns(iterations, ns, n);
+    }
+
+    /* sorted here, so that each keeps its CPU time */
+    pairs = (BenchSample *)emalloc(n * sizeof(BenchSample));
+    for(i = 0; i < n; i++)
+    {
+        pairs[i].ns = (double)ps[i] / 1000;
+        pairs[i].cpu_ns = (double)cpu_ps[i] / 1000;
+    }
+    qsort(pairs, (size_t)n, sizeof(BenchSample), bench_sample_cmp);
+    for(i = 0; i < n; i++)
+        ns[i] = pairs[i].ns;
+    br = bench_result_from_ns(iterations, ns, n);
+    br->cpu_samples = (double *)emalloc(n * sizeof(double));
+    for(i = 0; i < n; i++)
+        br->cpu_samples[i] = pairs[i].cpu_ns;
+    free(pairs);
+    return br;
+}
+
+void bench_result_free(BenchResult * br)
+{
+    if(br == NULL)
+        return;
+    free(br->samples);
+    free(br->cpu_samples);
+    free(br);
+}
+
+const char *const bench_stat_names[BENCH_NSTATS] = {
+    "min", "median", "mean", "p90", "p99", "mad"
+};
+
+void bench_stat_values(const BenchResult * br, double *values)
+{
+    values[CK_BENCH_MIN] = br->min;
+    values[CK_BENCH_MEDIAN] = br->median;
+    values[CK_BENCH_MEAN] = br->mean;
+    values[CK_BENCH_P90] = br->p90;
+    values[CK_BENCH_P99] = br->p99;
+    values[CK_BENCH_MAD] = br->mad;
+}
+
+void bench_cpu_stat_values(const BenchResult * br, double *values)
+{
+    double *sorted = (double *)emalloc(br->nsamples * sizeof(double));
+
+    memcpy(sorted, br->cpu_samples, br->nsamples * sizeof(double));
+    stats_sort(sorted, br->nsamples);
+    sorted_stat_values(sorted, br->nsamples, values);
+    free(sorted);
+}
+
+char *bench_name(const char *sname, const char *tcname, const char *tname,
+                 int iter)
+{
+    if(iter != 0)
+        return ck_strdup_printf("%s/%s/%s/%d", sname, tcname, tname, iter);
+    return ck_strdup_printf("%s/%s/%s", sname, tcname, tname);
+}
+
+void stats_fmt_time(char *buf, size_t size, double ns)
+{
+    if(ns < 1e3)
+        snprintf(buf, size, "%.2f ns", ns);
+    else if(ns < 1e6)
+        snprintf(buf, size, "%.2f us", ns / 1e3);
+    else if(ns < 1e9)
+        snprintf(buf, size, "%.2f ms", ns / 1e6);
+    else
+        snprintf(buf, size, "%.2f s", ns / 1e9);
+}
+
+char *bench_summary(const BenchResult * br)
+{
+    char t[6][32];
+
+    stats_fmt_time(t[0], sizeof(t[0]), br->min);
+    stats_fmt_time(t[1], sizeof(t[1]), br->median);
+    stats_fmt_time(t[2], sizeof(t[2]), br->mean);
+    stats_fmt_time(t[3], sizeof(t[3]), br->p90);
+    stats_fmt_time(t[4], sizeof(t[4]), br->p99);
+    stats_fmt_time(t[5], sizeof(t[5]), br->mad);
+    return ck_strdup_printf("min %s, median %s, mean %s, p90 %s, p99 %s, "
+                            "MAD %s (%d samples of %jd iterations)",
+                            t[0], t[1], t[2], t[3], t[4], t[5],
+                            br->nsamples, (intmax_t)br->iterations);
+}
+
+static const char *const complexity_names[] = {
+    "O(1)", "O(log n)", "O(n)", "O(n log n)", "O(n^2)", "O(n^3)"
+};
+
+const char *stats_complexity_name(enum ck_complexity c)
+{
+    if((unsigned int)c >= sizeof(complexity_names) /
+       sizeof(complexity_names[0]))
+        return "O(?)";
+    return complexity_names[c];
+}
+
+static double complexity_f(enum ck_complexity c, double n)
+{
+    switch (c)
+    {
+        case CK_O1:
+            return 1;
+        case CK_OLOG_N:
+            return log(n) / log(2.0);
+        case CK_ON:
+            return n;
+        case CK_ON_LOG_N:
+            return n * log(n) / log(2.0);
+        case CK_ON2:
+            return n * n;
+        case CK_ON3:
+        default:
+            return n * n * n;
+    }
+}
+
+enum ck_complexity stats_fit_complexity(const double *n, const double *t,
+                                        int count, double *rms)
+{
+    enum ck_complexity best = CK_O1;
+    double best_rms = -1;
+    double least = 0;
+    int c, i;
+
+    /* a cost too small to measure counts as a tiny one */
+    for(i = 0; i < count; i++)
+        if(t[i] > least)
+            least = t[i];
+    least *= 1e-9;
+    if(least == 0)
+    {
+        if(rms != NULL)
+            *rms = 0;
+        return CK_O1;
+    }
+
+    for(c = CK_O1; c <= CK_ON3; c++)
+    {
+        double rr = 0, r2 = 0, err = 0, k;
+
+        /* the least squares fit of 1 = k f(n) / t, with r = f(n) / t */
+        for(i = 0; i < count; i++)
+        {
+            double r = complexity_f((enum ck_complexity)c, n[i]) /
+                (t[i] > least ? t[i] : least);
+
+            rr += r;
+            r2 += r * r;
+        }
+        k = r2 > 0 ? rr / r2 : 0;
+        for(i = 0; i < count; i++)
+        {
+            double d = 1 - k * complexity_f((enum ck_complexity)c, n[i]) /
+                (t[i] > least ? t[i] : least);
+
+            err += d * d;
+        }
+        err = sqrt(err / count);
+        /* a simpler class wins a tie */
+        if(best_rms < 0 || err < best_rms)
+        {
+            best = (enum ck_complexity)c;
+            best_rms = err;
+        }
+    }
+    if(rms != NULL)
+        *rms = best_rms;
+    return best;
+}
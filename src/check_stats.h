@@ -0,0 +1,93 @@
+/*
+ * Check: a unit test framework for C
+ * Copyright (C) 2001, 2002 Arien Malec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef CHECK_STATS_H
+#define CHECK_STATS_H
+
+/*
+ * Statistics of timing samples, for benchmarks.
+ */
+
+/* The most samples a benchmark takes; they have to fit in one message */
+#define BENCH_MAX_SAMPLES 500
+
+/* Write a time in nanoseconds to buf, in a unit that suits it */
+void stats_fmt_time(char *buf, size_t size, double ns);
+
+/* Sort n doubles in place, smallest first */
+void stats_sort(double *x, int n);
+
+/* The p-th percentile (0 to 100) of n sorted values, interpolating
+   between the closest two */
+double stats_percentile(const double *sorted, int n, double p);
+
+/* The one-sided p-value of the Mann-Whitney U test that the values of
+   b tend to be larger than those of a; both are sorted */
+double stats_mann_whitney(const double *a, int na, const double *b, int nb);
+
+#define STATS_BOOTSTRAP_RESAMPLES 1000
+/* A bootstrap confidence interval, at level percent, of the median of b
+   over the median of a, less one */
+void stats_bootstrap_ratio(const double *a, int na, const double *b, int nb,
+                           double level, double *lo, double *hi);
+
+/* The name of a complexity class, such as "O(n log n)" */
+const char *stats_complexity_name(enum ck_complexity c);
+/* The complexity class that fits count costs t measured at sizes n
+   best, as the one with the least root mean square of the errors of
+   t = c f(n) relative to each cost, which is stored in rms. Relative
+   errors weigh each size alike, so that the noise of the largest does
+   not decide */
+enum ck_complexity stats_fit_complexity(const double *n, const double *t,
+                                        int count, double *rms);
+
+/* Create a result from n samples, each the picoseconds taken by
+   iterations calls of the body, and work out its statistics. cpu_ps
+   are the CPU times of the same samples, or NULL if they are not
+   known */
+BenchResult *bench_result_create(int64_t iterations, const int64_t * ps,
+                                 const int64_t * cpu_ps, int n);
+/* The same from n samples in nanoseconds per call, allocated with
+   malloc(); the result takes them over. Their CPU times are not
+   known */
+BenchResult *bench_result_from_ns(int64_t iterations, double *ns, int n);
+
+void bench_result_free(BenchResult * br);
+
+#define BENCH_NSTATS 6
+/* the names the logs give the statistics of a benchmark, in the order
+   of enum ck_bench_stat */
+extern const char *const bench_stat_names[BENCH_NSTATS];
+/* store the statistics of br in values, in the order of
+   bench_stat_names */
+void bench_stat_values(const BenchResult * br, double *values);
+/* the same statistics of the CPU times of br, which must be known */
+void bench_cpu_stat_values(const BenchResult * br, double *values);
+
+/* The name of a test or benchmark in the benchmark and baseline files:
+   suite/tcase/test, followed by /iter unless iter is 0 */
+char *bench_name(const char *sname, const char *tcname, const char *tname,
+                 int iter);
+
+/* Describe the statistics of br in a line, as the message of a passed
+   benchmark */
+char *bench_summary(const BenchResult * br);
+
+#endif /* CHECK_STATS_H */
@@ -74,6 +74,24 @@ char *sr_stat_str(SRunner * sr)
     return str;
 }
 
+int ck_read_line(FILE * file, char **buf, size_t *size)
+{
+    size_t len = 0;
+
+    while(fgets(*buf + len, (int)(*size - len), file) != NULL)
+    {
+        len += strlen(*buf + len);
+        if(len > 0 && (*buf)[len - 1] == '\n')
+        {
+            (*buf)[len - 1] = '\0';
+            return 1;
+        }
+        *size *= 2;
+        *buf = (char *)erealloc(*buf, *size);
+    }
+    return len > 0;
+}
+
 char *ck_strdup_printf(const char *fmt, ...)
 {
     /* Guess we need no more than 100 bytes. */
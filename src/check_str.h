@@ -39,4 +39,8 @@ char *sr_stat_str(SRunner * sr);
 
 char *ck_strdup_printf(const char *fmt, ...);
 
+/* Read a line of file into *buf, of *size bytes, growing it as needed,
+   and strip its newline. Return 0 at the end of the file */
+int ck_read_line(FILE * file, char **buf, size_t *size);
+
 #endif /* CHECK_STR_H */
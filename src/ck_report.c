@@ -0,0 +1,342 @@
+/*
+ * Check: a unit test framework for C
+ * Copyright (C) 2001, 2002 Arien Malec
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * ck-report: convert the binary logs written for CK_BIN_LOG_FILE_NAME
+ * to the other log formats, merge them, or list the slowest tests.
+ */
+
+#include "../lib/libcompat.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <limits.h>
+
+#include "check.h"
+#include "check_error.h"
+#include "check_list.h"
+#include "check_impl.h"
+#include "check_binlog.h"
+#include "check_log.h"
+#include "check_print.h"
+
+static const char *progname = "ck-report";
+
+static void usage(FILE * file)
+{
+    fprintf(file,
+            "Usage: %s [-f FORMAT] [-o FILE] LOG...\n"
+            "       %s --slowest N LOG...\n"
+            "Convert the binary logs of Check test runs, in order, to one\n"
+            "log in another format.\n"
+            "\n"
+            "  -f FORMAT     text (the default), xml, tap, junit, jsonl,\n"
+            "                or bin to merge the logs into one binary log\n"
+            "  -o FILE       write to FILE instead of standard output\n"
+            "  --slowest N   list the N slowest tests, slowest first\n",
+            progname, progname);
+}
+
+static void die(const char *fmt, ...)
+{
+    va_list args;
+
+    fprintf(stderr, "%s: ", progname);
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fprintf(stderr, "\n");
+    exit(EXIT_FAILURE);
+}
+
+static BinLogReader *open_log(const char *fname)
+{
+    BinLogReader *r = binlog_reader_open(fname);
+
+    if(r == NULL)
+    {
+        if(errno != 0)
+            die("%s: %s", fname, strerror(errno));
+        die("%s: not a Check binary log", fname);
+    }
+    return r;
+}
+
+static void bad_log(BinLogReader * r)
+{
+    die("%s: truncated or corrupt binary log", r->fname);
+}
+
+/*
+ * Feed the results of the logs to an lfun, as if the tests had just
+ * been run. Each log is a run of its own, so a suite that continues
+ * from one log to the next is reported as two.
+ */
+static void replay(LFun lfun, FILE * out, char **fnames, int nfnames)
+{
+    SRunner *sr = srunner_create(NULL);
+    Suite *s = suite_create("");
+    void *data = NULL;
+    int i;
+
+    srunner_add_suite(sr, s);
+    lfun(sr, out, CK_NORMAL, NULL, CLINITLOG_SR, &data);
+    lfun(sr, out, CK_NORMAL, NULL, CLSTART_SR, &data);
+    for(i = 0; i < nfnames; i++)
+    {
+        BinLogReader *r = open_log(fnames[i]);
+        enum binlog_record rec;
+        int in_suite = 0;
+        char tname[100];
+
+        while((rec = binlog_read(r)) != BINLOG_END)
+        {
+            switch (rec)
+            {
+                case BINLOG_SUITE:
+                    if(in_suite)
+                        lfun(sr, out, CK_NORMAL, s, CLEND_S, &data);
+                    s->name = r->sname;
+                    lfun(sr, out, CK_NORMAL, s, CLSTART_S, &data);
+                    in_suite = 1;
+                    break;
+                case BINLOG_RESULT:
+                    sr->stats->n_checked++;
+                    if(r->tr.rtype == CK_FAILURE)
+                        sr->stats->n_failed++;
+                    else if(r->tr.rtype == CK_ERROR)
+                        sr->stats->n_errors++;
+                    snprintf(tname, sizeof(tname), "%s:%s", r->tr.tcname,
+                             r->tr.tname);
+                    lfun(sr, out, CK_NORMAL, tname, CLSTART_T, &data);
+                    lfun(sr, out, CK_NORMAL, &r->tr, CLEND_T, &data);
+                    break;
+                case BINLOG_END:
+                case BINLOG_BAD:
+                default:
+                    bad_log(r);
+            }
+        }
+        if(in_suite)
+            lfun(sr, out, CK_NORMAL, s, CLEND_S, &data);
+        /* the suite name points into the log */
+        s->name = "";
+        binlog_reader_close(r);
+    }
+    lfun(sr, out, CK_NORMAL, NULL, CLEND_SR, &data);
+    lfun(sr, out, CK_NORMAL, NULL, CLENDLOG_SR, &data);
+    srunner_free(sr);
+}
+
+static void merge(FILE * out, char **fnames, int nfnames)
+{
+    BinLogWriter *w = binlog_writer_create(out);
+    int i;
+
+    for(i = 0; i < nfnames; i++)
+    {
+        BinLogReader *r = open_log(fnames[i]);
+        enum binlog_record rec;
+
+        while((rec = binlog_read(r)) != BINLOG_END)
+        {
+            if(rec == BINLOG_SUITE)
+                binlog_write_suite(w, r->sname);
+            else if(rec == BINLOG_RESULT)
+                binlog_write_result(w, &r->tr);
+            else
+                bad_log(r);
+        }
+        binlog_reader_close(r);
+    }
+    binlog_writer_free(w);
+}
+
+typedef struct SlowTest
+{
+    int64_t duration;
+    const char *sname;
+    const char *tcname;
+    const char *tname;
+    int iter;
+} SlowTest;
+
+/*
+ * List the n slowest tests. The logs stay mapped until the end, so
+ * only the n slowest are kept, pointing into them. Their array grows
+ * with the results read, as n may be far more than there are.
+ */
+static void slowest(FILE * out, char **fnames, int nfnames, int n)
+{
+    BinLogReader **readers =
+        (BinLogReader **)emalloc(nfnames * sizeof(BinLogReader *));
+    SlowTest *slow = NULL;
+    size_t maxslow = 0;
+    int nslow = 0;
+    int i;
+
+    for(i = 0; i < nfnames; i++)
+    {
+        BinLogReader *r = readers[i] = open_log(fnames[i]);
+        enum binlog_record rec;
+
+        while((rec = binlog_read(r)) != BINLOG_END)
+        {
+            int lo, hi;
+
+            if(rec == BINLOG_SUITE)
+                continue;
+            if(rec != BINLOG_RESULT)
+                bad_log(r);
+            if(r->tr.duration < 0 ||
+               (nslow == n && r->tr.duration <= slow[n - 1].duration))
+                continue;
+
+            /* one more slot than kept, for the test dropped off the end */
+            if((size_t)nslow == maxslow)
+            {
+                maxslow = maxslow == 0 ? 64 : maxslow * 2;
+                if(maxslow > (size_t)n + 1)
+                    maxslow = (size_t)n + 1;
+                slow = (SlowTest *)erealloc(slow, maxslow * sizeof(SlowTest));
+            }
+
+            /* insert after the tests at least as slow */
+            for(lo = 0, hi = nslow; lo < hi;)
+            {
+                int mid = (lo + hi) / 2;
+
+                if(slow[mid].duration >= r->tr.duration)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            memmove(&slow[lo + 1], &slow[lo], (nslow - lo) * sizeof(SlowTest));
+            slow[lo].duration = r->tr.duration;
+            slow[lo].sname = r->sname;
+            slow[lo].tcname = r->tr.tcname;
+            slow[lo].tname = r->tr.tname;
+            slow[lo].iter = r->tr.iter;
+            if(nslow < n)
+                nslow++;
+        }
+    }
+
+    for(i = 0; i < nslow; i++)
+    {
+        fprint_seconds(out, slow[i].duration, 9);
+        fprintf(out, " %s:%s:%s:%d\n", slow[i].sname, slow[i].tcname,
+                slow[i].tname, slow[i].iter);
+    }
+
+    for(i = 0; i < nfnames; i++)
+        binlog_reader_close(readers[i]);
+    free(readers);
+    free(slow);
+}
+
+int main(int argc, char **argv)
+{
+    const char *format = "text";
+    const char *oname = NULL;
+    int nslowest = -1;
+    LFun lfun = NULL;
+    FILE *out = stdout;
+    int i;
+
+    for(i = 1; i < argc && argv[i][0] == '-'; i++)
+    {
+        if(strcmp(argv[i], "--") == 0)
+        {
+            i++;
+            break;
+        }
+        if(strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
+        {
+            usage(stdout);
+            return EXIT_SUCCESS;
+        }
+        if(i + 1 == argc)
+        {
+            usage(stderr);
+            return EXIT_FAILURE;
+        }
+        if(strcmp(argv[i], "-f") == 0)
+            format = argv[++i];
+        else if(strcmp(argv[i], "-o") == 0)
+            oname = argv[++i];
+        else if(strcmp(argv[i], "--slowest") == 0)
+        {
+            char *end;
+            long val;
+
+            errno = 0;
+            val = strtol(argv[++i], &end, 10);
+            if(end == argv[i] || *end != '\0' || errno == ERANGE ||
+               val <= 0 || val > INT_MAX)
+                die("bad number of tests: %s", argv[i]);
+            nslowest = (int)val;
+        }
+        else
+        {
+            usage(stderr);
+            return EXIT_FAILURE;
+        }
+    }
+    if(i == argc)
+    {
+        usage(stderr);
+        return EXIT_FAILURE;
+    }
+
+    if(strcmp(format, "text") == 0)
+        lfun = lfile_lfun;
+    else if(strcmp(format, "xml") == 0)
+        lfun = xml_lfun;
+    else if(strcmp(format, "tap") == 0)
+        lfun = tap_lfun;
+    else if(strcmp(format, "junit") == 0)
+        lfun = junit_lfun;
+    else if(strcmp(format, "jsonl") == 0)
+        lfun = jsonl_lfun;
+    else if(strcmp(format, "bin") != 0)
+        die("unknown format: %s", format);
+
+    if(oname != NULL && strcmp(oname, "-") != 0)
+    {
+        out = fopen(oname, lfun == NULL ? "wb" : "w");
+        if(out == NULL)
+            die("%s: %s", oname, strerror(errno));
+    }
+
+    if(nslowest > 0)
+        slowest(out, argv + i, argc - i, nslowest);
+    else if(lfun != NULL)
+        replay(lfun, out, argv + i, argc - i);
+    else
+        merge(out, argv + i, argc - i);
+
+    if(fclose(out) != 0)
+        die("%s", strerror(errno));
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,174 @@
+#include "../lib/libcompat.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "check.h"
+#include "check_arena.h"
+#include "check_check.h"
+
+START_TEST(test_arena_alloc)
+{
+  Arena *a = arena_create();
+  char *p1 = (char *) arena_alloc(a, 3);
+  char *p2 = (char *) arena_alloc(a, 5);
+  double *d = (double *) arena_alloc(a, sizeof(double));
+
+  ck_assert_ptr_ne(p1, NULL);
+  ck_assert_ptr_ne(p2, NULL);
+  ck_assert_msg(p2 >= p1 + 3, "Allocations should not overlap");
+  ck_assert_msg(((size_t) d) % sizeof(double) == 0,
+                "Allocations should be aligned");
+  memset(p1, 'a', 3);
+  memset(p2, 'b', 5);
+  *d = 1.5;
+  ck_assert_int_eq(p1[2], 'a');
+  ck_assert_int_eq(p2[0], 'b');
+  arena_free(a);
+}
+END_TEST
+
+START_TEST(test_arena_many)
+{
+  Arena *a = arena_create();
+  int *ps[1000];
+  int i;
+
+  /* enough to need several chunks, and one too big for any */
+  for (i = 0; i < 1000; i++) {
+    ps[i] = (int *) arena_alloc(a, 100 * sizeof(int));
+    ps[i][0] = i;
+    ps[i][99] = i;
+  }
+  memset(arena_alloc(a, 4 * 1024 * 1024), 0, 4 * 1024 * 1024);
+  for (i = 0; i < 1000; i++) {
+    ck_assert_int_eq(ps[i][0], i);
+    ck_assert_int_eq(ps[i][99], i);
+  }
+  arena_free(a);
+}
+END_TEST
+
+START_TEST(test_arena_strdup)
+{
+  Arena *a = arena_create();
+  char str[] = "abc";
+  char *copy = arena_strdup(a, str);
+
+  ck_assert_ptr_ne(copy, str);
+  ck_assert_str_eq(copy, "abc");
+  ck_assert_str_eq(arena_strdup(a, ""), "");
+  arena_free(a);
+}
+END_TEST
+
+START_TEST(test_strtab_intern)
+{
+  Arena *a = arena_create();
+  StrTable *t = strtab_create(a);
+  char abc[] = "abc";
+  const char *p;
+  char name[32];
+  int i;
+
+  p = strtab_intern(t, abc);
+  ck_assert_ptr_ne(p, abc);
+  ck_assert_str_eq(p, "abc");
+  ck_assert_ptr_eq(strtab_intern(t, "abc"), p);
+  ck_assert_ptr_ne(strtab_intern(t, "abd"), p);
+  ck_assert_ptr_eq(strtab_intern(t, NULL), NULL);
+
+  /* the table has to grow, and still find what it had */
+  for (i = 0; i < 1000; i++) {
+    snprintf(name, sizeof(name), "file%d.c", i);
+    ck_assert_str_eq(strtab_intern(t, name), name);
+  }
+  ck_assert_ptr_eq(strtab_intern(t, "abc"), p);
+  ck_assert_ptr_eq(strtab_intern(t, "file10.c"), strtab_intern(t, "file10.c"));
+  strtab_free(t);
+  arena_free(a);
+}
+END_TEST
+
+START_TEST(test_arena_reset)
+{
+  Arena *a = arena_create();
+  unsigned long saved;
+  char *p;
+  int i;
+
+  /* a reset keeps one chunk big enough for all that was allocated */
+  for (i = 0; i < 100; i++)
+    memset(arena_alloc(a, 1000), 'x', 1000);
+  arena_reset(a);
+  saved = arena_allocs_saved(a);
+  p = (char *) arena_alloc(a, 1000);
+  for (i = 1; i < 100; i++)
+    memset(arena_alloc(a, 1000), 'y', 1000);
+  ck_assert_int_eq(arena_allocs_saved(a), saved + 100);
+  memset(p, 'y', 1000);
+  arena_reset(a);
+  arena_reset(a);
+  ck_assert_int_eq(arena_allocs_saved(a), saved + 100);
+  arena_free(a);
+}
+END_TEST
+
+START_TEST(test_arena_allocs_saved)
+{
+  Arena *a = arena_create();
+  int i;
+
+  ck_assert_int_eq(arena_allocs_saved(a), 0);
+  arena_alloc(a, 8);
+  ck_assert_int_eq(arena_allocs_saved(a), 0);
+  for (i = 0; i < 10; i++)
+    arena_alloc(a, 8);
+  ck_assert_int_eq(arena_allocs_saved(a), 10);
+  arena_free(a);
+}
+END_TEST
+
+START_TEST(test_arena_dummy)
+{
+  ck_assert_int_eq(_i, _i);
+}
+END_TEST
+
+START_TEST(test_srunner_allocs_saved)
+{
+  Suite *s = suite_create("Arena");
+  TCase *tc = tcase_create("Arena");
+  SRunner *sr;
+  int saved;
+
+  suite_add_tcase(s, tc);
+  tcase_add_loop_test(tc, test_arena_dummy, 0, 10);
+  sr = srunner_create(s);
+  srunner_set_fork_status(sr, CK_NOFORK);
+  saved = srunner_allocs_saved(sr);
+  ck_assert_int_ge(saved, 0);
+  srunner_run_all(sr, CK_SILENT);
+  ck_assert_int_eq(srunner_ntests_run(sr), 10);
+  /* at least the results and the messages of each test */
+  ck_assert_int_ge(srunner_allocs_saved(sr), saved + 20);
+  srunner_free(sr);
+}
+END_TEST
+
+Suite *make_arena_suite (void)
+{
+  Suite *s = suite_create("Arenas");
+  TCase * tc = tcase_create("Core");
+
+  suite_add_tcase (s, tc);
+  tcase_add_test (tc, test_arena_alloc);
+  tcase_add_test (tc, test_arena_many);
+  tcase_add_test (tc, test_arena_strdup);
+  tcase_add_test (tc, test_strtab_intern);
+  tcase_add_test (tc, test_arena_reset);
+  tcase_add_test (tc, test_arena_allocs_saved);
+  tcase_add_test (tc, test_srunner_allocs_saved);
+
+  return s;
+}
@@ -0,0 +1,530 @@
+#include "../lib/libcompat.h"
+
+/* Benchmarks of the overhead Check itself adds. This is not a test
+   and is not part of TESTS in Makefile.am; run it by hand to compare
+   changes to the library:
+
+     check_bench [FILE]
+
+   The results are written to FILE, or to standard output, as JSON in
+   the format of Google Benchmark, the same as CK_BENCH_JSON, so two
+   runs can be compared with its tools. Times are in nanoseconds per
+   operation. */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#if defined(HAVE_SYS_RESOURCE_H)
+#include <sys/resource.h>
+#endif
+#include <check.h>
+#include <check_arena.h>
+#include <check_list.h>
+#include <check_impl.h>
+#include <check_log.h>
+#include <check_pack.h>
+#include <check_print.h>
+
+#ifdef _WIN32
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+
+/* assertions timed in one test */
+#define NASSERTS 1000000
+/* failing tests, each failing on its only assertion */
+#define NFAILS 10000
+/* tests in a run in nofork and fork mode */
+#define NTESTS_NOFORK 100000
+#define NTESTS_FORK 2000
+/* messages packed and unpacked */
+#define NMSGS 1000000
+/* results written by each reporter */
+#define NRESULTS 100000
+/* tests added to a suite */
+#define NSUITE_TESTS 1000000
+
+static FILE *json;
+static int nbenches;
+
+static int64_t now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(check_get_clockid(), &ts);
+  return (int64_t) ts.tv_sec * NANOS_PER_SECONDS + ts.tv_nsec;
+}
+
+static FILE *open_null(void)
+{
+  FILE *f = fopen(NULL_DEVICE, "w");
+
+  if (f == NULL) {
+    fprintf(stderr, "Could not open %s\n", NULL_DEVICE);
+    exit(1);
+  }
+  return f;
+}
+
+/* The CPU time of the process and of the test processes it reaped, or
+   -1 if it is not known */
+static int64_t cpu_ns(void)
+{
+#if defined(HAVE_SYS_RESOURCE_H) && defined(HAVE_GETRUSAGE)
+  struct rusage self, children;
+
+  if (getrusage(RUSAGE_SELF, &self) == 0 &&
+      getrusage(RUSAGE_CHILDREN, &children) == 0)
+    return TIMEVAL_IN_NSEC(self.ru_utime) + TIMEVAL_IN_NSEC(self.ru_stime) +
+      TIMEVAL_IN_NSEC(children.ru_utime) +
+      TIMEVAL_IN_NSEC(children.ru_stime);
+#endif
+  return -1;
+}
+
+/* The CPU time taken since cpu_ns() was start, or -1 if it is not
+   known */
+static int64_t cpu_since(int64_t start)
+{
+  return start >= 0 ? cpu_ns() - start : -1;
+}
+
+/* The CPU time of a test, or -1 if it is not known */
+static int64_t tr_cpu_ns(TestResult * tr)
+{
+  if (tr_utime_ns(tr) < 0 || tr_stime_ns(tr) < 0)
+    return -1;
+  return tr_utime_ns(tr) + tr_stime_ns(tr);
+}
+
+/* Write a result of ns nanoseconds, cpu of them in CPU time (-1 if not
+   known), for iterations operations, with a rate named counter if it is
+   not NULL */
+static void report(const char *name, int64_t iterations, int64_t ns,
+                   int64_t cpu, const char *counter, double rate)
+{
+  double per_op = iterations > 0 ? (double) ns / iterations : 0;
+  double cpu_per_op = iterations > 0 && cpu >= 0 ?
+    (double) cpu / iterations : -1;
+
+  gbench_fprint_run(json, name, iterations, per_op, cpu_per_op, counter,
+                    rate, nbenches++ == 0);
+  fflush(json);
+}
+
+/* A rate per second of n things done in ns nanoseconds */
+static double per_second(double n, int64_t ns)
+{
+  return ns > 0 ? n * NANOS_PER_SECONDS / ns : 0;
+}
+
+START_TEST(test_asserts)
+{
+  int i;
+
+  for (i = 0; i < NASSERTS; i++)
+    ck_assert_int_eq(i, i);
+}
+END_TEST
+
+START_TEST(test_empty)
+{
+}
+END_TEST
+
+START_TEST(test_fail)
+{
+  ck_assert_int_eq(_i, -1);
+}
+END_TEST
+
+static void fixture_empty(void)
+{
+}
+
+/* A runner of n copies of tfun, in a loop test, in mode fstat */
+static SRunner *make_runner(TFun tfun, int n, enum fork_status fstat,
+                            int fixture)
+{
+  Suite *s = suite_create("Bench");
+  TCase *tc = tcase_create("Bench");
+  SRunner *sr;
+
+  suite_add_tcase(s, tc);
+  tcase_add_loop_test(tc, tfun, 0, n);
+  if (fixture)
+    tcase_add_checked_fixture(tc, fixture_empty, fixture_empty);
+  sr = srunner_create(s);
+  srunner_set_fork_status(sr, fstat);
+  return sr;
+}
+
+/* The cost of a passing assertion, from the duration of a test doing
+   nothing else */
+static void bench_assert_pass(const char *name, enum fork_status fstat)
+{
+  SRunner *sr = make_runner(test_asserts, 1, fstat, 0);
+  TestResult **trs;
+
+  srunner_run_all(sr, CK_SILENT);
+  trs = srunner_results(sr);
+  report(name, NASSERTS, tr_duration_ns(trs[0]), tr_cpu_ns(trs[0]), NULL,
+         0);
+  free(trs);
+  srunner_free(sr);
+}
+
+/* The cost of a failing assertion. In nofork mode the duration of a
+   failed test runs up to the return from the failure; in fork mode
+   the process of the test ends there, so this is nofork only */
+static void bench_assert_fail(void)
+{
+  SRunner *sr = make_runner(test_fail, NFAILS, CK_NOFORK, 0);
+  TestResult **trs;
+  int64_t ns = 0;
+  int64_t cpu = 0;
+  int i;
+
+  srunner_run_all(sr, CK_SILENT);
+  trs = srunner_results(sr);
+  for (i = 0; i < NFAILS; i++) {
+    ns += tr_duration_ns(trs[i]);
+    if (cpu >= 0)
+      cpu = tr_cpu_ns(trs[i]) >= 0 ? cpu + tr_cpu_ns(trs[i]) : -1;
+  }
+  report("assert_fail/nofork", NFAILS, ns, cpu, NULL, 0);
+  free(trs);
+  srunner_free(sr);
+}
+
+/* The cost of running an empty test, and of the checked fixtures of
+   one, from the phase times of the run */
+static void bench_tests(const char *mode, enum fork_status fstat, int n)
+{
+  SRunner *sr = make_runner(test_empty, n, fstat, 0);
+  char name[64];
+  int64_t start, ns, cpu_start, cpu;
+
+  start = now_ns();
+  cpu_start = cpu_ns();
+  srunner_run_all(sr, CK_SILENT);
+  ns = now_ns() - start;
+  cpu = cpu_since(cpu_start);
+  snprintf(name, sizeof(name), "test/%s", mode);
+  report(name, n, ns, cpu, "items_per_second", per_second(n, ns));
+  srunner_free(sr);
+
+  sr = make_runner(test_empty, n, fstat, 1);
+  srunner_run_all(sr, CK_SILENT);
+  ns = srunner_phase_ns(sr, CK_PHASE_SETUP) +
+    srunner_phase_ns(sr, CK_PHASE_TEARDOWN);
+  snprintf(name, sizeof(name), "checked_fixture/%s", mode);
+  report(name, n, ns, -1, NULL, 0);
+  srunner_free(sr);
+}
+
+/* Packing a message and unpacking it again */
+static void bench_pack_one(const char *name, enum ck_msg_type type,
+                           CheckMsg * msg)
+{
+  CheckMsg out;
+  enum ck_msg_type out_type;
+  int64_t start, ns, cpu_start, cpu;
+  size_t bytes = 0;
+  char *buf;
+  int i;
+
+  start = now_ns();
+  cpu_start = cpu_ns();
+  for (i = 0; i < NMSGS; i++) {
+    bytes += pack(type, &buf, msg);
+    upack(buf, &out, &out_type);
+    free(buf);
+    if (type == CK_MSG_FAIL)
+      free(out.fail_msg.msg);
+    else if (type == CK_MSG_LOC)
+      free(out.loc_msg.file);
+  }
+  ns = now_ns() - start;
+  cpu = cpu_since(cpu_start);
+  report(name, NMSGS, ns, cpu, "bytes_per_second", per_second(bytes, ns));
+}
+
+/* Sending the messages of a test to a file and reading them back, as
+   the runner does */
+static void bench_pack_stream(void)
+{
+  FILE *f = tmpfile();
+  Arena *a = arena_create();
+  CtxMsg cmsg;
+  LocMsg lmsg;
+  FailMsg fmsg;
+  int64_t start, ns, cpu_start, cpu;
+  int i;
+
+  if (f == NULL) {
+    fprintf(stderr, "Could not create a temporary file\n");
+    exit(1);
+  }
+  lmsg.file = (char *) "tests/check_bench.c";
+  fmsg.msg = (char *) "Assertion 'x == y' failed: x == 1, y == 2";
+  cmsg.ctx = CK_CTX_TEST;
+  start = now_ns();
+  cpu_start = cpu_ns();
+  ppack(f, CK_MSG_CTX, (CheckMsg *) & cmsg);
+  for (i = 0; i < NMSGS; i++) {
+    lmsg.line = i;
+    ppack(f, CK_MSG_LOC, (CheckMsg *) & lmsg);
+  }
+  ppack(f, CK_MSG_FAIL, (CheckMsg *) & fmsg);
+  rewind(f);
+  if (punpack(f, a) == NULL) {
+    fprintf(stderr, "No messages read back\n");
+    exit(1);
+  }
+  ns = now_ns() - start;
+  cpu = cpu_since(cpu_start);
+  report("pack/stream", NMSGS + 2, ns, cpu, "items_per_second",
+         per_second(NMSGS + 2, ns));
+  arena_free(a);
+  fclose(f);
+}
+
+static void bench_pack(void)
+{
+  LocMsg lmsg;
+  FailMsg fmsg;
+  DurationMsg dmsg;
+
+  lmsg.file = (char *) "tests/check_bench.c";
+  lmsg.line = 42;
+  bench_pack_one("pack/loc", CK_MSG_LOC, (CheckMsg *) & lmsg);
+  fmsg.msg = (char *) "Assertion 'x == y' failed: x == 1, y == 2";
+  bench_pack_one("pack/fail", CK_MSG_FAIL, (CheckMsg *) & fmsg);
+  dmsg.duration = 1000;
+  dmsg.setup = dmsg.teardown = 10;
+  dmsg.end = now_ns();
+  bench_pack_one("pack/duration", CK_MSG_DURATION, (CheckMsg *) & dmsg);
+  bench_pack_stream();
+}
+
+/* Feed NRESULTS results to an lfun, one in ten of them a failure */
+static void bench_report_one(const char *name, LFun lfun)
+{
+  SRunner *sr = srunner_create(NULL);
+  Suite *s = suite_create("Bench");
+  TestResult *pass = tr_create();
+  TestResult *failure = tr_create();
+  FILE *out = open_null();
+  void *data = NULL;
+  int64_t start, ns, cpu_start, cpu;
+  int i;
+
+  srunner_add_suite(sr, s);
+  pass->rtype = CK_PASS;
+  pass->ctx = CK_CTX_TEST;
+  pass->file = "tests/check_bench.c";
+  pass->line = 42;
+  pass->tcname = "Bench";
+  pass->tname = "test_bench";
+  pass->msg = tr_pass_msg();
+  pass->duration = 1234;
+  *failure = *pass;
+  failure->rtype = CK_FAILURE;
+  failure->msg = (char *) "Assertion 'x == y' failed: x == 1, y == 2";
+
+  start = now_ns();
+  cpu_start = cpu_ns();
+  lfun(sr, out, CK_NORMAL, NULL, CLINITLOG_SR, &data);
+  lfun(sr, out, CK_NORMAL, NULL, CLSTART_SR, &data);
+  lfun(sr, out, CK_NORMAL, s, CLSTART_S, &data);
+  for (i = 0; i < NRESULTS; i++) {
+    TestResult *tr = i % 10 == 9 ? failure : pass;
+
+    tr->iter = i;
+    lfun(sr, out, CK_NORMAL, (void *) "Bench:test_bench", CLSTART_T, &data);
+    lfun(sr, out, CK_NORMAL, tr, CLEND_T, &data);
+  }
+  lfun(sr, out, CK_NORMAL, s, CLEND_S, &data);
+  lfun(sr, out, CK_NORMAL, NULL, CLEND_SR, &data);
+  lfun(sr, out, CK_NORMAL, NULL, CLENDLOG_SR, &data);
+  fflush(out);
+  ns = now_ns() - start;
+  cpu = cpu_since(cpu_start);
+  report(name, NRESULTS, ns, cpu, "items_per_second",
+         per_second(NRESULTS, ns));
+
+  fclose(out);
+  /* the strings are not theirs */
+  pass->file = failure->file = NULL;
+  failure->msg = NULL;
+  tr_free(pass);
+  tr_free(failure);
+  srunner_free(sr);
+}
+
+static void bench_report(void)
+{
+  bench_report_one("report/text", lfile_lfun);
+  bench_report_one("report/xml", xml_lfun);
+  bench_report_one("report/tap", tap_lfun);
+  bench_report_one("report/junit", junit_lfun);
+  bench_report_one("report/jsonl", jsonl_lfun);
+  bench_report_one("report/bin", bin_lfun);
+}
+
+/* Building a suite of NSUITE_TESTS tests and freeing it */
+static void bench_suite(void)
+{
+  Suite *s;
+  TCase *tc;
+  SRunner *sr;
+  int64_t start, ns, cpu_start, cpu;
+  int i;
+
+  start = now_ns();
+  cpu_start = cpu_ns();
+  s = suite_create("Bench");
+  tc = tcase_create("Bench");
+  suite_add_tcase(s, tc);
+  for (i = 0; i < NSUITE_TESTS; i++)
+    tcase_add_test(tc, test_empty);
+  sr = srunner_create(s);
+  ns = now_ns() - start;
+  cpu = cpu_since(cpu_start);
+  report("suite/build", NSUITE_TESTS, ns, cpu, "items_per_second",
+         per_second(NSUITE_TESTS, ns));
+
+  start = now_ns();
+  cpu_start = cpu_ns();
+  srunner_free(sr);
+  ns = now_ns() - start;
+  cpu = cpu_since(cpu_start);
+  report("suite/free", NSUITE_TESTS, ns, cpu, "items_per_second",
+         per_second(NSUITE_TESTS, ns));
+}
+
+/* The XML escaping Check used to do, one character at a time */
+static void bytewise_xml_esc(FILE * file, const char *str)
+{
+  for (; *str != '\0'; str++) {
+    switch (*str) {
+    case '"':
+      fputs("&quot;", file);
+      break;
+    case '\'':
+      fputs("&apos;", file);
+      break;
+    case '<':
+      fputs("&lt;", file);
+      break;
+    case '>':
+      fputs("&gt;", file);
+      break;
+    case '&':
+      fputs("&amp;", file);
+      break;
+    default:
+      fputc(*str, file);
+      break;
+    }
+  }
+}
+
+/* A failure message of len bytes, with a character to escape every
+   'every' bytes (never if 0) */
+static char *make_message(size_t len, size_t every)
+{
+  static const char text[] =
+    "expected value did not match actual value at index ";
+  char *msg = (char *) malloc(len + 1);
+  size_t i;
+
+  if (msg == NULL) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+  }
+  for (i = 0; i < len; i++) {
+    msg[i] = text[i % (sizeof(text) - 1)];
+    if (every != 0 && i % every == every - 1)
+      msg[i] = "<>&\"'"[(i / every) % 5];
+  }
+  msg[len] = '\0';
+  return msg;
+}
+
+static void bench_xml_esc_one(FILE * out, const char *name,
+                              void (*esc) (FILE *, const char *),
+                              size_t len, size_t every)
+{
+  char *msg = make_message(len, every);
+  char bname[64];
+  int reps = 20;
+  int64_t start, ns, cpu_start, cpu;
+  int i;
+
+  start = now_ns();
+  cpu_start = cpu_ns();
+  for (i = 0; i < reps; i++)
+    esc(out, msg);
+  fflush(out);
+  ns = now_ns() - start;
+  cpu = cpu_since(cpu_start);
+
+  snprintf(bname, sizeof(bname), "xml_esc/%s/%luMiB/every_%lu", name,
+           (unsigned long) (len >> 20), (unsigned long) every);
+  report(bname, reps, ns, cpu, "bytes_per_second",
+         per_second((double) len * reps, ns));
+  free(msg);
+}
+
+static void bench_xml_esc(void)
+{
+  static const size_t lens[] = { 1 << 20, 16 << 20 };
+  static const size_t everies[] = { 0, 1000, 10 };
+  FILE *out = open_null();
+  unsigned int i, j;
+
+  for (i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+    for (j = 0; j < sizeof(everies) / sizeof(everies[0]); j++) {
+      bench_xml_esc_one(out, "bytewise", bytewise_xml_esc, lens[i],
+                        everies[j]);
+      bench_xml_esc_one(out, "check", fprint_xml_esc, lens[i], everies[j]);
+    }
+  }
+  fclose(out);
+}
+
+int main(int argc, char **argv)
+{
+  json = stdout;
+  if (argc > 1 && strcmp(argv[1], "-") != 0) {
+    json = fopen(argv[1], "w");
+    if (json == NULL) {
+      fprintf(stderr, "Could not open %s\n", argv[1]);
+      return 1;
+    }
+  }
+
+  gbench_fprint_start(json);
+  bench_assert_pass("assert_pass/nofork", CK_NOFORK);
+#if defined(HAVE_FORK) && HAVE_FORK==1
+  bench_assert_pass("assert_pass/fork", CK_FORK);
+#endif
+  bench_assert_fail();
+  bench_tests("nofork", CK_NOFORK, NTESTS_NOFORK);
+#if defined(HAVE_FORK) && HAVE_FORK==1
+  bench_tests("fork", CK_FORK, NTESTS_FORK);
+#endif
+  bench_pack();
+  bench_report();
+  bench_suite();
+  bench_xml_esc();
+  gbench_fprint_end(json);
+
+  if (json != stdout)
+    fclose(json);
+  return 0;
+}
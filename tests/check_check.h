@@ -26,9 +26,18 @@ Suite *make_sub_suite(void);
 Suite *make_sub2_suite(void);
 Suite *make_master_suite(void);
 Suite *make_list_suite(void);
+Suite *make_arena_suite(void);
+Suite *make_stats_suite(void);
 Suite *make_msg_suite(void);
 Suite *make_log_suite(void);
 Suite *make_log_internal_suite(void);
+Suite *make_streaming_suite(void);
+Suite *make_times_suite(void);
+Suite *make_perf_suite(void);
+Suite *make_bench_suite(void);
+Suite *make_alloc_suite(void);
+Suite *make_phases_suite(void);
+Suite *make_rusage_suite(void);
 Suite *make_limit_suite(void);
 Suite *make_fork_suite(void);
 Suite *make_fixture_suite(void);
@@ -36,6 +45,20 @@ Suite *make_pack_suite(void);
 Suite *make_exit_suite(void);
 Suite *make_selective_suite(void);
 
+/* The fork statuses of this platform, for loop tests that run a
+   runner in each: tcase_add_loop_test(tc, test, 0, nfork_statuses) */
+extern const enum fork_status fork_statuses[];
+extern const int nfork_statuses;
+
+#if HAVE_DECL_SETENV
+/* save environment variable's value and set new value */
+int save_set_env(const char *name, const char *value,
+                 const char **old_value);
+/* restore environment variable's old value, unsetting it if the old
+   value is NULL */
+int restore_env(const char *name, const char *old_value);
+#endif /* HAVE_DECL_SETENV */
+
 extern int master_tests_lineno[];
 void init_master_tests_lineno(int num_master_tests);
 
@@ -0,0 +1,313 @@
+#include "../lib/libcompat.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include "check_check.h"
+
+START_TEST(test_alloc_tracking_set)
+{
+  SRunner *sr = srunner_create(NULL);
+
+  ck_assert_int_eq(srunner_alloc_tracking(sr), 0);
+  srunner_set_alloc_tracking(sr, 1);
+  ck_assert_int_eq(srunner_alloc_tracking(sr), 1);
+  ck_assert_int_eq(srunner_alloc_limit(sr, CK_ALLOC_LEAKS), 0);
+  ck_assert_int_eq(srunner_alloc_limit(sr, CK_ALLOC_COUNT), -1);
+  srunner_set_alloc_limit(sr, CK_ALLOC_LEAKS, -1);
+  srunner_set_alloc_limit(sr, CK_ALLOC_PEAK_BYTES, 4096);
+  ck_assert_int_eq(srunner_alloc_limit(sr, CK_ALLOC_LEAKS), -1);
+  ck_assert_int_eq(srunner_alloc_limit(sr, CK_ALLOC_PEAK_BYTES), 4096);
+  srunner_free(sr);
+}
+END_TEST
+
+#if HAVE_DECL_SETENV
+START_TEST(test_alloc_tracking_env)
+{
+  const char *old_tracking, *old_limits;
+  SRunner *sr = srunner_create(NULL);
+
+  ck_assert_msg(save_set_env("CK_ALLOC_TRACKING", "yes", &old_tracking) == 0,
+                "Failed to set environment variable");
+  ck_assert_msg(save_set_env("CK_ALLOC_LIMITS", "bytes=100,leaks=2,peak=x",
+                             &old_limits) == 0,
+                "Failed to set environment variable");
+  ck_assert_int_eq(srunner_alloc_tracking(sr), 1);
+  ck_assert_int_eq(srunner_alloc_limit(sr, CK_ALLOC_BYTES), 100);
+  ck_assert_int_eq(srunner_alloc_limit(sr, CK_ALLOC_LEAKS), 2);
+  ck_assert_int_eq(srunner_alloc_limit(sr, CK_ALLOC_PEAK_BYTES), -1);
+  ck_assert_int_eq(srunner_alloc_limit(sr, CK_ALLOC_LEAKED_BYTES), -1);
+  srunner_set_alloc_tracking(sr, 0);
+  srunner_set_alloc_limit(sr, CK_ALLOC_LEAKS, 0);
+  ck_assert_int_eq(srunner_alloc_tracking(sr), 0);
+  ck_assert_int_eq(srunner_alloc_limit(sr, CK_ALLOC_LEAKS), 0);
+  ck_assert_msg(restore_env("CK_ALLOC_TRACKING", old_tracking) == 0,
+                "Failed to restore environment variable");
+  ck_assert_msg(restore_env("CK_ALLOC_LIMITS", old_limits) == 0,
+                "Failed to restore environment variable");
+  srunner_free(sr);
+}
+END_TEST
+#endif /* HAVE_DECL_SETENV */
+
+#if defined(HAVE_FORK) && HAVE_FORK==1
+static char *fixture_block;
+
+static void alloc_setup(void)
+{
+  fixture_block = (char *) malloc(1000);
+}
+
+static void alloc_teardown(void)
+{
+  free(fixture_block);
+}
+
+START_TEST(test_alloc_balanced)
+{
+  char *p = (char *) malloc(100);
+
+  ck_assert_ptr_ne(p, NULL);
+  p = (char *) realloc(p, 200);
+  ck_assert_ptr_ne(p, NULL);
+  free(p);
+  ck_assert_ptr_ne(fixture_block, NULL);
+}
+END_TEST
+
+START_TEST(test_alloc_leaky)
+{
+  void *p = calloc(8, 8);
+
+  ck_assert_ptr_ne(p, NULL);
+}
+END_TEST
+
+#if defined(HAVE___LIBC_MALLOC)
+/* kept where the compiler cannot see the blocks are unused */
+static void *volatile aligned_block;
+
+/* leaks the last of its aligned blocks */
+START_TEST(test_alloc_aligned)
+{
+  void *p;
+
+  ck_assert_int_eq(posix_memalign(&p, 64, 100), 0);
+  aligned_block = p;
+  free(aligned_block);
+  aligned_block = aligned_alloc(64, 128);
+  ck_assert_ptr_ne(aligned_block, NULL);
+  free(aligned_block);
+  ck_assert_int_eq(posix_memalign(&p, 64, 32), 0);
+  aligned_block = p;
+}
+END_TEST
+#endif /* HAVE___LIBC_MALLOC */
+
+START_TEST(test_alloc_tracking_fork)
+{
+  Suite *s = suite_create("Allocs");
+  TCase *tc = tcase_create("Core");
+  SRunner *sr;
+  TestResult **trs;
+  int nfirst;
+
+  suite_add_tcase(s, tc);
+  tcase_add_checked_fixture(tc, alloc_setup, alloc_teardown);
+  tcase_add_test(tc, test_alloc_balanced);
+  tcase_add_test(tc, test_alloc_leaky);
+#if defined(HAVE___LIBC_MALLOC)
+  tcase_add_test(tc, test_alloc_aligned);
+#endif /* HAVE___LIBC_MALLOC */
+  sr = srunner_create(s);
+  srunner_set_fork_status(sr, CK_FORK);
+  srunner_set_alloc_tracking(sr, 1);
+  srunner_run_all(sr, CK_SILENT);
+  nfirst = srunner_ntests_run(sr);
+
+  trs = srunner_results(sr);
+#if defined(HAVE___LIBC_MALLOC)
+  ck_assert_msg(tr_rtype(trs[0]) == CK_PASS, "Unexpected failure: %s",
+                tr_msg(trs[0]));
+  /* the fixture, malloc() and realloc() */
+  ck_assert_int_eq(tr_alloc_stat(trs[0], CK_ALLOC_COUNT), 3);
+  ck_assert_int_eq(tr_alloc_stat(trs[0], CK_ALLOC_BYTES), 1300);
+  ck_assert_int_eq(tr_alloc_stat(trs[0], CK_ALLOC_PEAK_BYTES), 1200);
+  ck_assert_int_eq(tr_alloc_stat(trs[0], CK_ALLOC_LEAKS), 0);
+  ck_assert_int_eq(tr_alloc_stat(trs[0], CK_ALLOC_LEAKED_BYTES), 0);
+
+  ck_assert_int_eq(tr_rtype(trs[1]), CK_FAILURE);
+  ck_assert_int_eq(tr_alloc_stat(trs[1], CK_ALLOC_LEAKS), 1);
+  ck_assert_int_eq(tr_alloc_stat(trs[1], CK_ALLOC_LEAKED_BYTES), 64);
+  ck_assert_str_eq(tr_msg(trs[1]), "Over the allocation limit of leaks 0: "
+                   "2 allocs of 1064 bytes, peak 1064 bytes, "
+                   "1 leaks of 64 bytes");
+
+  /* the fixture and the aligned allocations */
+  ck_assert_int_eq(tr_rtype(trs[2]), CK_FAILURE);
+  ck_assert_int_eq(tr_alloc_stat(trs[2], CK_ALLOC_COUNT), 4);
+  ck_assert_int_eq(tr_alloc_stat(trs[2], CK_ALLOC_BYTES), 1260);
+  ck_assert_int_eq(tr_alloc_stat(trs[2], CK_ALLOC_LEAKS), 1);
+  ck_assert_int_eq(tr_alloc_stat(trs[2], CK_ALLOC_LEAKED_BYTES), 32);
+#else
+  ck_assert_int_eq(tr_rtype(trs[1]), CK_PASS);
+  ck_assert_int_eq(tr_alloc_stat(trs[1], CK_ALLOC_LEAKS), -1);
+#endif /* HAVE___LIBC_MALLOC */
+  free(trs);
+
+  /* not tracked unless asked for; the leaky test passes */
+  srunner_set_alloc_tracking(sr, 0);
+  srunner_run_all(sr, CK_SILENT);
+  trs = srunner_results(sr);
+  ck_assert_int_eq(tr_rtype(trs[nfirst + 1]), CK_PASS);
+  ck_assert_int_eq(tr_alloc_stat(trs[nfirst + 1], CK_ALLOC_COUNT), -1);
+  free(trs);
+  srunner_free(sr);
+}
+END_TEST
+#endif /* HAVE_FORK */
+
+/* kept where the compiler cannot see the allocations are unused */
+static void *volatile scope_block;
+
+START_TEST(test_scope_within)
+{
+  int i;
+
+  ck_alloc_scope_begin();
+  ck_assert_alloc_scope_end(0, 0);
+
+  ck_alloc_scope_begin();
+  for (i = 0; i < 3; i++) {
+    scope_block = malloc(10);
+    free(scope_block);
+  }
+  ck_assert_alloc_scope_end(3, 30);
+}
+END_TEST
+
+START_TEST(test_scope_allocs)
+{
+  ck_alloc_scope_begin();
+  scope_block = malloc(40);
+  ck_assert_alloc_scope_end(0, -1);
+}
+END_TEST
+
+START_TEST(test_scope_bytes)
+{
+  ck_alloc_scope_begin();
+  scope_block = calloc(2, 10);
+  scope_block = realloc(scope_block, 30);
+  free(scope_block);
+  ck_assert_alloc_scope_end(-1, 40);
+}
+END_TEST
+
+#if defined(HAVE_PTHREAD)
+/* held until the scope of test_scope_other_thread has begun */
+static pthread_mutex_t scope_start = PTHREAD_MUTEX_INITIALIZER;
+
+static void *scope_thread_alloc(void *arg CK_ATTRIBUTE_UNUSED)
+{
+  int i;
+
+  pthread_mutex_lock(&scope_start);
+  for (i = 0; i < 4; i++) {
+    scope_block = malloc(10);
+    free(scope_block);
+  }
+  pthread_mutex_unlock(&scope_start);
+  return NULL;
+}
+
+/* The allocations of other threads are not counted. The thread is
+   created before the scope, as creating it allocates */
+START_TEST(test_scope_other_thread)
+{
+  pthread_t thread;
+
+  pthread_mutex_lock(&scope_start);
+  ck_assert_int_eq(pthread_create(&thread, NULL, scope_thread_alloc, NULL),
+                   0);
+  ck_alloc_scope_begin();
+  pthread_mutex_unlock(&scope_start);
+  pthread_join(thread, NULL);
+  ck_assert_alloc_scope_end(0, 0);
+}
+END_TEST
+#endif /* HAVE_PTHREAD */
+
+START_TEST(test_alloc_scope_run)
+{
+  Suite *s = suite_create("Scope");
+  TCase *tc = tcase_create("Core");
+  SRunner *sr;
+  TestResult **trs;
+
+  suite_add_tcase(s, tc);
+  tcase_add_test(tc, test_scope_within);
+  tcase_add_test(tc, test_scope_allocs);
+  tcase_add_test(tc, test_scope_bytes);
+#if defined(HAVE_PTHREAD)
+  tcase_add_test(tc, test_scope_other_thread);
+#endif /* HAVE_PTHREAD */
+  sr = srunner_create(s);
+  srunner_set_fork_status(sr, fork_statuses[_i]);
+  srunner_run_all(sr, CK_SILENT);
+
+  trs = srunner_results(sr);
+  ck_assert_msg(tr_rtype(trs[0]) == CK_PASS, "Unexpected failure: %s",
+                tr_msg(trs[0]));
+#if defined(HAVE___LIBC_MALLOC)
+  ck_assert_int_eq(tr_rtype(trs[1]), CK_FAILURE);
+  ck_assert_msg(strstr(tr_msg(trs[1]), "Allocation scope made 1 allocations "
+                       "of 40 bytes, over the budget of 0 allocations; "
+                       "allocation 1 of 40 bytes went over it") ==
+                tr_msg(trs[1]), "Unexpected message: %s", tr_msg(trs[1]));
+#if defined(HAVE_EXECINFO_H)
+  ck_assert_msg(strstr(tr_msg(trs[1]), " from ") != NULL,
+                "No backtrace in: %s", tr_msg(trs[1]));
+#endif /* HAVE_EXECINFO_H */
+  ck_assert_int_eq(tr_rtype(trs[2]), CK_FAILURE);
+  ck_assert_msg(strstr(tr_msg(trs[2]), "Allocation scope made 2 allocations "
+                       "of 50 bytes, over the budget of 40 bytes; "
+                       "allocation 2 of 30 bytes went over it") ==
+                tr_msg(trs[2]), "Unexpected message: %s", tr_msg(trs[2]));
+#else
+  ck_assert_int_eq(tr_rtype(trs[1]), CK_PASS);
+  ck_assert_int_eq(tr_rtype(trs[2]), CK_PASS);
+#endif /* HAVE___LIBC_MALLOC */
+#if defined(HAVE_PTHREAD)
+  ck_assert_msg(tr_rtype(trs[3]) == CK_PASS, "Unexpected failure: %s",
+                tr_msg(trs[3]));
+#endif /* HAVE_PTHREAD */
+  free(trs);
+  srunner_free(sr);
+}
+END_TEST
+
+Suite *make_alloc_suite(void)
+{
+  Suite *s;
+  TCase *tc;
+
+  s = suite_create("Allocations");
+  tc = tcase_create("Tracking");
+
+  suite_add_tcase(s, tc);
+  tcase_add_test(tc, test_alloc_tracking_set);
+#if HAVE_DECL_SETENV
+  tcase_add_test(tc, test_alloc_tracking_env);
+#endif /* HAVE_DECL_SETENV */
+#if defined(HAVE_FORK) && HAVE_FORK==1
+  tcase_add_test(tc, test_alloc_tracking_fork);
+#endif /* HAVE_FORK */
+
+  tc = tcase_create("Scope");
+  suite_add_tcase(s, tc);
+  tcase_add_loop_test(tc, test_alloc_scope_run, 0, nfork_statuses);
+
+  return s;
+}
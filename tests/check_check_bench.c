@@ -0,0 +1,181 @@
+#include "../lib/libcompat.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include "check_check.h"
+
+START_TEST(test_set_bench_json)
+{
+  Suite *s = suite_create("Suite");
+  SRunner *sr = srunner_create(s);
+
+  srunner_set_bench_json (sr, "test_bench.json");
+
+  ck_assert_msg (srunner_has_bench_json (sr), "SRunner not writing benchmarks");
+  ck_assert_msg (strcmp(srunner_bench_json_fname(sr), "test_bench.json") == 0,
+	       "Bad file name returned");
+
+  /* the file is initialize only */
+  srunner_set_bench_json (sr, "test2_bench.json");
+  ck_assert_str_eq (srunner_bench_json_fname(sr), "test_bench.json");
+
+  srunner_free(sr);
+}
+END_TEST
+
+#if HAVE_DECL_SETENV
+START_TEST(test_set_bench_json_env)
+{
+  const char *old_val;
+  Suite *s = suite_create("Suite");
+  SRunner *sr = srunner_create(s);
+
+  ck_assert_msg(save_set_env("CK_BENCH_JSON_FILE_NAME", "test_bench.json", &old_val) == 0,
+              "Failed to set environment variable");
+
+  ck_assert_msg (srunner_has_bench_json (sr), "SRunner not writing benchmarks");
+  ck_assert_str_eq (srunner_bench_json_fname(sr), "test_bench.json");
+
+  /* an explicit call overrides the environment variable */
+  srunner_set_bench_json (sr, "test2_bench.json");
+  ck_assert_str_eq (srunner_bench_json_fname(sr), "test2_bench.json");
+
+  ck_assert_msg(restore_env("CK_BENCH_JSON_FILE_NAME", old_val) == 0,
+              "Failed to restore environment variable");
+
+  srunner_free(sr);
+}
+END_TEST
+#endif /* HAVE_DECL_SETENV */
+
+START_TEST(test_no_set_bench_json)
+{
+  Suite *s = suite_create("Suite");
+  SRunner *sr = srunner_create(s);
+
+  ck_assert_msg (!srunner_has_bench_json (sr), "SRunner writing benchmarks");
+  ck_assert_msg (srunner_bench_json_fname(sr) == NULL, "Bad file name returned");
+
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_bench_pass)
+{
+}
+END_TEST
+
+static char bench_str[] = "a string to take the length of";
+
+START_BENCH(bench_strlen)
+{
+  /* passed assertions are not sent on every call */
+  ck_assert_int_eq(strlen(bench_str), sizeof(bench_str) - 1);
+}
+END_BENCH
+
+START_BENCH(bench_fail)
+{
+  ck_abort_msg("Benchmark failure");
+}
+END_BENCH
+
+/* Whether the file has a line equal to str, less its indentation */
+static int file_has_line(const char *fname, const char *str)
+{
+  FILE *f = fopen(fname, "r");
+  char line[256];
+  int found = 0;
+
+  ck_assert_ptr_ne(f, NULL);
+  while (!found && fgets(line, sizeof(line), f) != NULL) {
+    found = strncmp(line + strspn(line, " "), str, strlen(str)) == 0;
+  }
+  fclose(f);
+  return found;
+}
+
+START_TEST(test_bench_run)
+{
+  Suite *s = suite_create("Bench");
+  TCase *tc = tcase_create("Core");
+  SRunner *sr;
+  TestResult **trs;
+#if HAVE_DECL_SETENV
+  const char *old_time;
+  const char *old_samples;
+#endif /* HAVE_DECL_SETENV */
+
+  suite_add_tcase(s, tc);
+  tcase_add_bench(tc, bench_strlen);
+  tcase_add_bench(tc, bench_fail);
+  tcase_add_test(tc, test_bench_pass);
+  sr = srunner_create(s);
+  srunner_set_fork_status(sr, fork_statuses[_i]);
+  srunner_set_bench_json(sr, "test_bench.json");
+#if HAVE_DECL_SETENV
+  /* enough to time strlen(), without slowing down the tests */
+  ck_assert_int_eq(save_set_env("CK_BENCH_TIME", "0.05", &old_time), 0);
+  ck_assert_int_eq(save_set_env("CK_BENCH_SAMPLES", "50", &old_samples), 0);
+#endif /* HAVE_DECL_SETENV */
+  srunner_run_all(sr, CK_SILENT);
+#if HAVE_DECL_SETENV
+  ck_assert_int_eq(restore_env("CK_BENCH_TIME", old_time), 0);
+  ck_assert_int_eq(restore_env("CK_BENCH_SAMPLES", old_samples), 0);
+#endif /* HAVE_DECL_SETENV */
+
+  ck_assert_int_eq(srunner_ntests_failed(sr), 1);
+  trs = srunner_results(sr);
+  ck_assert_int_eq(tr_rtype(trs[0]), CK_PASS);
+  ck_assert_msg(strncmp(tr_msg(trs[0]), "min ", 4) == 0,
+                "Benchmark did not report its statistics: %s", tr_msg(trs[0]));
+  ck_assert(tr_bench_stat(trs[0], CK_BENCH_MIN) > 0);
+  ck_assert(tr_bench_stat(trs[0], CK_BENCH_MIN) <=
+            tr_bench_stat(trs[0], CK_BENCH_MEDIAN));
+  ck_assert(tr_bench_stat(trs[0], CK_BENCH_MEDIAN) <=
+            tr_bench_stat(trs[0], CK_BENCH_P90));
+  ck_assert(tr_bench_stat(trs[0], CK_BENCH_P90) <=
+            tr_bench_stat(trs[0], CK_BENCH_P99));
+  ck_assert(tr_bench_stat(trs[0], CK_BENCH_MEAN) <=
+            tr_bench_stat(trs[0], CK_BENCH_P99));
+  ck_assert(tr_bench_stat(trs[0], CK_BENCH_MAD) >= 0);
+  /* strlen() of a short string takes nowhere near a microsecond */
+  ck_assert(tr_bench_stat(trs[0], CK_BENCH_MEDIAN) < 1000);
+
+  ck_assert_int_eq(tr_rtype(trs[1]), CK_FAILURE);
+  ck_assert_str_eq(tr_msg(trs[1]), "Benchmark failure");
+  ck_assert(tr_bench_stat(trs[1], CK_BENCH_MEDIAN) == -1);
+  ck_assert_int_eq(tr_rtype(trs[2]), CK_PASS);
+  ck_assert(tr_bench_stat(trs[2], CK_BENCH_MIN) == -1);
+  free(trs);
+  srunner_free(sr);
+
+  ck_assert(file_has_line("test_bench.json", "\"benchmarks\": ["));
+  ck_assert(file_has_line("test_bench.json",
+                          "\"name\": \"Bench/Core/bench_strlen_median\","));
+  ck_assert(file_has_line("test_bench.json", "\"aggregate_name\": \"p99\","));
+  ck_assert(!file_has_line("test_bench.json",
+                           "\"name\": \"Bench/Core/bench_fail\","));
+}
+END_TEST
+
+Suite *make_bench_suite(void)
+{
+  Suite *s;
+  TCase *tc;
+
+  s = suite_create("Benchmarks");
+  tc = tcase_create("Core");
+
+  suite_add_tcase(s, tc);
+  tcase_add_test(tc, test_set_bench_json);
+#if HAVE_DECL_SETENV
+  tcase_add_test(tc, test_set_bench_json_env);
+#endif /* HAVE_DECL_SETENV */
+  tcase_add_test(tc, test_no_set_bench_json);
+  tcase_add_loop_test(tc, test_bench_run, 0, nfork_statuses);
+
+  return s;
+}
@@ -14,6 +14,12 @@ int main (void)
   setup();
   sr = srunner_create (make_master_suite());
   srunner_add_suite(sr, make_log_suite());
+  srunner_add_suite(sr, make_streaming_suite());
+  srunner_add_suite(sr, make_times_suite());
+  srunner_add_suite(sr, make_perf_suite());
+  srunner_add_suite(sr, make_bench_suite());
+  srunner_add_suite(sr, make_alloc_suite());
+  srunner_add_suite(sr, make_phases_suite());
   srunner_add_suite(sr, make_fork_suite());
 
   printf ("Ran %d tests in subordinate suite\n", sub_ntests);
@@ -583,8 +583,262 @@ START_TEST(test_ch_teardown_two_teardowns_fork)
   srunner_free(sr);
 }
 END_TEST
+
+#if defined(HAVE_PTHREAD)
+static pthread_t ahead_main;
+static int ahead_in_thread;
+static int ahead_value;
+
+static void setup_ahead (void)
+{
+  ahead_in_thread = !pthread_equal(pthread_self(), ahead_main);
+  ahead_value = 42;
+}
+
+static void setup_ahead_fail (void)
+{
+  ck_abort_msg("Setup run ahead failed");
+}
+
+START_TEST(test_sub_ahead)
+{
+  ck_assert_int_eq(ahead_value, 42);
+}
+END_TEST
+
+static SRunner *make_ahead_runner (SFun setup, int pipelined)
+{
+  Suite *s = suite_create("Ahead Sub");
+  TCase *tc1 = tcase_create("Before");
+  TCase *tc2 = tcase_create("Ahead");
+  SRunner *sr;
+
+  tcase_add_test(tc1, test_sub_pass);
+  tcase_add_test(tc2, test_sub_ahead);
+  tcase_add_test(tc2, test_sub_ahead);
+  tcase_add_unchecked_fixture(tc2, setup_ahead, NULL);
+  tcase_add_unchecked_fixture(tc2, setup, NULL);
+  tcase_set_independent(tc2, 1);
+  suite_add_tcase(s, tc1);
+  suite_add_tcase(s, tc2);
+  sr = srunner_create(s);
+  srunner_set_fork_status(sr, CK_FORK);
+  srunner_set_pipelined_setup(sr, pipelined);
+  ahead_main = pthread_self();
+  ahead_in_thread = -1;
+  ahead_value = 0;
+  return sr;
+}
+
+static void setup_nothing (void)
+{
+}
+
+START_TEST(test_pipelined_setup)
+{
+  SRunner *sr = make_ahead_runner(setup_nothing, 1);
+
+  ck_assert_int_eq(srunner_pipelined_setup(sr), 1);
+  srunner_run_all(sr, CK_SILENT);
+  ck_assert_int_eq(srunner_ntests_run(sr), 3);
+  ck_assert_int_eq(srunner_ntests_failed(sr), 0);
+  ck_assert_int_eq(ahead_in_thread, 1);
+  srunner_free(sr);
+
+  /* without pipelining, the setup runs when its test case starts */
+  sr = make_ahead_runner(setup_nothing, 0);
+  srunner_run_all(sr, CK_SILENT);
+  ck_assert_int_eq(srunner_ntests_failed(sr), 0);
+  ck_assert_int_eq(ahead_in_thread, 0);
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_pipelined_setup_fail)
+{
+  SRunner *sr = make_ahead_runner(setup_ahead_fail, 1);
+  TestResult **tra;
+  char *trm;
+
+  srunner_run_all(sr, CK_SILENT);
+  ck_assert_int_eq(srunner_ntests_run(sr), 2);
+  ck_assert_int_eq(srunner_ntests_failed(sr), 1);
+  ck_assert_int_eq(ahead_in_thread, 1);
+
+  tra = srunner_failures(sr);
+  trm = tr_str(tra[0]);
+  ck_assert_msg(strstr(trm, ":S:Ahead:unchecked_setup:0: "
+                       "Setup run ahead failed") != NULL,
+                "Bad setup run ahead tr msg (%s)", trm);
+  free(trm);
+  free(tra);
+  srunner_free(sr);
+}
+END_TEST
+#endif /* HAVE_PTHREAD */
 #endif /* HAVE_FORK */
 
+static int shared_value;
+static int suite_setups;
+static int suite_teardowns;
+static int runner_setups;
+static int runner_teardowns;
+
+static void suite_setup (void)
+{
+  suite_setups++;
+  shared_value++;
+}
+
+static void suite_teardown (void)
+{
+  suite_teardowns++;
+  shared_value--;
+}
+
+static void runner_setup (void)
+{
+  runner_setups++;
+  shared_value += 10;
+}
+
+static void runner_teardown (void)
+{
+  runner_teardowns++;
+  shared_value -= 10;
+}
+
+static void suite_setup_fail (void)
+{
+  ck_abort_msg("Suite setup failed");
+}
+
+static void suite_teardown_fail (void)
+{
+  ck_abort_msg("Suite teardown failed");
+}
+
+static void reset_shared_fixtures (void)
+{
+  shared_value = 0;
+  suite_setups = suite_teardowns = 0;
+  runner_setups = runner_teardowns = 0;
+}
+
+/* set up once in the runner, so also seen by forked tests */
+START_TEST(test_sub_shared)
+{
+  ck_assert_int_eq(shared_value, 11);
+}
+END_TEST
+
+static Suite *make_shared_sub_suite (const char *name)
+{
+  Suite *s = suite_create(name);
+  TCase *tc1 = tcase_create("Shared 1");
+  TCase *tc2 = tcase_create("Shared 2");
+
+  tcase_add_test(tc1, test_sub_shared);
+  tcase_add_test(tc1, test_sub_shared);
+  tcase_add_test(tc2, test_sub_shared);
+  suite_add_tcase(s, tc1);
+  suite_add_tcase(s, tc2);
+  return s;
+}
+
+START_TEST(test_suite_fixture)
+{
+  Suite *s1 = make_shared_sub_suite("Shared Sub 1");
+  Suite *s2 = make_shared_sub_suite("Shared Sub 2");
+  SRunner *sr;
+
+  reset_shared_fixtures();
+  suite_add_fixture(s1, suite_setup, suite_teardown);
+  suite_add_fixture(s2, suite_setup, suite_teardown);
+  sr = srunner_create(s1);
+  srunner_add_suite(sr, s2);
+  srunner_add_fixture(sr, runner_setup, runner_teardown);
+  srunner_run_all(sr, CK_SILENT);
+
+  ck_assert_int_eq(srunner_ntests_run(sr), 6);
+  ck_assert_int_eq(srunner_ntests_failed(sr), 0);
+  ck_assert_int_eq(suite_setups, 2);
+  ck_assert_int_eq(suite_teardowns, 2);
+  ck_assert_int_eq(runner_setups, 1);
+  ck_assert_int_eq(runner_teardowns, 1);
+  ck_assert_int_eq(shared_value, 0);
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_suite_fixture_fail)
+{
+  Suite *s1 = make_shared_sub_suite("Setup Fail Sub");
+  Suite *s2 = make_shared_sub_suite("Teardown Fail Sub");
+  SRunner *sr;
+  TestResult **tra;
+  char *trm;
+
+  reset_shared_fixtures();
+  /* the setup of s1 fails before its tests, and the teardown of s2
+     after them; each is reported once */
+  suite_add_fixture(s1, suite_setup_fail, suite_teardown);
+  suite_add_fixture(s2, suite_setup, suite_teardown_fail);
+  suite_add_fixture(s2, runner_setup, NULL);
+  sr = srunner_create(s1);
+  srunner_add_suite(sr, s2);
+  srunner_run_all(sr, CK_SILENT);
+
+  ck_assert_int_eq(srunner_ntests_run(sr), 5);
+  ck_assert_int_eq(srunner_ntests_failed(sr), 2);
+  ck_assert_int_eq(suite_setups, 1);
+  ck_assert_int_eq(suite_teardowns, 0);
+
+  tra = srunner_failures(sr);
+  trm = tr_str(tra[0]);
+  ck_assert_msg(strstr(trm, ":S:Setup Fail Sub:suite_setup:0: "
+                       "Suite setup failed") != NULL,
+                "Bad suite setup tr msg (%s)", trm);
+  free(trm);
+  trm = tr_str(tra[1]);
+  ck_assert_msg(strstr(trm, ":S:Teardown Fail Sub:suite_teardown:0: "
+                       "Suite teardown failed") != NULL,
+                "Bad suite teardown tr msg (%s)", trm);
+  free(trm);
+  free(tra);
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_runner_fixture_fail)
+{
+  SRunner *sr = srunner_create(make_shared_sub_suite("Runner Fail Sub"));
+  TestResult **tra;
+  char *trm;
+
+  reset_shared_fixtures();
+  srunner_add_fixture(sr, runner_setup, runner_teardown);
+  srunner_add_fixture(sr, suite_setup_fail, suite_teardown);
+  srunner_run_all(sr, CK_SILENT);
+
+  /* only the failure is reported, and nothing is torn down */
+  ck_assert_int_eq(srunner_ntests_run(sr), 1);
+  ck_assert_int_eq(srunner_ntests_failed(sr), 1);
+  ck_assert_int_eq(runner_setups, 1);
+  ck_assert_int_eq(runner_teardowns, 0);
+  ck_assert_int_eq(suite_teardowns, 0);
+
+  tra = srunner_failures(sr);
+  trm = tr_str(tra[0]);
+  ck_assert_msg(strstr(trm, ":S:runner:runner_setup:0: "
+                       "Suite setup failed") != NULL,
+                "Bad runner setup tr msg (%s)", trm);
+  free(trm);
+  free(tra);
+  srunner_free(sr);
+}
+END_TEST
+
 Suite *make_fixture_suite (void)
 {
 
@@ -598,6 +852,9 @@ Suite *make_fixture_suite (void)
   tcase_add_test(tc,test_fixture_fail_counts);
   tcase_add_test(tc,test_print_counts);
   tcase_add_test(tc,test_setup_failure_msg);
+  tcase_add_test(tc,test_suite_fixture);
+  tcase_add_test(tc,test_suite_fixture_fail);
+  tcase_add_test(tc,test_runner_fixture_fail);
 
 #if defined(HAVE_FORK) && HAVE_FORK==1
   /*
@@ -617,6 +874,10 @@ Suite *make_fixture_suite (void)
   tcase_add_test(tc,test_ch_teardown_fail_nofork);
   tcase_add_test(tc,test_ch_teardown_sig);
   tcase_add_test(tc,test_ch_teardown_two_teardowns_fork);
+#if defined(HAVE_PTHREAD)
+  tcase_add_test(tc,test_pipelined_setup);
+  tcase_add_test(tc,test_pipelined_setup_fail);
+#endif
 #endif
 
   return s;
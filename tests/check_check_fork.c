@@ -2,9 +2,17 @@
 
 #include <sys/types.h>
 #include <stdlib.h>
+#include <string.h>
 #include <check.h>
 #include "check_check.h"
 
+const enum fork_status fork_statuses[] = {
+  CK_NOFORK,
+#if defined(HAVE_FORK) && HAVE_FORK==1
+  CK_FORK
+#endif /* HAVE_FORK */
+};
+const int nfork_statuses = sizeof(fork_statuses) / sizeof(fork_statuses[0]);
 
 static int counter;
 static pid_t mypid;
@@ -121,6 +129,328 @@ START_TEST(test_env_and_set)
 	      "Explicit setting of fork status should override env");
 }
 END_TEST
+
+/* kept where the compiler cannot see the allocation is unused */
+static void *volatile limit_block;
+
+START_TEST(test_alloc_small)
+{
+  limit_block = malloc(1024);
+  ck_assert_ptr_ne(limit_block, NULL);
+  free(limit_block);
+}
+END_TEST
+
+/* touches all it allocates, so that it is resident */
+START_TEST(test_alloc_fill)
+{
+  void **chunk;
+
+  for (;;) {
+    chunk = malloc(1 << 20);
+    ck_assert_ptr_ne(chunk, NULL);
+    memset(chunk, 1, 1 << 20);
+    *chunk = limit_block;
+    limit_block = chunk;
+  }
+}
+END_TEST
+
+START_TEST(test_spin)
+{
+  volatile unsigned long n = 0;
+
+  for (;;)
+    n++;
+}
+END_TEST
+
+static SRunner *run_limited(TCase * tc, TFun tfun)
+{
+  Suite *s = suite_create("Limits");
+  SRunner *sr;
+
+  suite_add_tcase(s, tc);
+  tcase_add_test(tc, tfun);
+  sr = srunner_create(s);
+  srunner_set_fork_status(sr, CK_FORK);
+  srunner_run_all(sr, CK_SILENT);
+  return sr;
+}
+
+static void check_memory_limit(TCase * tc)
+{
+  SRunner *sr;
+  TestResult **trs;
+
+  tcase_add_test(tc, test_alloc_small);
+  sr = run_limited(tc, test_alloc_fill);
+  trs = srunner_results(sr);
+  ck_assert_msg(tr_rtype(trs[0]) == CK_PASS, "Unexpected failure: %s",
+		tr_msg(trs[0]));
+#if defined(HAVE_SETRLIMIT)
+  ck_assert_int_eq(tr_rtype(trs[1]), CK_ERROR);
+  ck_assert_msg(strstr(tr_msg(trs[1]), "Memory limit of 268435456 bytes "
+		       "exceeded: ") == tr_msg(trs[1]),
+		"Unexpected message: %s", tr_msg(trs[1]));
+#endif
+  free(trs);
+  srunner_free(sr);
+}
+
+START_TEST(test_memory_limit)
+{
+  TCase *tc = tcase_create("Memory");
+
+  tcase_set_memory_limit(tc, 256 << 20);
+  check_memory_limit(tc);
+}
+END_TEST
+
+START_TEST(test_memory_limit_env)
+{
+  TCase *tc;
+
+  setenv("CK_DEFAULT_MEMORY_LIMIT", "256M", 1);
+  tc = tcase_create("Memory");
+  unsetenv("CK_DEFAULT_MEMORY_LIMIT");
+  check_memory_limit(tc);
+}
+END_TEST
+
+START_TEST(test_cpu_limit)
+{
+  TCase *tc = tcase_create("CPU");
+  SRunner *sr;
+  TestResult **trs;
+
+  tcase_set_timeout(tc, 20);
+  tcase_set_cpu_limit(tc, 1);
+  sr = run_limited(tc, test_spin);
+  trs = srunner_results(sr);
+#if defined(HAVE_SETRLIMIT)
+  ck_assert_int_eq(tr_rtype(trs[0]), CK_ERROR);
+  ck_assert_msg(strstr(tr_msg(trs[0]), "CPU time limit of ") == tr_msg(trs[0]),
+		"Unexpected message: %s", tr_msg(trs[0]));
+#endif
+  free(trs);
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_timeout_clock_set)
+{
+  SRunner *sr = srunner_create(NULL);
+
+  ck_assert_int_eq(srunner_timeout_clock(sr), CK_TIMEOUT_WALL);
+  setenv("CK_TIMEOUT_CLOCK", "cpu", 1);
+  ck_assert_int_eq(srunner_timeout_clock(sr), CK_TIMEOUT_CPU);
+  srunner_set_timeout_clock(sr, CK_TIMEOUT_WALL);
+  ck_assert_int_eq(srunner_timeout_clock(sr), CK_TIMEOUT_WALL);
+  unsetenv("CK_TIMEOUT_CLOCK");
+
+  ck_assert(srunner_timeout_ceiling(sr) == 10);
+  setenv("CK_TIMEOUT_CEILING", "3.5", 1);
+  ck_assert(srunner_timeout_ceiling(sr) == 3.5);
+  srunner_set_timeout_ceiling(sr, 0);
+  ck_assert(srunner_timeout_ceiling(sr) == 0);
+  unsetenv("CK_TIMEOUT_CEILING");
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_sleep)
+{
+  usleep(1500000);
+}
+END_TEST
+
+START_TEST(test_sleep_long)
+{
+  sleep(20);
+}
+END_TEST
+
+static TestResult *run_cpu_timed(SRunner ** srp, TFun tfun, double ceiling)
+{
+  Suite *s = suite_create("Timeouts");
+  TCase *tc = tcase_create("CPU");
+  SRunner *sr;
+  TestResult **trs;
+  TestResult *tr;
+
+  suite_add_tcase(s, tc);
+  tcase_set_timeout(tc, 0.5);
+  tcase_add_test(tc, tfun);
+  sr = srunner_create(s);
+  srunner_set_fork_status(sr, CK_FORK);
+  srunner_set_timeout_clock(sr, CK_TIMEOUT_CPU);
+  srunner_set_timeout_ceiling(sr, ceiling);
+  srunner_run_all(sr, CK_SILENT);
+  trs = srunner_results(sr);
+  tr = trs[0];
+  free(trs);
+  *srp = sr;
+  return tr;
+}
+
+START_TEST(test_cpu_timeout)
+{
+  SRunner *sr;
+  TestResult *tr;
+
+  /* a test that waits longer than its timeout is not killed */
+  tr = run_cpu_timed(&sr, test_sleep, 10);
+#if defined(HAVE_CLOCK_GETCPUCLOCKID)
+  ck_assert_msg(tr_rtype(tr) == CK_PASS, "Unexpected failure: %s",
+		tr_msg(tr));
+#endif
+  srunner_free(sr);
+
+  tr = run_cpu_timed(&sr, test_spin, 10);
+  ck_assert_int_eq(tr_rtype(tr), CK_ERROR);
+#if defined(HAVE_CLOCK_GETCPUCLOCKID)
+  ck_assert_str_eq(tr_msg(tr), "Test CPU time timeout expired");
+#else
+  ck_assert_str_eq(tr_msg(tr), "Test timeout expired");
+#endif
+  srunner_free(sr);
+
+  tr = run_cpu_timed(&sr, test_sleep_long, 2);
+  ck_assert_int_eq(tr_rtype(tr), CK_ERROR);
+#if defined(HAVE_CLOCK_GETCPUCLOCKID)
+  ck_assert_str_eq(tr_msg(tr), "Test wall clock ceiling expired");
+#endif
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_test_timeout)
+{
+  Suite *s = suite_create("Timeouts");
+  TCase *tc = tcase_create("Core");
+  SRunner *sr;
+  TestResult **trs;
+
+  suite_add_tcase(s, tc);
+  tcase_set_timeout(tc, 10);
+  tcase_add_test_with_timeout(tc, test_sleep, 0.5);
+  tcase_add_test(tc, test_alloc_small);
+  sr = srunner_create(s);
+  srunner_set_fork_status(sr, CK_FORK);
+  srunner_run_all(sr, CK_SILENT);
+  trs = srunner_results(sr);
+  ck_assert_int_eq(tr_rtype(trs[0]), CK_ERROR);
+  ck_assert_str_eq(tr_msg(trs[0]), "Test timeout expired");
+  ck_assert_msg(tr_rtype(trs[1]) == CK_PASS, "Unexpected failure: %s",
+		tr_msg(trs[1]));
+  free(trs);
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_timeout_history)
+{
+  const char *fname = "test_history.txt";
+  Suite *s = suite_create("History");
+  TCase *tc = tcase_create("Core");
+  SRunner *sr;
+  TestResult **trs;
+  FILE *file;
+  char line[256];
+  int found = 0;
+
+  file = fopen(fname, "w");
+  ck_assert_ptr_ne(file, NULL);
+  fputs("CKHIST01\n"
+	"History/Core/test_sleep\t1000000 1000000 2000000 1000000 1000000\n",
+	file);
+  fclose(file);
+
+  suite_add_tcase(s, tc);
+  tcase_set_timeout(tc, 10);
+  tcase_add_test(tc, test_sleep);
+  tcase_add_test(tc, test_alloc_small);
+  sr = srunner_create(s);
+  ck_assert_ptr_eq(srunner_timeout_history(sr), NULL);
+  setenv("CK_TIMEOUT_HISTORY", fname, 1);
+  ck_assert_str_eq(srunner_timeout_history(sr), fname);
+  unsetenv("CK_TIMEOUT_HISTORY");
+  srunner_set_timeout_history(sr, fname, 5, 0.2);
+  srunner_set_fork_status(sr, CK_FORK);
+  srunner_run_all(sr, CK_SILENT);
+  trs = srunner_results(sr);
+  /* 5 times 2 ms is under the floor */
+  ck_assert_int_eq(tr_rtype(trs[0]), CK_ERROR);
+  ck_assert_str_eq(tr_msg(trs[0]),
+		   "Test timeout of 200.00 ms from its history expired");
+  ck_assert_msg(tr_rtype(trs[1]) == CK_PASS, "Unexpected failure: %s",
+		tr_msg(trs[1]));
+  free(trs);
+  srunner_free(sr);
+
+  /* the passed test is added, and the timed out one left as it was */
+  file = fopen(fname, "r");
+  ck_assert_ptr_ne(file, NULL);
+  ck_assert_ptr_ne(fgets(line, sizeof(line), file), NULL);
+  ck_assert_str_eq(line, "CKHIST01\n");
+  while (fgets(line, sizeof(line), file) != NULL) {
+    if (strncmp(line, "History/Core/test_sleep\t", 24) == 0) {
+      ck_assert_str_eq(line, "History/Core/test_sleep\t"
+		       "1000000 1000000 2000000 1000000 1000000\n");
+      found++;
+    } else if (strncmp(line, "History/Core/test_alloc_small\t", 30) == 0) {
+      ck_assert_ptr_eq(strchr(line, ' '), NULL);
+      found++;
+    }
+  }
+  fclose(file);
+  ck_assert_int_eq(found, 2);
+  unlink(fname);
+}
+END_TEST
+
+static void slow_setup(void)
+{
+  usleep(300000);
+}
+
+START_TEST(test_fast)
+{
+}
+END_TEST
+
+/* The history keeps the time of the checked fixtures too, which the
+   timeout covers, so a slow setup does not get the test killed once
+   the history is long enough to set its timeout */
+START_TEST(test_timeout_history_fixture)
+{
+  const char *fname = "test_history_fixture.txt";
+  int run;
+
+  unlink(fname);
+  for (run = 0; run < 6; run++) {
+    Suite *s = suite_create("History");
+    TCase *tc = tcase_create("Fixture");
+    SRunner *sr;
+    TestResult **trs;
+
+    suite_add_tcase(s, tc);
+    tcase_add_checked_fixture(tc, slow_setup, NULL);
+    tcase_add_test(tc, test_fast);
+    sr = srunner_create(s);
+    srunner_set_timeout_history(sr, fname, 1.5, 0.1);
+    srunner_set_fork_status(sr, CK_FORK);
+    srunner_run_all(sr, CK_SILENT);
+    trs = srunner_results(sr);
+    ck_assert_msg(tr_rtype(trs[0]) == CK_PASS, "Run %d failed: %s", run,
+		  tr_msg(trs[0]));
+    free(trs);
+    srunner_free(sr);
+  }
+  unlink(fname);
+}
+END_TEST
 #endif /* HAVE_FORK */
 
 START_TEST(test_nofork)
@@ -147,6 +477,24 @@ Suite *make_fork_suite(void)
   tcase_add_test(tc,test_env_and_set);
 #endif /* HAVE_FORK */
   tcase_add_test(tc,test_nofork);
+
+#if defined(HAVE_FORK) && HAVE_FORK==1
+  tc = tcase_create("Limits");
+  suite_add_tcase(s, tc);
+  tcase_set_timeout(tc, 30);
+  tcase_add_test(tc, test_memory_limit);
+  tcase_add_test(tc, test_memory_limit_env);
+  tcase_add_test(tc, test_cpu_limit);
+
+  tc = tcase_create("Timeouts");
+  suite_add_tcase(s, tc);
+  tcase_set_timeout(tc, 30);
+  tcase_add_test(tc, test_timeout_clock_set);
+  tcase_add_test(tc, test_cpu_timeout);
+  tcase_add_test(tc, test_test_timeout);
+  tcase_add_test(tc, test_timeout_history);
+  tcase_add_test(tc, test_timeout_history_fixture);
+#endif /* HAVE_FORK */
   
   return s;
 }
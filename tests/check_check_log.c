@@ -8,8 +8,8 @@
 
 #if HAVE_DECL_SETENV
 /* save environment variable's value and set new value */
-static int save_set_env(const char *name, const char *value,
-                        const char **old_value)
+int save_set_env(const char *name, const char *value,
+                 const char **old_value)
 {
   *old_value = getenv(name);
   return setenv(name, value, 1);
@@ -17,7 +17,7 @@ static int save_set_env(const char *name, const char *value,
 
 /* restore environment variable's old value, handle cases where
    variable must be unset (old value is NULL) */
-static int restore_env(const char *name, const char *old_value)
+int restore_env(const char *name, const char *old_value)
 {
   int res;
   if (old_value == NULL) {
@@ -255,16 +255,245 @@ START_TEST(test_double_set_tap)
 }
 END_TEST
 
+START_TEST(test_set_junit)
+{
+  Suite *s = suite_create("Suite");
+  SRunner *sr = srunner_create(s);
+
+  srunner_set_junit (sr, "test_log.junit.xml");
+
+  ck_assert_msg (srunner_has_junit (sr), "SRunner not logging JUnit");
+  ck_assert_msg (strcmp(srunner_junit_fname(sr), "test_log.junit.xml") == 0,
+	       "Bad file name returned");
+
+  srunner_free(sr);
+}
+END_TEST
+
+#if HAVE_DECL_SETENV
+/* Test enabling JUnit logging via environment variable */
+START_TEST(test_set_junit_env)
+{
+  const char *old_val;
+  Suite *s = suite_create("Suite");
+  SRunner *sr = srunner_create(s);
+
+  /* check that setting JUnit log file via environment variable works */
+  ck_assert_msg(save_set_env("CK_JUNIT_LOG_FILE_NAME", "test_log.junit.xml", &old_val) == 0,
+              "Failed to set environment variable");
+
+  ck_assert_msg (srunner_has_junit (sr), "SRunner not logging JUnit");
+  ck_assert_msg (strcmp(srunner_junit_fname(sr), "test_log.junit.xml") == 0,
+	       "Bad file name returned");
+
+  /* check that explicit call to srunner_set_junit()
+     overrides environment variable */
+  srunner_set_junit (sr, "test2_log.junit.xml");
+
+  ck_assert_msg (srunner_has_junit (sr), "SRunner not logging JUnit");
+  ck_assert_msg (strcmp(srunner_junit_fname(sr), "test2_log.junit.xml") == 0,
+	       "Bad file name returned");
+
+  /* restore old environment */
+  ck_assert_msg(restore_env("CK_JUNIT_LOG_FILE_NAME", old_val) == 0,
+              "Failed to restore environment variable");
+
+  srunner_free(sr);
+}
+END_TEST
+#endif /* HAVE_DECL_SETENV */
+
+START_TEST(test_no_set_junit)
+{
+  Suite *s = suite_create("Suite");
+  SRunner *sr = srunner_create(s);
+
+  ck_assert_msg (!srunner_has_junit (sr), "SRunner not logging JUnit");
+  ck_assert_msg (srunner_junit_fname(sr) == NULL, "Bad file name returned");
+
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_double_set_junit)
+{
+  Suite *s = suite_create("Suite");
+  SRunner *sr = srunner_create(s);
+
+  srunner_set_junit (sr, "test_log.junit.xml");
+  srunner_set_junit (sr, "test2_log.junit.xml");
+
+  ck_assert_msg(strcmp(srunner_junit_fname(sr), "test_log.junit.xml") == 0,
+	      "JUnit log file is initialize only and shouldn't be changeable once set");
+
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_set_jsonl)
+{
+  Suite *s = suite_create("Suite");
+  SRunner *sr = srunner_create(s);
+
+  srunner_set_jsonl (sr, "test_log.jsonl");
+
+  ck_assert_msg (srunner_has_jsonl (sr), "SRunner not logging JSON Lines");
+  ck_assert_msg (strcmp(srunner_jsonl_fname(sr), "test_log.jsonl") == 0,
+	       "Bad file name returned");
+
+  srunner_free(sr);
+}
+END_TEST
+
+#if HAVE_DECL_SETENV
+/* Test enabling JSON Lines logging via environment variable */
+START_TEST(test_set_jsonl_env)
+{
+  const char *old_val;
+  Suite *s = suite_create("Suite");
+  SRunner *sr = srunner_create(s);
+
+  /* check that setting JSON Lines log file via environment variable works */
+  ck_assert_msg(save_set_env("CK_JSONL_LOG_FILE_NAME", "test_log.jsonl", &old_val) == 0,
+              "Failed to set environment variable");
+
+  ck_assert_msg (srunner_has_jsonl (sr), "SRunner not logging JSON Lines");
+  ck_assert_msg (strcmp(srunner_jsonl_fname(sr), "test_log.jsonl") == 0,
+	       "Bad file name returned");
+
+  /* check that explicit call to srunner_set_jsonl()
+     overrides environment variable */
+  srunner_set_jsonl (sr, "test2_log.jsonl");
+
+  ck_assert_msg (srunner_has_jsonl (sr), "SRunner not logging JSON Lines");
+  ck_assert_msg (strcmp(srunner_jsonl_fname(sr), "test2_log.jsonl") == 0,
+	       "Bad file name returned");
+
+  /* restore old environment */
+  ck_assert_msg(restore_env("CK_JSONL_LOG_FILE_NAME", old_val) == 0,
+              "Failed to restore environment variable");
+
+  srunner_free(sr);
+}
+END_TEST
+#endif /* HAVE_DECL_SETENV */
+
+START_TEST(test_no_set_jsonl)
+{
+  Suite *s = suite_create("Suite");
+  SRunner *sr = srunner_create(s);
+
+  ck_assert_msg (!srunner_has_jsonl (sr), "SRunner not logging JSON Lines");
+  ck_assert_msg (srunner_jsonl_fname(sr) == NULL, "Bad file name returned");
+
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_double_set_jsonl)
+{
+  Suite *s = suite_create("Suite");
+  SRunner *sr = srunner_create(s);
+
+  srunner_set_jsonl (sr, "test_log.jsonl");
+  srunner_set_jsonl (sr, "test2_log.jsonl");
+
+  ck_assert_msg(strcmp(srunner_jsonl_fname(sr), "test_log.jsonl") == 0,
+	      "JSON Lines log file is initialize only and shouldn't be changeable once set");
+
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_set_binlog)
+{
+  Suite *s = suite_create("Suite");
+  SRunner *sr = srunner_create(s);
+
+  srunner_set_binlog (sr, "test_log.ckb");
+
+  ck_assert_msg (srunner_has_binlog (sr), "SRunner not logging binary");
+  ck_assert_msg (strcmp(srunner_binlog_fname(sr), "test_log.ckb") == 0,
+	       "Bad file name returned");
+
+  srunner_free(sr);
+}
+END_TEST
+
+#if HAVE_DECL_SETENV
+/* Test enabling binary logging via environment variable */
+START_TEST(test_set_binlog_env)
+{
+  const char *old_val;
+  Suite *s = suite_create("Suite");
+  SRunner *sr = srunner_create(s);
+
+  /* check that setting binary log file via environment variable works */
+  ck_assert_msg(save_set_env("CK_BIN_LOG_FILE_NAME", "test_log.ckb", &old_val) == 0,
+              "Failed to set environment variable");
+
+  ck_assert_msg (srunner_has_binlog (sr), "SRunner not logging binary");
+  ck_assert_msg (strcmp(srunner_binlog_fname(sr), "test_log.ckb") == 0,
+	       "Bad file name returned");
+
+  /* check that explicit call to srunner_set_binlog()
+     overrides environment variable */
+  srunner_set_binlog (sr, "test2_log.ckb");
+
+  ck_assert_msg (srunner_has_binlog (sr), "SRunner not logging binary");
+  ck_assert_msg (strcmp(srunner_binlog_fname(sr), "test2_log.ckb") == 0,
+	       "Bad file name returned");
+
+  /* restore old environment */
+  ck_assert_msg(restore_env("CK_BIN_LOG_FILE_NAME", old_val) == 0,
+              "Failed to restore environment variable");
+
+  srunner_free(sr);
+}
+END_TEST
+#endif /* HAVE_DECL_SETENV */
+
+START_TEST(test_no_set_binlog)
+{
+  Suite *s = suite_create("Suite");
+  SRunner *sr = srunner_create(s);
+
+  ck_assert_msg (!srunner_has_binlog (sr), "SRunner not logging binary");
+  ck_assert_msg (srunner_binlog_fname(sr) == NULL, "Bad file name returned");
+
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_double_set_binlog)
+{
+  Suite *s = suite_create("Suite");
+  SRunner *sr = srunner_create(s);
+
+  srunner_set_binlog (sr, "test_log.ckb");
+  srunner_set_binlog (sr, "test2_log.ckb");
+
+  ck_assert_msg(strcmp(srunner_binlog_fname(sr), "test_log.ckb") == 0,
+	      "Binary log file is initialize only and shouldn't be changeable once set");
+
+  srunner_free(sr);
+}
+END_TEST
+
 Suite *make_log_suite(void)
 {
 
   Suite *s;
-  TCase *tc_core, *tc_core_xml, *tc_core_tap;
+  TCase *tc_core, *tc_core_xml, *tc_core_tap, *tc_core_junit;
+  TCase *tc_core_jsonl, *tc_core_binlog;
 
   s = suite_create("Log");
   tc_core = tcase_create("Core");
   tc_core_xml = tcase_create("Core XML");
   tc_core_tap = tcase_create("Core TAP");
+  tc_core_junit = tcase_create("Core JUnit");
+  tc_core_jsonl = tcase_create("Core JSON Lines");
+  tc_core_binlog = tcase_create("Core binary");
 
   suite_add_tcase(s, tc_core);
   tcase_add_test(tc_core, test_set_log);
@@ -290,6 +519,30 @@ Suite *make_log_suite(void)
   tcase_add_test(tc_core_tap, test_no_set_tap);
   tcase_add_test(tc_core_tap, test_double_set_tap);
 
+  suite_add_tcase(s, tc_core_junit);
+  tcase_add_test(tc_core_junit, test_set_junit);
+#if HAVE_DECL_SETENV
+  tcase_add_test(tc_core_junit, test_set_junit_env);
+#endif /* HAVE_DECL_SETENV */
+  tcase_add_test(tc_core_junit, test_no_set_junit);
+  tcase_add_test(tc_core_junit, test_double_set_junit);
+
+  suite_add_tcase(s, tc_core_jsonl);
+  tcase_add_test(tc_core_jsonl, test_set_jsonl);
+#if HAVE_DECL_SETENV
+  tcase_add_test(tc_core_jsonl, test_set_jsonl_env);
+#endif /* HAVE_DECL_SETENV */
+  tcase_add_test(tc_core_jsonl, test_no_set_jsonl);
+  tcase_add_test(tc_core_jsonl, test_double_set_jsonl);
+
+  suite_add_tcase(s, tc_core_binlog);
+  tcase_add_test(tc_core_binlog, test_set_binlog);
+#if HAVE_DECL_SETENV
+  tcase_add_test(tc_core_binlog, test_set_binlog_env);
+#endif /* HAVE_DECL_SETENV */
+  tcase_add_test(tc_core_binlog, test_no_set_binlog);
+  tcase_add_test(tc_core_binlog, test_double_set_binlog);
+
   return s;
 }
 
@@ -8,7 +8,11 @@
 #include <check.h>
 #include <check_list.h>
 #include <check_impl.h>
+#include <check_perf.h>
+#include <check_stats.h>
+#include <check_binlog.h>
 #include <check_log.h>
+#include <check_print.h>
 #include "check_check.h"
 
 
@@ -36,9 +40,496 @@ START_TEST(test_init_logging_subunit)
 END_TEST
 #endif
 
+/* Escape str with fprint_xml_esc, returning what it wrote */
+static char *xml_esc_str(const char *str)
+{
+  FILE *f = tmpfile();
+  long len;
+  char *out;
+
+  ck_assert_msg(f != NULL, "Could not create temporary file");
+  fprint_xml_esc(f, str);
+  len = ftell(f);
+  rewind(f);
+  out = (char *)malloc(len + 1);
+  ck_assert_int_eq(fread(out, 1, len, f), len);
+  out[len] = '\0';
+  fclose(f);
+  return out;
+}
+
+START_TEST(test_xml_esc)
+{
+  char *out = xml_esc_str("a \" ' < > & b");
+
+  ck_assert_str_eq(out, "a &quot; &apos; &lt; &gt; &amp; b");
+  free(out);
+  out = xml_esc_str("");
+  ck_assert_str_eq(out, "");
+  free(out);
+}
+END_TEST
+
+START_TEST(test_xml_esc_control_chars)
+{
+  char *out = xml_esc_str("tab\tnl\ncr\r\001\033[0m\037\177");
+
+  ck_assert_str_eq(out, "tab\tnl\ncr\r\\x01\\x1b[0m\\x1f\177");
+  free(out);
+}
+END_TEST
+
+/*
+ * Put a character to escape at every position of strings of every
+ * length, starting at every alignment, to cover the block-wise scan.
+ */
+START_TEST(test_xml_esc_positions)
+{
+  char buf[16 + 80];
+  int offset, len, pos;
+
+  for(offset = 0; offset < 16; offset++)
+  {
+    for(len = 0; len < 72; len++)
+    {
+      for(pos = 0; pos <= len; pos++)
+      {
+        char *str = buf + offset;
+        char *out;
+
+        memset(str, 'x', len);
+        str[len] = '\0';
+        if(pos < len)
+          str[pos] = '<';
+        out = xml_esc_str(str);
+        if(pos < len)
+        {
+          ck_assert_uint_eq(strlen(out), len + 3);
+          ck_assert_msg(strncmp(out + pos, "&lt;", 4) == 0,
+                        "'<' at %d of %d not escaped: %s", pos, len, out);
+        }
+        else
+        {
+          ck_assert_str_eq(out, str);
+        }
+        free(out);
+      }
+    }
+  }
+}
+END_TEST
+
+START_TEST(test_jsonl_esc)
+{
+  TestResult *tr = tr_create();
+  FILE *f = tmpfile();
+  char line[512];
+
+  ck_assert_msg(f != NULL, "Could not create temporary file");
+  tr->rtype = CK_ERROR;
+  tr->ctx = CK_CTX_TEARDOWN;
+  tr->file = strdup("dir\\file.c");
+  tr->line = 7;
+  tr->tcname = "tc";
+  tr->tname = "test";
+  tr->msg = strdup("\"quoted\"\ttab\nnewline\001");
+  tr_jsonprint(f, tr, NULL);
+  rewind(f);
+  ck_assert_ptr_ne(fgets(line, sizeof(line), f), NULL);
+  ck_assert_str_eq(line, "{\"suite\":null,\"tcase\":\"tc\",\"test\":\"test\","
+                   "\"iteration\":0,\"result\":\"error\",\"context\":\"teardown\","
+                   "\"file\":\"dir\\\\file.c\",\"line\":7,\"duration_ns\":null,"
+                   "\"user_ns\":null,\"system_ns\":null,\"rusage\":null,"
+                   "\"phases\":{\"setup_ns\":null,\"test_ns\":null,"
+                   "\"teardown_ns\":null,\"fork_ns\":null,\"reap_ns\":null,"
+                   "\"report_ns\":null},"
+                   "\"message\":\"\\\"quoted\\\"\\ttab\\nnewline\\u0001\"}\n");
+  fclose(f);
+  tr_free(tr);
+}
+END_TEST
+
+/* Whether a log has a line with str in it */
+static int log_has(FILE * f, const char *str)
+{
+  char line[1024];
+  int found = 0;
+
+  rewind(f);
+  while (!found && fgets(line, sizeof(line), f) != NULL)
+    found = strstr(line, str) != NULL;
+  return found;
+}
+
+/* Two JUnit logs written at once keep their own counts */
+START_TEST(test_junit_two_logs)
+{
+  SRunner *sr = srunner_create(NULL);
+  Suite *sa = suite_create("A");
+  Suite *sb = suite_create("B");
+  TestResult *tr = tr_create();
+  FILE *fa = tmpfile();
+  FILE *fb = tmpfile();
+  void *da = NULL;
+  void *db = NULL;
+
+  ck_assert_msg(fa != NULL && fb != NULL, "Could not create temporary file");
+  srunner_add_suite(sr, sa);
+  srunner_add_suite(sr, sb);
+  tr->ctx = CK_CTX_TEST;
+  tr->file = strdup("file.c");
+  tr->line = 7;
+  tr->tcname = "tc";
+  tr->tname = "test";
+  tr->msg = strdup("Failed");
+
+  junit_lfun(sr, fa, CK_NORMAL, NULL, CLINITLOG_SR, &da);
+  junit_lfun(sr, fa, CK_NORMAL, sa, CLSTART_S, &da);
+  tr->rtype = CK_FAILURE;
+  junit_lfun(sr, fa, CK_NORMAL, tr, CLEND_T, &da);
+
+  junit_lfun(sr, fb, CK_NORMAL, NULL, CLINITLOG_SR, &db);
+  junit_lfun(sr, fb, CK_NORMAL, sb, CLSTART_S, &db);
+  tr->rtype = CK_PASS;
+  junit_lfun(sr, fb, CK_NORMAL, tr, CLEND_T, &db);
+  junit_lfun(sr, fb, CK_NORMAL, tr, CLEND_T, &db);
+  junit_lfun(sr, fb, CK_NORMAL, sb, CLEND_S, &db);
+  junit_lfun(sr, fb, CK_NORMAL, NULL, CLENDLOG_SR, &db);
+
+  junit_lfun(sr, fa, CK_NORMAL, sa, CLEND_S, &da);
+  junit_lfun(sr, fa, CK_NORMAL, NULL, CLENDLOG_SR, &da);
+  ck_assert_ptr_eq(da, NULL);
+  ck_assert_ptr_eq(db, NULL);
+
+  ck_assert_msg(log_has(fa, "<testsuite name=\"A\" tests=\"1\" "
+                          "failures=\"1\" errors=\"0\""),
+                "Bad counts of suite A");
+  ck_assert_msg(log_has(fb, "<testsuite name=\"B\" tests=\"2\" "
+                          "failures=\"0\" errors=\"0\""),
+                "Bad counts of suite B");
+  fclose(fa);
+  fclose(fb);
+  tr_free(tr);
+  srunner_free(sr);
+}
+END_TEST
+
+/* Two JSON Lines logs written at once keep their own suites */
+START_TEST(test_jsonl_two_logs)
+{
+  SRunner *sr = srunner_create(NULL);
+  Suite *sa = suite_create("A");
+  Suite *sb = suite_create("B");
+  TestResult *tr = tr_create();
+  FILE *fa = tmpfile();
+  FILE *fb = tmpfile();
+  void *da = NULL;
+  void *db = NULL;
+
+  ck_assert_msg(fa != NULL && fb != NULL, "Could not create temporary file");
+  srunner_add_suite(sr, sa);
+  srunner_add_suite(sr, sb);
+  tr->rtype = CK_PASS;
+  tr->ctx = CK_CTX_TEST;
+  tr->tcname = "tc";
+  tr->tname = "test";
+
+  jsonl_lfun(sr, fa, CK_NORMAL, NULL, CLINITLOG_SR, &da);
+  jsonl_lfun(sr, fa, CK_NORMAL, sa, CLSTART_S, &da);
+  jsonl_lfun(sr, fb, CK_NORMAL, NULL, CLINITLOG_SR, &db);
+  jsonl_lfun(sr, fb, CK_NORMAL, sb, CLSTART_S, &db);
+  jsonl_lfun(sr, fa, CK_NORMAL, tr, CLEND_T, &da);
+  jsonl_lfun(sr, fb, CK_NORMAL, tr, CLEND_T, &db);
+  jsonl_lfun(sr, fa, CK_NORMAL, NULL, CLENDLOG_SR, &da);
+  jsonl_lfun(sr, fb, CK_NORMAL, NULL, CLENDLOG_SR, &db);
+
+  ck_assert_msg(log_has(fa, "{\"suite\":\"A\","), "Bad suite in log A");
+  ck_assert_msg(log_has(fb, "{\"suite\":\"B\","), "Bad suite in log B");
+  fclose(fa);
+  fclose(fb);
+  tr_free(tr);
+  srunner_free(sr);
+}
+END_TEST
+
+/* Two benchmark JSON logs written at once count their own benchmarks */
+START_TEST(test_bench_json_two_logs)
+{
+  SRunner *sr = srunner_create(NULL);
+  Suite *sa = suite_create("A");
+  Suite *sb = suite_create("B");
+  TestResult *tr = tr_create();
+  BenchResult bench;
+  double sample = 10;
+  FILE *fa = tmpfile();
+  FILE *fb = tmpfile();
+  void *da = NULL;
+  void *db = NULL;
+
+  ck_assert_msg(fa != NULL && fb != NULL, "Could not create temporary file");
+  srunner_add_suite(sr, sa);
+  srunner_add_suite(sr, sb);
+  memset(&bench, 0, sizeof(bench));
+  bench.iterations = 1;
+  bench.nsamples = 1;
+  bench.samples = &sample;
+  tr->rtype = CK_PASS;
+  tr->ctx = CK_CTX_TEST;
+  tr->tcname = "tc";
+  tr->tname = "test";
+  tr->bench = &bench;
+
+  bench_json_lfun(sr, fa, CK_NORMAL, NULL, CLINITLOG_SR, &da);
+  bench_json_lfun(sr, fa, CK_NORMAL, sa, CLSTART_S, &da);
+  bench_json_lfun(sr, fa, CK_NORMAL, tr, CLEND_T, &da);
+  bench_json_lfun(sr, fb, CK_NORMAL, NULL, CLINITLOG_SR, &db);
+  bench_json_lfun(sr, fb, CK_NORMAL, sb, CLSTART_S, &db);
+  bench_json_lfun(sr, fa, CK_NORMAL, tr, CLEND_T, &da);
+  bench_json_lfun(sr, fb, CK_NORMAL, tr, CLEND_T, &db);
+  bench_json_lfun(sr, fa, CK_NORMAL, NULL, CLENDLOG_SR, &da);
+  bench_json_lfun(sr, fb, CK_NORMAL, NULL, CLENDLOG_SR, &db);
+  ck_assert_ptr_eq(da, NULL);
+  ck_assert_ptr_eq(db, NULL);
+
+  /* the first benchmark of each log has no comma before it */
+  ck_assert_msg(!log_has(fa, "[,"), "Comma before the first benchmark");
+  ck_assert_msg(!log_has(fb, "[,"), "Comma before the first benchmark");
+  ck_assert_msg(log_has(fb, "\"name\": \"B/tc/test\""),
+                "Bad suite in log B");
+  fclose(fa);
+  fclose(fb);
+  tr->bench = NULL;
+  tr_free(tr);
+  srunner_free(sr);
+}
+END_TEST
+
+#define BINLOG_TEST_FILE "check_test_binlog.ckb"
+
+/* Write a suite and two results to BINLOG_TEST_FILE, returning its size */
+static long write_test_binlog(void)
+{
+  FILE *f = fopen(BINLOG_TEST_FILE, "wb");
+  BinLogWriter *w;
+  TestResult *tr = tr_create();
+  PerfSample ps;
+  static const int64_t bench_ps[3] = { 3000, 1500, 2000 };
+  static const int64_t bench_cpu_ps[3] = { 2500, 1000, 1500 };
+  BenchResult *br = bench_result_create(10, bench_ps, bench_cpu_ps, 3);
+  long size;
+
+  ck_assert_msg(f != NULL, "Could not create " BINLOG_TEST_FILE);
+  w = binlog_writer_create(f);
+  binlog_write_suite(w, "suite");
+  tr->rtype = CK_PASS;
+  tr->ctx = CK_CTX_TEST;
+  tr->file = strdup("file.c");
+  tr->line = 7;
+  tr->iter = 2;
+  /* more than fits in 32 bits */
+  tr->duration = 5000000001234LL;
+  tr->utime = 1000;
+  tr->stime = 0;
+  tr->rusage.maxrss = 2048;
+  tr->rusage.minflt = 3;
+  tr->rusage.majflt = 0;
+  tr->rusage.nvcsw = 1;
+  tr->rusage.nivcsw = 0;
+  tr->rusage.inblock = 0;
+  tr->rusage.oublock = 5;
+  tr->allocs.allocs = 4;
+  tr->allocs.bytes = 4096;
+  tr->allocs.peak_bytes = 1024;
+  tr->allocs.leaks = 1;
+  tr->allocs.leaked_bytes = 16;
+  ps.n = 2;
+  ps.names[0] = "task-clock";
+  ps.names[1] = "instructions";
+  ps.values[0] = 5000000001LL;
+  ps.values[1] = -1;
+  tr->perf = &ps;
+  tr->bench = br;
+  tr->tcname = "tc";
+  tr->tname = "test";
+  tr->msg = strdup("Passed");
+  binlog_write_result(w, tr);
+  tr->rtype = CK_FAILURE;
+  tr->duration = -1;
+  tr->rusage.maxrss = -1;
+  tr->allocs.leaks = -1;
+  tr->perf = NULL;
+  tr->bench = NULL;
+  tr->tname = "test2";
+  free(tr->msg);
+  tr->msg = NULL;
+  binlog_write_result(w, tr);
+  binlog_writer_free(w);
+  size = ftell(f);
+  fclose(f);
+  tr_free(tr);
+  bench_result_free(br);
+  return size;
+}
+
+START_TEST(test_binlog_round_trip)
+{
+  BinLogReader *r;
+  const char *tcname;
+
+  write_test_binlog();
+  r = binlog_reader_open(BINLOG_TEST_FILE);
+  ck_assert_ptr_ne(r, NULL);
+
+  ck_assert_int_eq(binlog_read(r), BINLOG_SUITE);
+  ck_assert_str_eq(r->sname, "suite");
+
+  ck_assert_int_eq(binlog_read(r), BINLOG_RESULT);
+  ck_assert_int_eq(r->tr.rtype, CK_PASS);
+  ck_assert_int_eq(r->tr.ctx, CK_CTX_TEST);
+  ck_assert_str_eq(r->tr.file, "file.c");
+  ck_assert_int_eq(r->tr.line, 7);
+  ck_assert_int_eq(r->tr.iter, 2);
+  ck_assert_int_eq(r->tr.duration, 5000000001234LL);
+  ck_assert_int_eq(r->tr.utime, 1000);
+  ck_assert_int_eq(r->tr.stime, 0);
+  ck_assert_int_eq(r->tr.rusage.maxrss, 2048);
+  ck_assert_int_eq(r->tr.rusage.minflt, 3);
+  ck_assert_int_eq(r->tr.rusage.nvcsw, 1);
+  ck_assert_int_eq(r->tr.rusage.oublock, 5);
+  ck_assert_int_eq(r->tr.allocs.allocs, 4);
+  ck_assert_int_eq(r->tr.allocs.bytes, 4096);
+  ck_assert_int_eq(r->tr.allocs.peak_bytes, 1024);
+  ck_assert_int_eq(r->tr.allocs.leaks, 1);
+  ck_assert_int_eq(r->tr.allocs.leaked_bytes, 16);
+  ck_assert_ptr_ne(r->tr.perf, NULL);
+  ck_assert_int_eq(r->tr.perf->n, 2);
+  ck_assert_str_eq(r->tr.perf->names[0], "task-clock");
+  ck_assert_str_eq(r->tr.perf->names[1], "instructions");
+  ck_assert_int_eq(r->tr.perf->values[0], 5000000001LL);
+  ck_assert_int_eq(r->tr.perf->values[1], -1);
+  ck_assert_ptr_ne(r->tr.bench, NULL);
+  ck_assert_int_eq(r->tr.bench->iterations, 10);
+  ck_assert_int_eq(r->tr.bench->nsamples, 3);
+  ck_assert(r->tr.bench->samples[0] == 1.5 && r->tr.bench->samples[2] == 3);
+  ck_assert(r->tr.bench->median == 2);
+  ck_assert_ptr_ne(r->tr.bench->cpu_samples, NULL);
+  ck_assert(r->tr.bench->cpu_samples[0] == 1);
+  ck_assert(r->tr.bench->cpu_samples[2] == 2.5);
+  ck_assert_str_eq(r->tr.tcname, "tc");
+  ck_assert_str_eq(r->tr.tname, "test");
+  ck_assert_str_eq(r->tr.msg, "Passed");
+  tcname = r->tr.tcname;
+
+  ck_assert_int_eq(binlog_read(r), BINLOG_RESULT);
+  ck_assert_int_eq(r->tr.rtype, CK_FAILURE);
+  ck_assert_int_eq(r->tr.duration, -1);
+  ck_assert_int_eq(r->tr.rusage.maxrss, -1);
+  ck_assert_int_eq(r->tr.allocs.leaks, -1);
+  ck_assert_ptr_eq(r->tr.perf, NULL);
+  ck_assert_ptr_eq(r->tr.bench, NULL);
+  ck_assert_str_eq(r->tr.tname, "test2");
+  ck_assert_ptr_eq(r->tr.msg, NULL);
+  /* strings are only written the first time */
+  ck_assert_ptr_eq(r->tr.tcname, tcname);
+
+  ck_assert_int_eq(binlog_read(r), BINLOG_END);
+  binlog_reader_close(r);
+  remove(BINLOG_TEST_FILE);
+}
+END_TEST
+
+START_TEST(test_binlog_truncated)
+{
+  long size = write_test_binlog();
+  BinLogReader *r;
+  FILE *f;
+  char *data = (char *)malloc(size);
+
+  /* cut the last result short */
+  f = fopen(BINLOG_TEST_FILE, "rb");
+  ck_assert_int_eq(fread(data, 1, size, f), size);
+  fclose(f);
+  f = fopen(BINLOG_TEST_FILE, "wb");
+  fwrite(data, 1, size - 1, f);
+  fclose(f);
+  free(data);
+
+  r = binlog_reader_open(BINLOG_TEST_FILE);
+  ck_assert_ptr_ne(r, NULL);
+  ck_assert_int_eq(binlog_read(r), BINLOG_SUITE);
+  ck_assert_int_eq(binlog_read(r), BINLOG_RESULT);
+  ck_assert_int_eq(binlog_read(r), BINLOG_BAD);
+  binlog_reader_close(r);
+  remove(BINLOG_TEST_FILE);
+}
+END_TEST
+
+#define BINLOG_TEST_FILE2 "check_test_binlog2.ckb"
+
+/* Check that the binary log fname has just the suite sname and a result */
+static void check_one_suite_binlog(const char *fname, const char *sname)
+{
+  BinLogReader *r = binlog_reader_open(fname);
+
+  ck_assert_ptr_ne(r, NULL);
+  ck_assert_int_eq(binlog_read(r), BINLOG_SUITE);
+  ck_assert_str_eq(r->sname, sname);
+  ck_assert_int_eq(binlog_read(r), BINLOG_RESULT);
+  ck_assert_str_eq(r->tr.tname, "test");
+  ck_assert_int_eq(binlog_read(r), BINLOG_END);
+  binlog_reader_close(r);
+}
+
+/* Two binary logs written at once keep their own writers */
+START_TEST(test_binlog_two_logs)
+{
+  SRunner *sr = srunner_create(NULL);
+  Suite *sa = suite_create("A");
+  Suite *sb = suite_create("B");
+  TestResult *tr = tr_create();
+  FILE *fa = fopen(BINLOG_TEST_FILE, "wb");
+  FILE *fb = fopen(BINLOG_TEST_FILE2, "wb");
+  void *da = NULL;
+  void *db = NULL;
+
+  ck_assert_msg(fa != NULL && fb != NULL, "Could not create binary logs");
+  srunner_add_suite(sr, sa);
+  srunner_add_suite(sr, sb);
+  tr->rtype = CK_PASS;
+  tr->ctx = CK_CTX_TEST;
+  tr->tcname = "tc";
+  tr->tname = "test";
+
+  bin_lfun(sr, fa, CK_NORMAL, NULL, CLINITLOG_SR, &da);
+  bin_lfun(sr, fb, CK_NORMAL, NULL, CLINITLOG_SR, &db);
+  bin_lfun(sr, fa, CK_NORMAL, sa, CLSTART_S, &da);
+  bin_lfun(sr, fb, CK_NORMAL, sb, CLSTART_S, &db);
+  bin_lfun(sr, fa, CK_NORMAL, tr, CLEND_T, &da);
+  bin_lfun(sr, fb, CK_NORMAL, tr, CLEND_T, &db);
+  bin_lfun(sr, fa, CK_NORMAL, NULL, CLENDLOG_SR, &da);
+  bin_lfun(sr, fb, CK_NORMAL, NULL, CLENDLOG_SR, &db);
+  ck_assert_ptr_eq(da, NULL);
+  ck_assert_ptr_eq(db, NULL);
+  fclose(fa);
+  fclose(fb);
+
+  check_one_suite_binlog(BINLOG_TEST_FILE, "A");
+  check_one_suite_binlog(BINLOG_TEST_FILE2, "B");
+  remove(BINLOG_TEST_FILE);
+  remove(BINLOG_TEST_FILE2);
+  tr_free(tr);
+  srunner_free(sr);
+}
+END_TEST
+
 Suite *make_log_internal_suite(void)
 {
   Suite *s;
+  TCase *tc_xml_esc;
+  TCase *tc_jsonl;
+  TCase *tc_junit;
+  TCase *tc_bench_json;
+  TCase *tc_binlog;
 
 #if ENABLE_SUBUNIT
   TCase *tc_core_subunit;
@@ -49,7 +540,32 @@ Suite *make_log_internal_suite(void)
 #else
   s = suite_create("Log");
 #endif
-  
+
+  tc_xml_esc = tcase_create("XML Escape");
+  suite_add_tcase(s, tc_xml_esc);
+  tcase_add_test(tc_xml_esc, test_xml_esc);
+  tcase_add_test(tc_xml_esc, test_xml_esc_control_chars);
+  tcase_add_test(tc_xml_esc, test_xml_esc_positions);
+
+  tc_jsonl = tcase_create("JSON Lines");
+  suite_add_tcase(s, tc_jsonl);
+  tcase_add_test(tc_jsonl, test_jsonl_esc);
+  tcase_add_test(tc_jsonl, test_jsonl_two_logs);
+
+  tc_junit = tcase_create("JUnit");
+  suite_add_tcase(s, tc_junit);
+  tcase_add_test(tc_junit, test_junit_two_logs);
+
+  tc_bench_json = tcase_create("Benchmark JSON");
+  suite_add_tcase(s, tc_bench_json);
+  tcase_add_test(tc_bench_json, test_bench_json_two_logs);
+
+  tc_binlog = tcase_create("Binary");
+  suite_add_tcase(s, tc_binlog);
+  tcase_add_test(tc_binlog, test_binlog_round_trip);
+  tcase_add_test(tc_binlog, test_binlog_truncated);
+  tcase_add_test(tc_binlog, test_binlog_two_logs);
+
   return s;
 }
 
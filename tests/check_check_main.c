@@ -16,9 +16,18 @@ int main (void)
 
   sr = srunner_create (make_master_suite());
   srunner_add_suite(sr, make_list_suite());
+  srunner_add_suite(sr, make_arena_suite());
+  srunner_add_suite(sr, make_stats_suite());
   srunner_add_suite(sr, make_msg_suite());
   srunner_add_suite(sr, make_log_suite());
   srunner_add_suite(sr, make_log_internal_suite());
+  srunner_add_suite(sr, make_streaming_suite());
+  srunner_add_suite(sr, make_times_suite());
+  srunner_add_suite(sr, make_perf_suite());
+  srunner_add_suite(sr, make_bench_suite());
+  srunner_add_suite(sr, make_alloc_suite());
+  srunner_add_suite(sr, make_phases_suite());
+  srunner_add_suite(sr, make_rusage_suite());
   srunner_add_suite(sr, make_limit_suite());
   srunner_add_suite(sr, make_fork_suite());
   srunner_add_suite(sr, make_fixture_suite());
@@ -5,14 +5,16 @@
 #include <string.h>
 
 #include "check.h"
-#include "check_msg.h"
-#include "check_check.h"
+#include "check_arena.h"
 #include "check_list.h"
 #include "check_impl.h"
+#include "check_msg.h"
+#include "check_check.h"
 
 START_TEST(test_send)
 {
   TestResult *tr;
+  Arena *arena = arena_create();
   setup_messaging();
   send_ctx_info(CK_CTX_SETUP);
   send_loc_info("abc123.c", 10);
@@ -20,8 +22,9 @@ START_TEST(test_send)
   send_loc_info("abc124.c", 22);
   send_loc_info("abc125.c", 25);
   send_failure_info("Oops");
-  tr = receive_test_result(0);
+  tr = receive_test_result(arena, 0);
   teardown_messaging();
+  arena_free(arena);
 
   ck_assert_msg (tr != NULL,
 	       "No test result received");
@@ -41,6 +44,7 @@ END_TEST
 START_TEST(test_send_big)
 {
   TestResult *tr;
+  Arena *arena = arena_create();
   int i;
   
   setup_messaging();
@@ -51,8 +55,9 @@ START_TEST(test_send_big)
     send_loc_info("abc124.c", i);
   }
 
-  tr = receive_test_result(0);
+  tr = receive_test_result(arena, 0);
   teardown_messaging();
+  arena_free(arena);
 
   ck_assert_msg (tr != NULL,
 	       "No test result received");
@@ -71,14 +76,16 @@ END_TEST
 START_TEST(test_send_test_error)
 {
   TestResult *tr;
+  Arena *arena = arena_create();
   setup_messaging();
   send_ctx_info(CK_CTX_SETUP);
   send_loc_info("abc123.c", 10);
   send_ctx_info(CK_CTX_TEST);
   send_loc_info("abc124.c", 22);
   send_loc_info("abc125.c", 25);
-  tr = receive_test_result(1);
+  tr = receive_test_result(arena, 1);
   teardown_messaging();
+  arena_free(arena);
 
   ck_assert_msg (tr != NULL,
 	       "No test result received");
@@ -96,6 +103,7 @@ END_TEST
 START_TEST(test_send_with_passing_teardown)
 {
   TestResult *tr;
+  Arena *arena = arena_create();
   setup_messaging();
   send_ctx_info(CK_CTX_SETUP);
   send_loc_info("abc123.c", 10);
@@ -104,8 +112,9 @@ START_TEST(test_send_with_passing_teardown)
   send_loc_info("abc125.c", 25);
   send_ctx_info(CK_CTX_TEARDOWN);
   send_loc_info("abc126.c", 54);
-  tr = receive_test_result(0);
+  tr = receive_test_result(arena, 0);
   teardown_messaging();
+  arena_free(arena);
 
   ck_assert_msg (tr != NULL,
 	       "No test result received");
@@ -125,6 +134,7 @@ END_TEST
 START_TEST(test_send_with_error_teardown)
 {
   TestResult *tr;
+  Arena *arena = arena_create();
   setup_messaging();
   send_ctx_info(CK_CTX_SETUP);
   send_loc_info("abc123.c", 10);
@@ -133,8 +143,9 @@ START_TEST(test_send_with_error_teardown)
   send_loc_info("abc125.c", 25);
   send_ctx_info(CK_CTX_TEARDOWN);
   send_loc_info("abc126.c", 54);
-  tr = receive_test_result(1);
+  tr = receive_test_result(arena, 1);
   teardown_messaging();
+  arena_free(arena);
 
   ck_assert_msg (tr != NULL,
 	       "No test result received");
@@ -5,6 +5,9 @@
 #include <string.h>
 
 #include "check.h"
+#include "check_arena.h"
+#include "check_list.h"
+#include "check_impl.h"
 #include "check_pack.h"
 #include "check_error.h"
 #include "check_check.h"
@@ -46,6 +49,40 @@ START_TEST(test_pack_fmsg)
 }
 END_TEST
 
+START_TEST(test_pack_duration)
+{
+  DurationMsg dmsg;
+  char *buf;
+  enum ck_msg_type type;
+  int len;
+
+  /* an hour in nanoseconds does not fit in 32 bits */
+  dmsg.duration = (int64_t) 3600 * 1000000000;
+  dmsg.setup = 1;
+  dmsg.teardown = 2;
+  dmsg.end = (int64_t) 86400 * 1000000000;
+  len = pack (CK_MSG_DURATION, &buf, (CheckMsg *) &dmsg);
+  dmsg.duration = dmsg.setup = dmsg.teardown = dmsg.end = 0;
+  ck_assert_int_eq (upack (buf, (CheckMsg *) &dmsg, &type), len);
+  ck_assert_int_eq (type, CK_MSG_DURATION);
+  ck_assert_int_eq (dmsg.duration, (int64_t) 3600 * 1000000000);
+  ck_assert_int_eq (dmsg.setup, 1);
+  ck_assert_int_eq (dmsg.teardown, 2);
+  ck_assert_int_eq (dmsg.end, (int64_t) 86400 * 1000000000);
+  free (buf);
+
+  dmsg.duration = dmsg.setup = dmsg.teardown = dmsg.end = -1;
+  pack (CK_MSG_DURATION, &buf, (CheckMsg *) &dmsg);
+  dmsg.duration = dmsg.setup = dmsg.teardown = dmsg.end = 0;
+  upack (buf, (CheckMsg *) &dmsg, &type);
+  ck_assert_int_eq (dmsg.duration, -1);
+  ck_assert_int_eq (dmsg.setup, -1);
+  ck_assert_int_eq (dmsg.teardown, -1);
+  ck_assert_int_eq (dmsg.end, -1);
+  free (buf);
+}
+END_TEST
+
 START_TEST(test_pack_loc)
 {
   LocMsg *lmsg;
@@ -222,6 +259,7 @@ START_TEST(test_ppack)
   LocMsg lmsg;
   FailMsg fmsg;
   RcvMsg *rmsg;
+  Arena *arena = arena_create();
   
   cmsg.ctx = CK_CTX_TEST;
   lmsg.file = (char *) "abc123.c";
@@ -234,7 +272,7 @@ START_TEST(test_ppack)
   ppack (result_file, CK_MSG_FAIL, (CheckMsg *) &fmsg);
 
   rewind(result_file);
-  rmsg = punpack (result_file);
+  rmsg = punpack (result_file, arena);
 
   ck_assert_msg (rmsg != NULL,
 	       "Return value from ppack should always be malloc'ed");
@@ -251,7 +289,7 @@ START_TEST(test_ppack)
   ck_assert_msg (strcmp(rmsg->msg, "oops") == 0,
 	       "Failure message not received correctly");
 
-  free(rmsg);
+  arena_free (arena);
   fclose(result_file);
 }
 END_TEST
@@ -263,6 +301,7 @@ START_TEST(test_ppack_noctx)
   LocMsg lmsg;
   FailMsg fmsg;
   RcvMsg *rmsg;
+  Arena *arena = arena_create();
   
   lmsg.file = (char *) "abc123.c";
   lmsg.line = 10;
@@ -273,13 +312,12 @@ START_TEST(test_ppack_noctx)
   ppack (result_file, CK_MSG_FAIL, (CheckMsg *) &fmsg);
 
   rewind(result_file);
-  rmsg = punpack (result_file);
+  rmsg = punpack (result_file, arena);
 
   ck_assert_msg (rmsg == NULL,
 	       "Result should be NULL with no CTX");
 
-  if (rmsg != NULL)
-    free (rmsg);
+  arena_free (arena);
   fclose(result_file);
 }
 END_TEST
@@ -290,13 +328,14 @@ START_TEST(test_ppack_onlyctx)
   char * result_file_name = NULL;
   CtxMsg cmsg;
   RcvMsg *rmsg;
+  Arena *arena = arena_create();
   
   cmsg.ctx = CK_CTX_SETUP;
   result_file = open_tmp_file(&result_file_name);
   free(result_file_name);
   ppack (result_file, CK_MSG_CTX, (CheckMsg *) &cmsg);
   rewind(result_file);
-  rmsg = punpack (result_file);
+  rmsg = punpack (result_file, arena);
 
   ck_assert_msg (rmsg != NULL && rmsg->msg == NULL,
 	       "Result message should be NULL with only CTX");
@@ -305,8 +344,7 @@ START_TEST(test_ppack_onlyctx)
   ck_assert_msg (rmsg->test_line == -1,
 	       "Result loc line should be -1 with only CTX");
 
-  if (rmsg != NULL)
-    free (rmsg);
+  arena_free (arena);
   fclose(result_file);
 }
 END_TEST
@@ -318,6 +356,7 @@ START_TEST(test_ppack_multictx)
   CtxMsg cmsg;
   LocMsg lmsg;
   RcvMsg *rmsg;
+  Arena *arena = arena_create();
   
   cmsg.ctx = CK_CTX_SETUP;
   lmsg.line = 5;
@@ -332,7 +371,7 @@ START_TEST(test_ppack_multictx)
   cmsg.ctx = CK_CTX_TEARDOWN;
   ppack (result_file, CK_MSG_CTX, (CheckMsg *) &cmsg);
   rewind(result_file);
-  rmsg = punpack (result_file);
+  rmsg = punpack (result_file, arena);
 
   ck_assert_msg (rmsg != NULL && rmsg->test_line == 5,
 	       "Test loc not being preserved on CTX change");
@@ -340,7 +379,7 @@ START_TEST(test_ppack_multictx)
   ck_assert_msg (rmsg->fixture_line == -1,
 	       "Fixture not reset on CTX change");
 
-  free (rmsg);
+  arena_free (arena);
   fclose(result_file);
 }
 END_TEST
@@ -352,6 +391,7 @@ START_TEST(test_ppack_nofail)
   CtxMsg cmsg;
   LocMsg lmsg;
   RcvMsg *rmsg;
+  Arena *arena = arena_create();
 
   lmsg.file = (char *) "abc123.c";
   lmsg.line = 10;
@@ -361,12 +401,12 @@ START_TEST(test_ppack_nofail)
   ppack (result_file, CK_MSG_CTX, (CheckMsg *) &cmsg);
   ppack (result_file, CK_MSG_LOC, (CheckMsg *) &lmsg);
   rewind (result_file);
-  rmsg = punpack (result_file);
+  rmsg = punpack (result_file, arena);
 
   ck_assert_msg (rmsg != NULL && rmsg->msg == NULL,
 	       "Failure result should be NULL with no failure message");
   
-  free (rmsg);
+  arena_free (arena);
   fclose(result_file);
 }
 END_TEST
@@ -381,6 +421,7 @@ START_TEST(test_ppack_big)
   LocMsg lmsg;
   FailMsg fmsg;
   RcvMsg *rmsg;
+  Arena *arena = arena_create();
 
   cmsg.ctx = CK_CTX_TEST;
   lmsg.file = (char *)emalloc (BIG_MSG_LEN);
@@ -396,7 +437,7 @@ START_TEST(test_ppack_big)
   ppack (result_file, CK_MSG_LOC, (CheckMsg *) &lmsg);
   ppack (result_file, CK_MSG_FAIL, (CheckMsg *) &fmsg);
   rewind (result_file);
-  rmsg = punpack (result_file);
+  rmsg = punpack (result_file, arena);
 
   ck_assert_msg (rmsg != NULL,
 	       "Return value from ppack should always be malloc'ed");
@@ -409,7 +450,7 @@ START_TEST(test_ppack_big)
   ck_assert_msg (strcmp (rmsg->msg, fmsg.msg) == 0,
 	       "Failure message not received correctly");
   
-  free (rmsg);
+  arena_free (arena);
   free (lmsg.file);
   free (fmsg.msg);
   fclose(result_file);
@@ -431,6 +472,7 @@ Suite *make_pack_suite(void)
   suite_add_tcase (s, tc_core);
   tcase_add_test (tc_core, test_pack_fmsg);
   tcase_add_test (tc_core, test_pack_loc);
+  tcase_add_test (tc_core, test_pack_duration);
   tcase_add_test (tc_core, test_pack_ctx);
   tcase_add_test (tc_core, test_pack_len);
   tcase_add_test (tc_core, test_pack_abuse);
@@ -0,0 +1,75 @@
+#include "../lib/libcompat.h"
+
+#include <stdlib.h>
+#include <time.h>
+#include <check.h>
+#include "check_check.h"
+
+START_TEST(test_perf_counters_set)
+{
+  SRunner *sr = srunner_create(NULL);
+
+  srunner_set_perf_counters(sr, "cycles,page-faults");
+  ck_assert_str_eq(srunner_perf_counters(sr), "cycles,page-faults");
+  srunner_set_perf_counters(sr, "");
+  ck_assert_ptr_eq(srunner_perf_counters(sr), NULL);
+  srunner_free(sr);
+}
+END_TEST
+
+/* Spin for at least 20 milliseconds of CPU time */
+START_TEST(test_perf_busy)
+{
+  clock_t start = clock();
+
+  while(clock() - start < CLOCKS_PER_SEC / 50)
+    ;
+}
+END_TEST
+
+START_TEST(test_perf_counters_run)
+{
+  Suite *s = suite_create("Perf");
+  TCase *tc = tcase_create("Core");
+  SRunner *sr;
+  TestResult **trs;
+  int64_t task_clock;
+
+  suite_add_tcase(s, tc);
+  tcase_add_test(tc, test_perf_busy);
+  sr = srunner_create(s);
+  srunner_set_fork_status(sr, fork_statuses[_i]);
+  srunner_set_perf_counters(sr, "task-clock,instructions,page-faults");
+  srunner_run_all(sr, CK_SILENT);
+
+  trs = srunner_results(sr);
+  ck_assert_int_eq(tr_perf_counter(trs[0], "cycles"), -1);
+  task_clock = tr_perf_counter(trs[0], "task-clock");
+  /* -1 where perf_event_open() is missing or not allowed */
+  if(task_clock != -1)
+  {
+    /* counted in nanoseconds, and in the child in fork mode */
+    ck_assert_int_ge(task_clock, 10000000);
+    ck_assert_int_ge(tr_perf_counter(trs[0], "page-faults"), 0);
+  }
+  else
+    ck_assert_int_eq(tr_perf_counter(trs[0], "page-faults"), -1);
+  free(trs);
+  srunner_free(sr);
+}
+END_TEST
+
+Suite *make_perf_suite(void)
+{
+  Suite *s;
+  TCase *tc;
+
+  s = suite_create("Perf Counters");
+  tc = tcase_create("Core");
+
+  suite_add_tcase(s, tc);
+  tcase_add_test(tc, test_perf_counters_set);
+  tcase_add_loop_test(tc, test_perf_counters_run, 0, nfork_statuses);
+
+  return s;
+}
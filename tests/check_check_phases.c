@@ -0,0 +1,191 @@
+#include "../lib/libcompat.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <check.h>
+#include "check_check.h"
+
+START_TEST(test_phases_pass)
+{
+}
+END_TEST
+
+START_TEST(test_phases_fail)
+{
+  ck_abort_msg("Phases failure");
+}
+END_TEST
+
+/* Spin for at least 20 milliseconds of CPU time */
+START_TEST(test_phases_spin)
+{
+  clock_t start = clock();
+
+  while(clock() - start < CLOCKS_PER_SEC / 50)
+    ;
+}
+END_TEST
+
+/* Spin for at least 10 milliseconds of CPU time */
+static void phases_busy(void)
+{
+  clock_t start = clock();
+
+  while(clock() - start < CLOCKS_PER_SEC / 100)
+    ;
+}
+
+#if defined(HAVE_FORK) && HAVE_FORK==1
+START_TEST(test_phases_crash)
+{
+  raise(SIGSEGV);
+}
+END_TEST
+#endif /* HAVE_FORK */
+
+START_TEST(test_phases_run)
+{
+  enum fork_status fstat = fork_statuses[_i];
+  Suite *s = suite_create("Phases");
+  TCase *tc = tcase_create("Core");
+  SRunner *sr;
+  TestResult **trs;
+  int i;
+
+  suite_add_tcase(s, tc);
+  tcase_add_checked_fixture(tc, phases_busy, phases_busy);
+  tcase_add_test(tc, test_phases_spin);
+  tcase_add_test(tc, test_phases_fail);
+#if defined(HAVE_FORK) && HAVE_FORK==1
+  if(fstat == CK_FORK)
+    tcase_add_test(tc, test_phases_crash);
+#endif /* HAVE_FORK */
+  sr = srunner_create(s);
+  srunner_set_fork_status(sr, fstat);
+  srunner_run_all(sr, CK_SILENT);
+
+  trs = srunner_results(sr);
+  ck_assert_int_ge(tr_phase_ns(trs[0], CK_PHASE_SETUP), 10000000);
+  ck_assert_int_ge(tr_phase_ns(trs[0], CK_PHASE_TEST), 20000000);
+  ck_assert_int_eq(tr_phase_ns(trs[0], CK_PHASE_TEST),
+                   tr_duration_ns(trs[0]));
+  ck_assert_int_ge(tr_phase_ns(trs[0], CK_PHASE_TEARDOWN), 10000000);
+  ck_assert_int_ge(tr_phase_ns(trs[0], CK_PHASE_REPORT), 0);
+  ck_assert_int_ge(tr_phase_ns(trs[1], CK_PHASE_REPORT), 0);
+  if(fstat == CK_FORK)
+  {
+    for(i = 0; i < 2; i++)
+    {
+      ck_assert_int_ge(tr_phase_ns(trs[i], CK_PHASE_FORK), 0);
+    }
+    ck_assert_int_ge(tr_phase_ns(trs[0], CK_PHASE_REAP), 0);
+    /* the process of a failed test says when it was done, but not what
+       its fixtures took, and that of a crashed one says nothing */
+    ck_assert_int_eq(tr_phase_ns(trs[1], CK_PHASE_SETUP), -1);
+    ck_assert_int_ge(tr_phase_ns(trs[1], CK_PHASE_REAP), 0);
+    ck_assert_int_eq(tr_rtype(trs[2]), CK_ERROR);
+    ck_assert_int_ge(tr_phase_ns(trs[2], CK_PHASE_FORK), 0);
+    ck_assert_int_eq(tr_phase_ns(trs[2], CK_PHASE_REAP), -1);
+    ck_assert_int_ge(srunner_phase_ns(sr, CK_PHASE_SETUP), 10000000);
+  }
+  else
+  {
+    for(i = 0; i < 2; i++)
+    {
+      ck_assert_int_eq(tr_phase_ns(trs[i], CK_PHASE_FORK), -1);
+      ck_assert_int_eq(tr_phase_ns(trs[i], CK_PHASE_REAP), -1);
+    }
+    ck_assert_int_ge(tr_phase_ns(trs[1], CK_PHASE_SETUP), 10000000);
+    ck_assert_int_ge(tr_phase_ns(trs[1], CK_PHASE_TEARDOWN), 10000000);
+    ck_assert_int_ge(srunner_phase_ns(sr, CK_PHASE_SETUP), 20000000);
+  }
+  ck_assert_int_eq(tr_phase_ns(trs[0], (enum ck_phase) 100), -1);
+  ck_assert_int_ge(srunner_phase_ns(sr, CK_PHASE_TEST), 20000000);
+  ck_assert_int_ge(srunner_phase_ns(sr, CK_PHASE_REPORT),
+                   tr_phase_ns(trs[0], CK_PHASE_REPORT));
+  free(trs);
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_phase_summary)
+{
+  Suite *s = suite_create("Phases");
+  TCase *tc = tcase_create("Core");
+  SRunner *sr;
+  FILE *f;
+  char line[256];
+  int nphases = 0;
+  int other = 0;
+
+  suite_add_tcase(s, tc);
+  tcase_add_test(tc, test_phases_pass);
+  sr = srunner_create(s);
+  ck_assert_msg(!srunner_phase_summary(sr), "Phase summary by default");
+  srunner_set_phase_summary(sr, 1);
+  ck_assert_msg(srunner_phase_summary(sr), "No phase summary once set");
+  srunner_set_log(sr, "test_phases.log");
+  srunner_run_all(sr, CK_SILENT);
+
+  f = fopen("test_phases.log", "r");
+  ck_assert_msg(f != NULL, "Log not written");
+  while(fgets(line, sizeof(line), f) != NULL)
+  {
+    if(strcmp(line, "Phases:\n") == 0)
+      nphases++;
+    else if(strncmp(line, "  other ", 8) == 0 && strchr(line, '%') != NULL)
+      other++;
+  }
+  fclose(f);
+  remove("test_phases.log");
+  ck_assert_int_eq(nphases, 1);
+  ck_assert_int_eq(other, 1);
+
+  srunner_free(sr);
+}
+END_TEST
+
+#if HAVE_DECL_SETENV
+START_TEST(test_phase_summary_env)
+{
+  const char *old_val;
+  Suite *s = suite_create("Suite");
+  SRunner *sr = srunner_create(s);
+
+  ck_assert_msg(save_set_env("CK_PHASE_SUMMARY", "yes", &old_val) == 0,
+              "Failed to set environment variable");
+  ck_assert_msg(srunner_phase_summary(sr), "No phase summary from env");
+
+  /* an explicit call overrides the environment variable */
+  srunner_set_phase_summary(sr, 0);
+  ck_assert_msg(!srunner_phase_summary(sr),
+                "Env overrides srunner_set_phase_summary");
+
+  ck_assert_msg(restore_env("CK_PHASE_SUMMARY", old_val) == 0,
+              "Failed to restore environment variable");
+
+  srunner_free(sr);
+}
+END_TEST
+#endif /* HAVE_DECL_SETENV */
+
+Suite *make_phases_suite(void)
+{
+  Suite *s;
+  TCase *tc;
+
+  s = suite_create("Phases");
+  tc = tcase_create("Core");
+
+  suite_add_tcase(s, tc);
+  tcase_add_loop_test(tc, test_phases_run, 0, nfork_statuses);
+  tcase_add_test(tc, test_phase_summary);
+#if HAVE_DECL_SETENV
+  tcase_add_test(tc, test_phase_summary_env);
+#endif /* HAVE_DECL_SETENV */
+
+  return s;
+}
@@ -0,0 +1,71 @@
+#include "../lib/libcompat.h"
+
+/* Tests for the resource usage of tests, which is not exported. */
+
+#include <stdlib.h>
+#include <check.h>
+#include <check_list.h>
+#include <check_impl.h>
+#include "check_check.h"
+
+#if defined(HAVE_SYS_RESOURCE_H) && defined(HAVE_FORK) && HAVE_FORK==1 && defined(HAVE_WAIT4)
+#define RUSAGE_TEST_SIZE (8 * 1024 * 1024)
+
+/* Touch RUSAGE_TEST_SIZE bytes, which have to be faulted in. The
+   writes go through a volatile pointer, as a memset of a block freed
+   right after is a dead store the compiler may drop */
+START_TEST(test_rusage_touch)
+{
+  volatile char *buf = (volatile char *) malloc(RUSAGE_TEST_SIZE);
+  size_t i;
+
+  ck_assert_ptr_ne((void *) buf, NULL);
+  for (i = 0; i < RUSAGE_TEST_SIZE; i += 512)
+    buf[i] = 1;
+  free((void *) buf);
+}
+END_TEST
+
+START_TEST(test_rusage_fork)
+{
+  Suite *s = suite_create("Rusage");
+  TCase *tc = tcase_create("Core");
+  SRunner *sr;
+  TestResult **trs;
+
+  suite_add_tcase(s, tc);
+  tcase_add_test(tc, test_rusage_touch);
+  sr = srunner_create(s);
+  srunner_set_fork_status(sr, CK_FORK);
+  srunner_run_all(sr, CK_SILENT);
+
+  trs = srunner_results(sr);
+  ck_assert_int_eq(tr_rtype(trs[0]), CK_PASS);
+  ck_assert_int_ge(trs[0]->rusage.maxrss, RUSAGE_TEST_SIZE / 1024);
+  ck_assert_int_gt(trs[0]->rusage.minflt, 0);
+  ck_assert_int_ge(trs[0]->rusage.majflt, 0);
+  ck_assert_int_ge(trs[0]->rusage.nvcsw, 0);
+  ck_assert_int_ge(trs[0]->rusage.nivcsw, 0);
+  ck_assert_int_ge(trs[0]->rusage.inblock, 0);
+  ck_assert_int_ge(trs[0]->rusage.oublock, 0);
+  free(trs);
+  srunner_free(sr);
+}
+END_TEST
+#endif /* HAVE_WAIT4 */
+
+Suite *make_rusage_suite(void)
+{
+  Suite *s;
+  TCase *tc;
+
+  s = suite_create("Resource Usage");
+  tc = tcase_create("Core");
+
+  suite_add_tcase(s, tc);
+#if defined(HAVE_SYS_RESOURCE_H) && defined(HAVE_FORK) && HAVE_FORK==1 && defined(HAVE_WAIT4)
+  tcase_add_test(tc, test_rusage_fork);
+#endif /* HAVE_WAIT4 */
+
+  return s;
+}
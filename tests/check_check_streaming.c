@@ -0,0 +1,121 @@
+#include "../lib/libcompat.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include "check_check.h"
+
+START_TEST(test_streaming_default)
+{
+  Suite *s = suite_create("Suite");
+  SRunner *sr = srunner_create(s);
+
+  ck_assert_msg(!srunner_streaming(sr), "SRunner streaming by default");
+  srunner_set_streaming(sr, 1);
+  ck_assert_msg(srunner_streaming(sr), "SRunner not streaming once set");
+
+  srunner_free(sr);
+}
+END_TEST
+
+#if HAVE_DECL_SETENV
+START_TEST(test_streaming_env)
+{
+  const char *old_val;
+  Suite *s = suite_create("Suite");
+  SRunner *sr = srunner_create(s);
+
+  ck_assert_msg(save_set_env("CK_STREAMING", "yes", &old_val) == 0,
+              "Failed to set environment variable");
+  ck_assert_msg(srunner_streaming(sr), "SRunner not streaming from env");
+
+  /* an explicit call overrides the environment variable */
+  srunner_set_streaming(sr, 0);
+  ck_assert_msg(!srunner_streaming(sr), "Env overrides srunner_set_streaming");
+
+  ck_assert_msg(restore_env("CK_STREAMING", old_val) == 0,
+              "Failed to restore environment variable");
+
+  srunner_free(sr);
+}
+END_TEST
+#endif /* HAVE_DECL_SETENV */
+
+START_TEST(test_streaming_pass)
+{
+}
+END_TEST
+
+START_TEST(test_streaming_fail)
+{
+  ck_abort_msg("Streaming failure");
+}
+END_TEST
+
+/* Passes are logged, but only failures are kept */
+START_TEST(test_streaming_run)
+{
+  Suite *s = suite_create("Streaming");
+  TCase *tc = tcase_create("Core");
+  SRunner *sr;
+  TestResult **trs;
+  FILE *f;
+  char line[256];
+  int npassed = 0;
+
+  suite_add_tcase(s, tc);
+  tcase_add_test(tc, test_streaming_pass);
+  tcase_add_test(tc, test_streaming_fail);
+  tcase_add_loop_test(tc, test_streaming_pass, 0, 3);
+  sr = srunner_create(s);
+  srunner_set_fork_status(sr, fork_statuses[_i]);
+  srunner_set_streaming(sr, 1);
+  srunner_set_log(sr, "test_streaming.log");
+  srunner_run_all(sr, CK_SILENT);
+
+  ck_assert_int_eq(srunner_ntests_run(sr), 5);
+  ck_assert_int_eq(srunner_ntests_failed(sr), 1);
+
+  trs = srunner_failures(sr);
+  ck_assert_str_eq(tr_msg(trs[0]), "Streaming failure");
+  free(trs);
+
+  trs = srunner_results(sr);
+  ck_assert_int_eq(tr_rtype(trs[0]), CK_FAILURE);
+  ck_assert_ptr_eq(trs[1], NULL);
+  ck_assert_ptr_eq(trs[4], NULL);
+  free(trs);
+
+  f = fopen("test_streaming.log", "r");
+  ck_assert_msg(f != NULL, "Log not written");
+  while(fgets(line, sizeof(line), f) != NULL)
+  {
+    if(strstr(line, ":P:") != NULL)
+      npassed++;
+  }
+  fclose(f);
+  remove("test_streaming.log");
+  ck_assert_int_eq(npassed, 4);
+
+  srunner_free(sr);
+}
+END_TEST
+
+Suite *make_streaming_suite(void)
+{
+  Suite *s;
+  TCase *tc;
+
+  s = suite_create("Streaming");
+  tc = tcase_create("Core");
+
+  suite_add_tcase(s, tc);
+  tcase_add_test(tc, test_streaming_default);
+#if HAVE_DECL_SETENV
+  tcase_add_test(tc, test_streaming_env);
+#endif /* HAVE_DECL_SETENV */
+  tcase_add_loop_test(tc, test_streaming_run, 0, nfork_statuses);
+
+  return s;
+}
@@ -0,0 +1,92 @@
+#include "../lib/libcompat.h"
+
+#include <stdlib.h>
+#include <time.h>
+#include <check.h>
+#include "check_check.h"
+
+/* Spin for at least 20 milliseconds of CPU time */
+START_TEST(test_times_busy)
+{
+  clock_t start = clock();
+
+  while(clock() - start < CLOCKS_PER_SEC / 50)
+    ;
+}
+END_TEST
+
+START_TEST(test_times_fail)
+{
+  ck_abort_msg("Times failure");
+}
+END_TEST
+
+/* Whether the CPU times of tests run in fstat can be measured */
+static int times_have_cpu(enum fork_status fstat)
+{
+  if(fstat == CK_FORK)
+  {
+#if defined(HAVE_SYS_RESOURCE_H) && defined(HAVE_WAIT4)
+    return 1;
+#else
+    return 0;
+#endif
+  }
+#if defined(HAVE_SYS_RESOURCE_H) && defined(HAVE_GETRUSAGE)
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+START_TEST(test_times_run)
+{
+  enum fork_status fstat = fork_statuses[_i];
+  Suite *s = suite_create("Times");
+  TCase *tc = tcase_create("Core");
+  SRunner *sr;
+  TestResult **trs;
+
+  suite_add_tcase(s, tc);
+  tcase_add_test(tc, test_times_busy);
+  tcase_add_test(tc, test_times_fail);
+  sr = srunner_create(s);
+  srunner_set_fork_status(sr, fstat);
+  srunner_run_all(sr, CK_SILENT);
+
+  trs = srunner_results(sr);
+  ck_assert_int_ge(tr_duration_ns(trs[0]), 20000000);
+  if(times_have_cpu(fstat))
+  {
+    ck_assert_int_ge(tr_utime_ns(trs[0]) + tr_stime_ns(trs[0]), 10000000);
+    ck_assert_int_ge(tr_utime_ns(trs[1]), 0);
+    ck_assert_int_ge(tr_stime_ns(trs[1]), 0);
+  }
+  else
+  {
+    ck_assert_int_eq(tr_utime_ns(trs[0]), -1);
+    ck_assert_int_eq(tr_stime_ns(trs[0]), -1);
+  }
+  /* a failed test does not return, so only nofork mode times it */
+  if(fstat == CK_FORK)
+    ck_assert_int_eq(tr_duration_ns(trs[1]), -1);
+  else
+    ck_assert_int_ge(tr_duration_ns(trs[1]), 0);
+  free(trs);
+  srunner_free(sr);
+}
+END_TEST
+
+Suite *make_times_suite(void)
+{
+  Suite *s;
+  TCase *tc;
+
+  s = suite_create("Times");
+  tc = tcase_create("Core");
+
+  suite_add_tcase(s, tc);
+  tcase_add_loop_test(tc, test_times_run, 0, nfork_statuses);
+
+  return s;
+}
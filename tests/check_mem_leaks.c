@@ -42,6 +42,12 @@ int main (int argc, char ** argv)
     fork_setup();
 
     sr = srunner_create (make_log_suite());
+    srunner_add_suite(sr, make_streaming_suite());
+    srunner_add_suite(sr, make_times_suite());
+    srunner_add_suite(sr, make_perf_suite());
+    srunner_add_suite(sr, make_bench_suite());
+    srunner_add_suite(sr, make_alloc_suite());
+    srunner_add_suite(sr, make_phases_suite());
     srunner_add_suite(sr, make_fork_suite());
 
 #if defined(HAVE_FORK) && HAVE_FORK==1
@@ -0,0 +1,578 @@
+#include "../lib/libcompat.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "check.h"
+#include "check_list.h"
+#include "check_impl.h"
+#include "check_baseline.h"
+#include "check_log.h"
+#include "check_stats.h"
+#include "check_check.h"
+
+START_TEST(test_stats_percentile)
+{
+  double x[] = { 1, 2, 3, 4, 5 };
+
+  ck_assert(stats_percentile(x, 5, 0) == 1);
+  ck_assert(stats_percentile(x, 5, 50) == 3);
+  ck_assert(stats_percentile(x, 5, 100) == 5);
+  /* between the closest two */
+  ck_assert(stats_percentile(x, 5, 90) > 4.59 &&
+            stats_percentile(x, 5, 90) < 4.61);
+  ck_assert(stats_percentile(x, 1, 99) == 1);
+}
+END_TEST
+
+START_TEST(test_bench_result)
+{
+  int64_t ps[] = { 5000, 1000, 3000, 2000, 4000, 100000 };
+  BenchResult *br = bench_result_create(10, ps, NULL, 6);
+  char *summary;
+
+  ck_assert_int_eq(br->nsamples, 6);
+  ck_assert(br->samples[0] == 1 && br->samples[5] == 100);
+  ck_assert(br->min == 1);
+  ck_assert(br->median == 3.5);
+  ck_assert(br->mean == 115.0 / 6);
+  ck_assert(br->p99 > br->p90 && br->p99 < 100);
+  /* the deviations are 2.5 1.5 0.5 0.5 1.5 96.5 */
+  ck_assert(br->mad == 1.5);
+  summary = bench_summary(br);
+  ck_assert_str_eq(summary, "min 1.00 ns, median 3.50 ns, mean 19.17 ns, "
+                   "p90 52.50 ns, p99 95.25 ns, MAD 1.50 ns "
+                   "(6 samples of 10 iterations)");
+  free(summary);
+  bench_result_free(br);
+}
+END_TEST
+
+START_TEST(test_bench_result_cpu)
+{
+  int64_t ps[] = { 3000, 1000, 2000, 4000 };
+  int64_t cpu_ps[] = { 300, 100, 200, 800 };
+  BenchResult *br = bench_result_create(10, ps, cpu_ps, 4);
+  double values[BENCH_NSTATS];
+
+  /* each sample keeps its CPU time once sorted */
+  ck_assert(br->samples[0] == 1 && br->cpu_samples[0] == 0.1);
+  ck_assert(br->samples[3] == 4 && br->cpu_samples[3] == 0.8);
+  bench_cpu_stat_values(br, values);
+  ck_assert(values[CK_BENCH_MIN] == 0.1);
+  ck_assert(values[CK_BENCH_MEDIAN] == 0.25);
+  ck_assert(fabs(values[CK_BENCH_MEAN] - 0.35) < 1e-9);
+  bench_result_free(br);
+}
+END_TEST
+
+START_TEST(test_stats_mann_whitney)
+{
+  double a[20], b[20], same[20];
+  int i;
+
+  for (i = 0; i < 20; i++) {
+    a[i] = 100 + i;
+    b[i] = 110 + i;
+    same[i] = 7;
+  }
+  /* b is clearly larger, a clearly not */
+  ck_assert(stats_mann_whitney(a, 20, b, 20) < 0.001);
+  ck_assert(stats_mann_whitney(b, 20, a, 20) > 0.999);
+  /* no difference at all */
+  ck_assert(stats_mann_whitney(a, 20, a, 20) > 0.4);
+  ck_assert(stats_mann_whitney(same, 20, same, 20) == 0.5);
+}
+END_TEST
+
+START_TEST(test_stats_bootstrap_ratio)
+{
+  double a[50], b[50];
+  double lo, hi;
+  int i;
+
+  for (i = 0; i < 50; i++) {
+    a[i] = 100 + i % 5;
+    b[i] = 1.2 * a[i];
+  }
+  stats_bootstrap_ratio(a, 50, b, 50, 95, &lo, &hi);
+  ck_assert(lo <= 0.2 + 1e-9 && hi >= 0.2 - 1e-9);
+  ck_assert(lo > 0.1 && hi < 0.3);
+  stats_bootstrap_ratio(a, 50, a, 50, 95, &lo, &hi);
+  ck_assert(lo <= 0 && hi >= 0);
+}
+END_TEST
+
+START_TEST(test_bench_name)
+{
+  char *name = bench_name("S", "TC", "test", 0);
+
+  ck_assert_str_eq(name, "S/TC/test");
+  free(name);
+  name = bench_name("S", "TC", "test", 3);
+  ck_assert_str_eq(name, "S/TC/test/3");
+  free(name);
+}
+END_TEST
+
+START_BENCH(bench_sum)
+{
+  volatile int sum = 0;
+  int i;
+
+  for (i = 0; i < 10; i++)
+    sum += i;
+  ck_assert_int_eq(sum, 45);
+}
+END_BENCH
+
+/* Write a baseline in which bench_sum took ns per call */
+static void write_baseline(const char *fname, double ns)
+{
+  FILE *f = fopen(fname, "w");
+  int i;
+
+  ck_assert_ptr_ne(f, NULL);
+  fprintf(f, "%s\nB\tStats/Core/bench_sum\t1000\t", BASELINE_MAGIC);
+  for (i = 0; i < 50; i++)
+    fprintf(f, i == 0 ? "%.3f" : " %.3f", ns * (1 + i % 3 / 100.0));
+  fprintf(f, "\nT\tStats/Core/test_other\t1000\n");
+  fclose(f);
+}
+
+/* Run bench_sum, comparing it with baseline if it is not NULL */
+static TestResult *run_bench_sum(SRunner ** srp, const char *baseline,
+                                 double threshold, const char *save)
+{
+  Suite *s = suite_create("Stats");
+  TCase *tc = tcase_create("Core");
+  SRunner *sr;
+  TestResult **trs;
+  TestResult *tr;
+
+  suite_add_tcase(s, tc);
+  tcase_add_bench(tc, bench_sum);
+  sr = srunner_create(s);
+  srunner_set_fork_status(sr, CK_NOFORK);
+  if (baseline != NULL)
+    srunner_set_baseline(sr, baseline);
+  if (threshold >= 0)
+    srunner_set_baseline_threshold(sr, threshold);
+  if (save != NULL)
+    srunner_set_baseline_save(sr, save);
+#if HAVE_DECL_SETENV
+  setenv("CK_BENCH_TIME", "0.02", 1);
+#endif /* HAVE_DECL_SETENV */
+  srunner_run_all(sr, CK_SILENT);
+#if HAVE_DECL_SETENV
+  unsetenv("CK_BENCH_TIME");
+#endif /* HAVE_DECL_SETENV */
+  trs = srunner_results(sr);
+  tr = trs[0];
+  free(trs);
+  *srp = sr;
+  return tr;
+}
+
+START_TEST(test_bench_cpu_time)
+{
+  SRunner *sr;
+  TestResult *tr = run_bench_sum(&sr, NULL, -1, NULL);
+  int i;
+
+  ck_assert_int_eq(tr_rtype(tr), CK_PASS);
+#if defined(CLOCK_PROCESS_CPUTIME_ID)
+  ck_assert_ptr_ne(tr->bench->cpu_samples, NULL);
+  for (i = 0; i < tr->bench->nsamples; i++)
+    ck_assert(tr->bench->cpu_samples[i] >= 0);
+#else
+  (void)i;
+#endif
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_baseline_set)
+{
+  SRunner *sr = srunner_create(NULL);
+
+  ck_assert_ptr_eq(srunner_baseline_fname(sr), NULL);
+  ck_assert_msg(!srunner_has_baseline_save(sr), "SRunner saving a baseline");
+  srunner_set_baseline(sr, "base.ckb");
+  ck_assert_str_eq(srunner_baseline_fname(sr), "base.ckb");
+  srunner_set_baseline(sr, "");
+  ck_assert_ptr_eq(srunner_baseline_fname(sr), NULL);
+  srunner_set_baseline_save(sr, "base.ckb");
+  srunner_set_baseline_save(sr, "base2.ckb");
+  ck_assert_str_eq(srunner_baseline_save_fname(sr), "base.ckb");
+  srunner_set_baseline_threshold(sr, 2.5);
+  ck_assert(srunner_baseline_threshold(sr) == 2.5);
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_baseline_save)
+{
+  SRunner *sr;
+  TestResult *tr = run_bench_sum(&sr, NULL, -1, "test_baseline.txt");
+  Baseline *b;
+  char line[64];
+  FILE *f;
+
+  ck_assert_int_eq(tr_rtype(tr), CK_PASS);
+  srunner_free(sr);
+  f = fopen("test_baseline.txt", "r");
+  ck_assert_ptr_ne(f, NULL);
+  ck_assert_ptr_ne(fgets(line, sizeof(line), f), NULL);
+  ck_assert_str_eq(line, BASELINE_MAGIC "\n");
+  ck_assert_ptr_ne(fgets(line, sizeof(line), f), NULL);
+  ck_assert(strncmp(line, "B\tStats/Core/bench_sum\t", 23) == 0);
+  fclose(f);
+  /* and it can be read back */
+  b = baseline_load("test_baseline.txt");
+  baseline_free(b);
+}
+END_TEST
+
+/* The second line of the baseline written to f */
+static void read_baseline_result(FILE * f, char *line, int size)
+{
+  rewind(f);
+  ck_assert_ptr_ne(fgets(line, size, f), NULL);
+  ck_assert_str_eq(line, BASELINE_MAGIC "\n");
+  ck_assert_ptr_ne(fgets(line, size, f), NULL);
+}
+
+/* Two baselines saved at once keep their own suites */
+START_TEST(test_baseline_two_logs)
+{
+  SRunner *sr = srunner_create(NULL);
+  Suite *sa = suite_create("A");
+  Suite *sb = suite_create("B");
+  TestResult *tr = tr_create();
+  FILE *fa = tmpfile();
+  FILE *fb = tmpfile();
+  void *da = NULL;
+  void *db = NULL;
+  char line[64];
+
+  ck_assert_msg(fa != NULL && fb != NULL, "Could not create temporary file");
+  srunner_add_suite(sr, sa);
+  srunner_add_suite(sr, sb);
+  tr->rtype = CK_PASS;
+  tr->ctx = CK_CTX_TEST;
+  tr->tcname = "tc";
+  tr->tname = "test";
+  tr->duration = 5;
+
+  baseline_lfun(sr, fa, CK_NORMAL, NULL, CLINITLOG_SR, &da);
+  baseline_lfun(sr, fa, CK_NORMAL, sa, CLSTART_S, &da);
+  baseline_lfun(sr, fb, CK_NORMAL, NULL, CLINITLOG_SR, &db);
+  baseline_lfun(sr, fb, CK_NORMAL, sb, CLSTART_S, &db);
+  baseline_lfun(sr, fa, CK_NORMAL, tr, CLEND_T, &da);
+  baseline_lfun(sr, fb, CK_NORMAL, tr, CLEND_T, &db);
+  baseline_lfun(sr, fa, CK_NORMAL, NULL, CLENDLOG_SR, &da);
+  baseline_lfun(sr, fb, CK_NORMAL, NULL, CLENDLOG_SR, &db);
+
+  read_baseline_result(fa, line, sizeof(line));
+  ck_assert_str_eq(line, "T\tA/tc/test\t5\n");
+  read_baseline_result(fb, line, sizeof(line));
+  ck_assert_str_eq(line, "T\tB/tc/test\t5\n");
+  fclose(fa);
+  fclose(fb);
+  tr_free(tr);
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_baseline_same)
+{
+  SRunner *sr;
+  TestResult *tr;
+
+  run_bench_sum(&sr, NULL, -1, "test_baseline.txt");
+  srunner_free(sr);
+  /* 20% slower is allowed, and noise is not a regression */
+  tr = run_bench_sum(&sr, "test_baseline.txt", 20, NULL);
+  ck_assert_msg(tr_rtype(tr) == CK_PASS, "%s", tr_msg(tr));
+  ck_assert_msg(strstr(tr_msg(tr), "% CI ") != NULL, "%s", tr_msg(tr));
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_baseline_faster)
+{
+  SRunner *sr;
+  TestResult *tr;
+
+  write_baseline("test_baseline.txt", 1e6);
+  tr = run_bench_sum(&sr, "test_baseline.txt", -1, NULL);
+  ck_assert_int_eq(tr_rtype(tr), CK_PASS);
+  ck_assert_msg(strstr(tr_msg(tr), "; -100.0% [95% CI -100.0%, -100.0%] "
+                       "against the baseline, p = ") != NULL,
+                "%s", tr_msg(tr));
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_baseline_regressed)
+{
+  SRunner *sr;
+  TestResult *tr;
+
+  write_baseline("test_baseline.txt", 0.001);
+  tr = run_bench_sum(&sr, "test_baseline.txt", -1, NULL);
+  ck_assert_int_eq(tr_rtype(tr), CK_FAILURE);
+  ck_assert_msg(strncmp(tr_msg(tr), "Regressed +", 11) == 0, "%s",
+                tr_msg(tr));
+  ck_assert_msg(strstr(tr_msg(tr), "over the threshold of 10%; min ") != NULL,
+                "%s", tr_msg(tr));
+  ck_assert_int_eq(srunner_ntests_failed(sr), 1);
+  srunner_free(sr);
+}
+END_TEST
+
+static void do_nothing(void)
+{
+}
+
+static void do_sleep(void)
+{
+  usleep(2000);
+}
+
+START_TEST(test_perf_pass)
+{
+  volatile int x = 0;
+
+  ck_assert_faster_than(x++, 1000000000);
+  ck_assert_faster_than({ x++; x++; }, 1000000000);
+  ck_assert_int_eq(x, 3);
+  ck_assert_p99_below(do_nothing, 100, 1000000000);
+}
+END_TEST
+
+START_TEST(test_perf_slow_block)
+{
+  ck_assert_faster_than(do_sleep(), 1000);
+}
+END_TEST
+
+START_TEST(test_perf_slow_p99)
+{
+  ck_assert_p99_below(do_sleep, 5, 1000);
+}
+END_TEST
+
+/* Run a test that uses performance assertions and return its result */
+static TestResult *run_perf(SRunner ** srp, TFun tf)
+{
+  Suite *s = suite_create("Stats");
+  TCase *tc = tcase_create("Assertions");
+  SRunner *sr;
+  TestResult **trs;
+  TestResult *tr;
+
+  suite_add_tcase(s, tc);
+  tcase_add_test(tc, tf);
+  sr = srunner_create(s);
+  srunner_set_fork_status(sr, CK_NOFORK);
+  srunner_run_all(sr, CK_SILENT);
+  trs = srunner_results(sr);
+  tr = trs[0];
+  free(trs);
+  *srp = sr;
+  return tr;
+}
+
+START_TEST(test_assert_faster_than)
+{
+  SRunner *sr;
+  TestResult *tr;
+
+  tr = run_perf(&sr, test_perf_pass);
+  ck_assert_int_eq(tr_rtype(tr), CK_PASS);
+  srunner_free(sr);
+
+  tr = run_perf(&sr, test_perf_slow_block);
+  ck_assert_int_eq(tr_rtype(tr), CK_FAILURE);
+  ck_assert_msg(strstr(tr_msg(tr), "Assertion 'do_sleep()' failed: took ")
+                == tr_msg(tr), "Unexpected message: %s", tr_msg(tr));
+  ck_assert_msg(strstr(tr_msg(tr), " ms, over 1.00 us") != NULL,
+                "Unexpected message: %s", tr_msg(tr));
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_assert_p99_below)
+{
+  SRunner *sr;
+  TestResult *tr = run_perf(&sr, test_perf_slow_p99);
+
+  ck_assert_int_eq(tr_rtype(tr), CK_FAILURE);
+  ck_assert_msg(strstr(tr_msg(tr), "Assertion 'do_sleep' failed: p99 ")
+                == tr_msg(tr), "Unexpected message: %s", tr_msg(tr));
+  ck_assert_msg(strstr(tr_msg(tr), ", over 1.00 us; min ") != NULL,
+                "Unexpected message: %s", tr_msg(tr));
+  ck_assert_msg(strstr(tr_msg(tr), " of 5 calls") != NULL,
+                "Unexpected message: %s", tr_msg(tr));
+  srunner_free(sr);
+}
+END_TEST
+
+START_TEST(test_stats_fit_complexity)
+{
+  double n[6], t[6];
+  double rms;
+  int i;
+
+  for (i = 0; i < 6; i++)
+    n[i] = 64 << (2 * i);
+
+  for (i = 0; i < 6; i++)
+    t[i] = 40 + (i % 2);
+  ck_assert_int_eq(stats_fit_complexity(n, t, 6, &rms), CK_O1);
+  ck_assert(rms < 0.05);
+
+  for (i = 0; i < 6; i++)
+    t[i] = 3 * log(n[i]) / log(2.0);
+  ck_assert_int_eq(stats_fit_complexity(n, t, 6, &rms), CK_OLOG_N);
+  ck_assert(rms < 1e-9);
+
+  /* a constant overhead does not hide the slope */
+  for (i = 0; i < 6; i++)
+    t[i] = 2 * n[i] + 30;
+  ck_assert_int_eq(stats_fit_complexity(n, t, 6, NULL), CK_ON);
+
+  for (i = 0; i < 6; i++)
+    t[i] = n[i] * log(n[i]) * (1 + 0.03 * (i % 2));
+  ck_assert_int_eq(stats_fit_complexity(n, t, 6, NULL), CK_ON_LOG_N);
+
+  for (i = 0; i < 6; i++)
+    t[i] = n[i] * n[i] / 4;
+  ck_assert_int_eq(stats_fit_complexity(n, t, 6, NULL), CK_ON2);
+
+  for (i = 0; i < 6; i++)
+    t[i] = n[i] * n[i] * n[i];
+  ck_assert_int_eq(stats_fit_complexity(n, t, 6, NULL), CK_ON3);
+
+  ck_assert_str_eq(stats_complexity_name(CK_ON_LOG_N), "O(n log n)");
+  ck_assert_str_eq(stats_complexity_name(CK_ON2), "O(n^2)");
+}
+END_TEST
+
+static int complexity_data[1 << 16];
+
+static void fill_data(size_t n)
+{
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    complexity_data[i] = (int) i;
+}
+
+static void sum_data(size_t n)
+{
+  volatile int sum = 0;
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    sum += complexity_data[i];
+}
+
+static void count_pairs(size_t n)
+{
+  volatile int pairs = 0;
+  size_t i, j;
+
+  for (i = 0; i < n; i++)
+    for (j = 0; j < n; j++)
+      pairs += complexity_data[i] < complexity_data[j];
+}
+
+START_TEST(test_perf_linear)
+{
+  static const size_t sizes[] = { 1024, 2048, 4096, 8192, 16384, 32768, 0 };
+
+  ck_assert_complexity(sum_data, fill_data, sizes, CK_ON_LOG_N);
+}
+END_TEST
+
+START_TEST(test_perf_quadratic)
+{
+  static const size_t sizes[] = { 64, 128, 256, 512, 1024, 0 };
+
+  ck_assert_complexity(count_pairs, fill_data, sizes, CK_ON_LOG_N);
+}
+END_TEST
+
+START_TEST(test_perf_one_size)
+{
+  static const size_t sizes[] = { 64, 0 };
+
+  ck_assert_complexity(sum_data, NULL, sizes, CK_ON);
+}
+END_TEST
+
+START_TEST(test_assert_complexity)
+{
+  SRunner *sr;
+  TestResult *tr;
+
+  tr = run_perf(&sr, test_perf_linear);
+  ck_assert_msg(tr_rtype(tr) == CK_PASS, "Linear sum failed: %s",
+                tr_msg(tr));
+  srunner_free(sr);
+
+  tr = run_perf(&sr, test_perf_quadratic);
+  ck_assert_int_eq(tr_rtype(tr), CK_FAILURE);
+  ck_assert_msg(strstr(tr_msg(tr), "Assertion 'count_pairs' failed: fits ")
+                == tr_msg(tr), "Unexpected message: %s", tr_msg(tr));
+  ck_assert_msg(strstr(tr_msg(tr), ", over O(n log n); n=64: ") != NULL,
+                "Unexpected message: %s", tr_msg(tr));
+  ck_assert_msg(strstr(tr_msg(tr), ", n=1024: ") != NULL,
+                "Unexpected message: %s", tr_msg(tr));
+  srunner_free(sr);
+
+  tr = run_perf(&sr, test_perf_one_size);
+  ck_assert_int_eq(tr_rtype(tr), CK_FAILURE);
+  ck_assert_str_eq(tr_msg(tr),
+                   "Assertion 'sum_data' failed: needs at least 2 sizes, got 1");
+  srunner_free(sr);
+}
+END_TEST
+
+Suite *make_stats_suite(void)
+{
+  Suite *s = suite_create("Stats");
+  TCase *tc_core = tcase_create("Core");
+  TCase *tc_baseline = tcase_create("Baseline");
+  TCase *tc_assert = tcase_create("Assertions");
+
+  suite_add_tcase(s, tc_core);
+  tcase_add_test(tc_core, test_stats_percentile);
+  tcase_add_test(tc_core, test_bench_result);
+  tcase_add_test(tc_core, test_bench_result_cpu);
+  tcase_add_test(tc_core, test_stats_mann_whitney);
+  tcase_add_test(tc_core, test_stats_bootstrap_ratio);
+  tcase_add_test(tc_core, test_bench_name);
+  tcase_add_test(tc_core, test_bench_cpu_time);
+  tcase_add_test(tc_core, test_stats_fit_complexity);
+
+  suite_add_tcase(s, tc_baseline);
+  tcase_add_test(tc_baseline, test_baseline_set);
+  tcase_add_test(tc_baseline, test_baseline_save);
+  tcase_add_test(tc_baseline, test_baseline_two_logs);
+  tcase_add_test(tc_baseline, test_baseline_same);
+  tcase_add_test(tc_baseline, test_baseline_faster);
+  tcase_add_test(tc_baseline, test_baseline_regressed);
+
+  suite_add_tcase(s, tc_assert);
+  tcase_add_test(tc_assert, test_assert_faster_than);
+  tcase_add_test(tc_assert, test_assert_p99_below);
+  tcase_add_test(tc_assert, test_assert_complexity);
+
+  return s;
+}
@@ -5,13 +5,10 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 #include <check.h>
 
 
-Suite *s;
-TCase *tc;
-SRunner *sr;
-
 START_TEST(test_pass)
 {
   ck_assert_msg(1,"Shouldn't see this message");
@@ -25,9 +22,14 @@ START_TEST(test_fail)
 END_TEST
 
 
-static void run (int num_iters)
+static int run (int num_iters)
 {
+  Suite *s;
+  TCase *tc;
+  SRunner *sr;
   int i;
+  int nfailed;
+
   s = suite_create ("Stress");
   tc = tcase_create ("Stress");
   sr = srunner_create (s);
@@ -39,26 +41,32 @@ static void run (int num_iters)
   }
 
   srunner_run_all(sr, CK_SILENT);
-  if (srunner_ntests_failed (sr) != num_iters) {
-    printf ("Error: expected %d failures, got %d\n",
-	    num_iters, srunner_ntests_failed(sr));
-    return;
-  }
-
+  nfailed = srunner_ntests_failed (sr);
   srunner_free(sr);
+  if (nfailed != num_iters) {
+    printf ("Error: expected %d failures, got %d\n", num_iters, nfailed);
+    return 1;
+  }
+  return 0;
 }
 
   
 int main(void)
 {
   int i;
-  time_t t1;
+  struct timespec t1, t2;
   int iters[] = {1, 100, 1000, 2000, 4000, 8000, 10000, 20000, 40000, -1};
+  int rval = 0;
 
+  /* for each number of passing and failing tests, the seconds the
+     run took */
   for (i = 0; iters[i] != -1; i++) {
-    t1 = time(NULL);
-    run(iters[i]);
-    printf ("%d, %d\n", iters[i], (int) difftime(time(NULL), t1));
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    rval |= run(iters[i]);
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    printf ("%d, %.3f\n", iters[i],
+            (double) (t2.tv_sec - t1.tv_sec) +
+            (t2.tv_nsec - t1.tv_nsec) / 1e9);
   }
-  return 0;
+  return rval;
 }
@@ -116,12 +116,12 @@ static void print_usage(void)
     printf(" | CK_SUBUNIT");
 #endif
     printf(")\n");
-    printf("                 (STDOUT | STDOUT_DUMP | LOG | LOG_STDOUT | TAP | TAP_STDOUT | XML | XML_STDOUT)\n");
+    printf("                 (STDOUT | STDOUT_DUMP | LOG | LOG_STDOUT | TAP | TAP_STDOUT | XML | XML_STDOUT | JUNIT | JUNIT_STDOUT | JSONL | JSONL_STDOUT | BIN | BIN_STDOUT)\n");
     printf("                 (NORMAL | EXIT_TEST)\n");
     printf("   If CK_ENV is used, the environment variable CK_VERBOSITY can be set to\n");
     printf("   one of these: silent, minimal, or verbose. If it is not set to these, or\n");
     printf("   if CK_VERBOSITY is not set, then CK_NORMAL will be used\n");
-    printf("   If testing the CK_[LOG|TAP_LOG|XML_LOG]_FILE_NAME env var and setting it to '-',\n");
+    printf("   If testing the CK_[LOG|TAP_LOG|XML_LOG|JUNIT_LOG|JSONL_LOG|BIN_LOG]_FILE_NAME env var and setting it to '-',\n");
     printf("   then use the following mode: CK_SILENT STDOUT [NORMAL|EXIT_TEST].\n");
 }
 
@@ -170,6 +170,30 @@ static void run_tests(enum print_output printmode, char *log_type, int include_e
     {
         srunner_set_xml(sr, "-");
     }
+    else if(strcmp(log_type, "JUNIT") == 0)
+    {
+        srunner_set_junit(sr, "test.junit.xml");
+    }
+    else if(strcmp(log_type, "JUNIT_STDOUT") == 0)
+    {
+        srunner_set_junit(sr, "-");
+    }
+    else if(strcmp(log_type, "JSONL") == 0)
+    {
+        srunner_set_jsonl(sr, "test.jsonl");
+    }
+    else if(strcmp(log_type, "JSONL_STDOUT") == 0)
+    {
+        srunner_set_jsonl(sr, "-");
+    }
+    else if(strcmp(log_type, "BIN") == 0)
+    {
+        srunner_set_binlog(sr, "test.ckb");
+    }
+    else if(strcmp(log_type, "BIN_STDOUT") == 0)
+    {
+        srunner_set_binlog(sr, "-");
+    }
     else
     {
         print_usage();
@@ -0,0 +1,60 @@
+#!/usr/bin/env sh
+
+OUTPUT_FILE=test.ckb
+MERGED_FILE=test_merged.ckb
+
+. ./test_vars
+. $(dirname $0)/test_output_strings
+
+if [ -z "${CK_REPORT}" ]; then
+    CK_REPORT=../src/ck-report${EXEEXT}
+fi
+
+compare ( ) {
+    if [ x"${2}" != x"${3}" ]; then
+        echo "Problem with ck-report ${1}";
+        echo "Expected:";
+        echo "${2}";
+        echo "Got:";
+        echo "${3}";
+        exit 1;
+    fi
+}
+
+rm -f ${OUTPUT_FILE} ${MERGED_FILE}
+./ex_output${EXEEXT} CK_SILENT BIN NORMAL > /dev/null
+
+# Converting the binary log must give what the other logs would have
+actual=`${CK_REPORT} -f text ${OUTPUT_FILE} | tr -d "\r"`
+compare "-f text" "${expected_log_log}" "${actual}"
+actual=`${CK_REPORT} -f tap ${OUTPUT_FILE} | tr -d "\r" | sed -e '/^  ---$/,/^  \.\.\.$/d'`
+compare "-f tap" "${expected_normal_tap}" "${actual}"
+actual=`${CK_REPORT} -f jsonl ${OUTPUT_FILE} | tr -d "\r" | sed -e 's/"duration_ns":[0-9][0-9]*,/"duration_ns":N,/' -e 's/"user_ns":[0-9a-z]*,/"user_ns":N,/' -e 's/"system_ns":[0-9a-z]*,/"system_ns":N,/' -e 's/"rusage":{[^}]*}/"rusage":R/' -e 's/"rusage":null/"rusage":R/' -e 's/,"phases":{[^}]*}//'`
+compare "-f jsonl" "${expected_jsonl}" "${actual}"
+
+# A merged log holds the results of all the logs merged
+${CK_REPORT} -f bin -o ${MERGED_FILE} ${OUTPUT_FILE} ${OUTPUT_FILE}
+expected=`${CK_REPORT} -f tap ${OUTPUT_FILE} ${OUTPUT_FILE} | tr -d "\r"`
+actual=`${CK_REPORT} -f tap ${MERGED_FILE} | tr -d "\r"`
+compare "-f bin" "${expected}" "${actual}"
+
+actual=`${CK_REPORT} --slowest 3 ${MERGED_FILE} | wc -l | tr -d " "`
+compare "--slowest 3" "3" "${actual}"
+
+# more than there are lists all the timed tests
+all=`${CK_REPORT} --slowest 1000 ${MERGED_FILE} | wc -l | tr -d " "`
+actual=`${CK_REPORT} --slowest 2147483647 ${MERGED_FILE} | wc -l | tr -d " "`
+compare "--slowest 2147483647" "${all}" "${actual}"
+
+if ${CK_REPORT} --slowest 4294967297 ${MERGED_FILE} > /dev/null 2>&1; then
+    echo "ck-report accepted a number of tests that does not fit in an int";
+    exit 1;
+fi
+
+if ${CK_REPORT} -f text $0 > /dev/null 2>&1; then
+    echo "ck-report accepted a file that is not a binary log";
+    exit 1;
+fi
+
+rm -f ${MERGED_FILE}
+exit 0
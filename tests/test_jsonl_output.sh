@@ -0,0 +1,21 @@
+#!/usr/bin/env sh
+
+OUTPUT_FILE=test.jsonl
+
+. ./test_vars
+. $(dirname $0)/test_output_strings
+
+rm -f ${OUTPUT_FILE}
+./ex_output${EXEEXT} CK_SILENT JSONL NORMAL > /dev/null
+# Times vary between runs; only check that durations are numbers
+actual_jsonl=`cat ${OUTPUT_FILE} | tr -d "\r" | sed -e 's/"duration_ns":[0-9][0-9]*,/"duration_ns":N,/' -e 's/"user_ns":[0-9a-z]*,/"user_ns":N,/' -e 's/"system_ns":[0-9a-z]*,/"system_ns":N,/' -e 's/"rusage":{[^}]*}/"rusage":R/' -e 's/"rusage":null/"rusage":R/' -e 's/,"phases":{[^}]*}//'`
+if [ x"${expected_jsonl}" != x"${actual_jsonl}" ]; then
+    echo "Problem with ex_jsonl_output${EXEEXT}";
+    echo "Expected:";
+    echo "${expected_jsonl}";
+    echo "Got:";
+    echo "${actual_jsonl}";
+    exit 1;
+fi
+
+exit 0
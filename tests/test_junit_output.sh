@@ -0,0 +1,28 @@
+#!/usr/bin/env sh
+
+OUTPUT_FILE=test.junit.xml
+
+. ./test_vars
+. $(dirname $0)/test_output_strings
+
+rm -f ${OUTPUT_FILE}
+./ex_output${EXEEXT} CK_SILENT JUNIT NORMAL > /dev/null
+# Times vary between runs, and the room left for the suite counts is
+# padded with spaces.
+actual_junit=`cat ${OUTPUT_FILE} | tr -d "\r" | sed -e 's/ time="[0-9.]*"//' -e 's/ *>$/>/'`
+if [ x"${expected_junit}" != x"${actual_junit}" ]; then
+    echo "Problem with ex_junit_output${EXEEXT}";
+    echo "Expected:";
+    echo "${expected_junit}";
+    echo "Got:";
+    echo "${actual_junit}";
+    exit 1;
+fi
+
+actual_time_count=`grep -c " time=\"[0-9]*\.[0-9]\{6\}\"" ${OUTPUT_FILE}`
+if [ x"${actual_time_count}" != x"`grep -c "<testsuite \|<testcase " ${OUTPUT_FILE}`" ]; then
+    echo "Missing time attributes in ${OUTPUT_FILE}";
+    exit 1;
+fi
+
+exit 0
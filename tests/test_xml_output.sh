@@ -9,7 +9,7 @@ CK_DEFAULT_TIMEOUT=4
 rm -f ${OUTPUT_FILE}
 export CK_DEFAULT_TIMEOUT
 ./ex_output${EXEEXT} CK_MINIMAL XML NORMAL > /dev/null
-actual_xml=`cat ${OUTPUT_FILE} | tr -d "\r" | grep -v \<duration\> | grep -v \<datetime\> | grep -v \<path\>`
+actual_xml=`cat ${OUTPUT_FILE} | tr -d "\r" | grep -v \<duration\> | grep -v _time\> | grep -v \<rusage | grep -v \<phases | grep -v \<datetime\> | grep -v \<path\>`
 if [ x"${expected_xml}" != x"${actual_xml}" ]; then
     echo "Problem with ex_xml_output${EXEEXT}";
     echo "Expected:";